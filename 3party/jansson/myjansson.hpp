@@ -43,6 +43,7 @@ public:
   Json() = default;
   explicit Json(std::string const & s) { ParseFrom(s); }
   explicit Json(char const * s) { ParseFrom(s); }
+  Json(char const * s, size_t size) { ParseFrom(s, size); }
   explicit Json(JSONPtr && json) { m_handle.AttachNew(json.release()); }
 
   Json GetDeepCopy() const
@@ -59,6 +60,14 @@ public:
     if (!m_handle)
       MYTHROW(Exception, (jsonError.line, jsonError.text));
   }
+  // Parses |size| bytes of |s| which need not be null-terminated.
+  void ParseFrom(char const * s, size_t size)
+  {
+    json_error_t jsonError;
+    m_handle.AttachNew(json_loadb(s, size, 0, &jsonError));
+    if (!m_handle)
+      MYTHROW(Exception, (jsonError.line, jsonError.text));
+  }
 
   json_t * get() const { return m_handle.get(); }
   json_t * get_deep_copy() const { return json_deep_copy(get()); }
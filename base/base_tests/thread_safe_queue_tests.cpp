@@ -121,3 +121,28 @@ UNIT_TEST(ThreadSafeQueue_ExampleWithDataWrapper)
 
   thread.join();
 }
+
+UNIT_TEST(BoundedThreadSafeQueue_Push)
+{
+  size_t const kSize = 1000;
+  size_t const kCapacity = 4;
+  base::threads::BoundedThreadSafeQueue<size_t> queue(kCapacity);
+
+  auto thread = std::thread([&]() {
+    for (size_t i = 0; i < kSize; ++i)
+    {
+      queue.Push(size_t{i});
+      TEST_LESS_OR_EQUAL(queue.Size(), kCapacity, ());
+    }
+  });
+
+  for (size_t i = 0; i < kSize; ++i)
+  {
+    size_t result;
+    queue.WaitAndPop(result);
+    TEST_EQUAL(result, i, ());
+  }
+
+  thread.join();
+  TEST_EQUAL(queue.Size(), 0, ());
+}
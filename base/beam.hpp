@@ -71,6 +71,9 @@ public:
   // The order of returned entries is not specified.
   std::vector<Entry> const & GetEntries() const { return m_entries; }
 
+  // Removes all entries keeping the allocated memory.
+  void Clear() { m_entries.clear(); }
+
 private:
   size_t m_capacity;
   std::vector<Entry> m_entries;
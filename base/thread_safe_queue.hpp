@@ -1,6 +1,7 @@
 #pragma once
 
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <queue>
 #include <utility>
@@ -97,5 +98,48 @@ private:
   std::queue<T> m_queue;
   std::condition_variable m_cond;
 };
+
+// ThreadSafeQueue of a limited capacity: Push waits while the queue is full.
+// It is used to connect the stages of a pipeline without buffering the whole input.
+template <typename T>
+class BoundedThreadSafeQueue
+{
+public:
+  explicit BoundedThreadSafeQueue(size_t capacity) : m_capacity(capacity) {}
+
+  void Push(T && value)
+  {
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_notFull.wait(lk, [this]{ return m_queue.size() < m_capacity; });
+      m_queue.push(std::move(value));
+    }
+    m_notEmpty.notify_one();
+  }
+
+  void WaitAndPop(T & value)
+  {
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_notEmpty.wait(lk, [this]{ return !m_queue.empty(); });
+      value = std::move(m_queue.front());
+      m_queue.pop();
+    }
+    m_notFull.notify_one();
+  }
+
+  size_t Size() const
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_queue.size();
+  }
+
+private:
+  size_t const m_capacity;
+  mutable std::mutex m_mutex;
+  std::queue<T> m_queue;
+  std::condition_variable m_notEmpty;
+  std::condition_variable m_notFull;
+};
 }  // namespace threads
 }  // namespace base
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <random>
 #include <vector>
 
@@ -14,14 +15,16 @@ using namespace std;
 
 namespace
 {
-  void TestFileSorter(vector<uint32_t> & data, char const * tmpFileName, size_t bufferSize)
+  void TestFileSorter(vector<uint32_t> & data, char const * tmpFileName, size_t bufferSize,
+                      unsigned int threadsCount = 1)
   {
     vector<char> serial;
     typedef MemWriter<vector<char> > MemWriterType;
     MemWriterType writer(serial);
     typedef WriterFunctor<MemWriterType> OutT;
     OutT out(writer);
-    FileSorter<uint32_t, OutT> sorter(bufferSize, tmpFileName, out);
+    FileSorter<uint32_t, OutT> sorter(bufferSize, tmpFileName, out, less<uint32_t>(),
+                                      threadsCount);
     for (size_t i = 0; i < data.size(); ++i)
       sorter.Add(data[i]);
     sorter.SortAndFinish();
@@ -55,3 +58,14 @@ UNIT_TEST(FileSorter_Random)
 
   TestFileSorter(data, "file_sorter_test_random.tmp", data.size() / 10);
 }
+
+UNIT_TEST(FileSorter_ParallelManyRuns)
+{
+  mt19937 rng(0);
+  vector<uint32_t> data(100000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint32_t>(rng() % 5000);
+
+  TestFileSorter(data, "file_sorter_test_parallel.tmp", 5000 * sizeof(uint32_t),
+                 4 /* threadsCount */);
+}
@@ -6,13 +6,14 @@
 #include "base/base.hpp"
 #include "base/logging.hpp"
 #include "base/exception.hpp"
+#include "base/thread_pool_computational.hpp"
 
 #include <algorithm>
 #include <cstdlib>
 #include <exception>
 #include <functional>
+#include <future>
 #include <memory>
-#include <queue>
 #include <string>
 #include <utility>
 #include <vector>
@@ -28,6 +29,10 @@ struct Sorter
   }
 };
 
+// External merge sort: the items are collected into the buffer of |bufferBytes|, every full
+// buffer is sorted (by |threadsCount| threads) and written to the temporary file as a run.
+// SortAndFinish merges the runs with a loser tree, every run is read through its own window
+// of the buffer size divided by the number of runs.
 template <typename T,                                        // Item type.
           class OutputSinkT = FileWriter,                    // Sink to output into result file.
           typename LessT = std::less<T>,                     // Item comparator.
@@ -37,14 +42,14 @@ class FileSorter
 {
 public:
   FileSorter(size_t bufferBytes, std::string const & tmpFileName, OutputSinkT & outputSink,
-             LessT fLess = LessT())
+             LessT fLess = LessT(), unsigned int threadsCount = 1)
     : m_TmpFileName(tmpFileName)
     , m_BufferCapacity(std::max(size_t(16), bufferBytes / sizeof(T)))
     , m_OutputSink(outputSink)
     , m_ItemCount(0)
     , m_Less(fLess)
+    , m_ThreadsCount(std::max(1u, threadsCount))
   {
-    m_Buffer.reserve(m_BufferCapacity);
     m_pTmpWriter.reset(new FileWriter(tmpFileName));
   }
 
@@ -52,6 +57,13 @@ public:
   {
     if (m_Buffer.size() == m_BufferCapacity)
       FlushToTmpFile();
+    // The buffer grows up to |m_BufferCapacity| with the input so that small inputs
+    // do not take the whole buffer.
+    if (m_Buffer.size() == m_Buffer.capacity())
+    {
+      m_Buffer.reserve(
+          std::min(m_BufferCapacity, std::max(size_t{kMinBufferCapacity}, 2 * m_Buffer.size())));
+    }
     m_Buffer.push_back(item);
     ++m_ItemCount;
   }
@@ -60,23 +72,32 @@ public:
   {
     ASSERT(m_pTmpWriter.get(), ());
     FlushToTmpFile();
+    std::vector<T>().swap(m_Buffer);
 
     // Write output.
     {
       m_pTmpWriter.reset();
       FileReader reader(m_TmpFileName);
-      ItemIndexPairGreater fGreater(m_Less);
-      PriorityQueue q(fGreater);
-      for (uint32_t i = 0; i < m_ItemCount; i += m_BufferCapacity)
-        Push(q, i, reader);
+      std::vector<RunReader> runs;
+      uint64_t const runsCount = (m_ItemCount + m_BufferCapacity - 1) / m_BufferCapacity;
+      size_t const windowSize = static_cast<size_t>(
+          std::max(uint64_t{16}, uint64_t{m_BufferCapacity} / std::max(uint64_t{1}, runsCount)));
+      runs.reserve(static_cast<size_t>(runsCount));
+      for (uint64_t begin = 0; begin < m_ItemCount; begin += m_BufferCapacity)
+      {
+        runs.emplace_back(reader, begin, std::min(m_ItemCount, begin + m_BufferCapacity),
+                          windowSize);
+      }
 
-      while (!q.empty())
+      if (!runs.empty())
       {
-        m_OutputSink(q.top().first);
-        uint32_t const i = q.top().second + 1;
-        q.pop();
-        if (i % m_BufferCapacity != 0 && i < m_ItemCount)
-          Push(q, i, reader);
+        LoserTree tree(runs, m_Less);
+        for (auto winner = tree.GetWinner(); !runs[winner].IsEmpty(); winner = tree.GetWinner())
+        {
+          m_OutputSink(runs[winner].GetCurrent());
+          runs[winner].Next();
+          tree.Replay(winner);
+        }
       }
     }
     FileWriter::DeleteFileX(m_TmpFileName);
@@ -102,42 +123,152 @@ public:
   }
 
 private:
-  struct ItemIndexPairGreater
+  // Reads the items [begin, end) of the temporary file through a window.
+  class RunReader
   {
-    explicit ItemIndexPairGreater(LessT fLess) : m_Less(fLess) {}
-    inline bool operator()(std::pair<T, uint32_t> const & a, std::pair<T, uint32_t> const & b) const
+  public:
+    RunReader(FileReader const & reader, uint64_t begin, uint64_t end, size_t windowSize)
+      : m_Reader(reader), m_Pos(begin), m_End(end), m_WindowSize(windowSize)
     {
-      return m_Less(b.first, a.first);
+      Fill();
     }
-    LessT m_Less;
+
+    bool IsEmpty() const { return m_WindowPos == m_Window.size(); }
+    T const & GetCurrent() const { return m_Window[m_WindowPos]; }
+
+    void Next()
+    {
+      ASSERT(!IsEmpty(), ());
+      if (++m_WindowPos == m_Window.size())
+        Fill();
+    }
+
+  private:
+    void Fill()
+    {
+      auto const count = static_cast<size_t>(std::min<uint64_t>(m_WindowSize, m_End - m_Pos));
+      m_Window.resize(count);
+      m_WindowPos = 0;
+      if (count == 0)
+        return;
+
+      m_Reader.Read(m_Pos * sizeof(T), m_Window.data(), count * sizeof(T));
+      m_Pos += count;
+    }
+
+    FileReader const & m_Reader;
+    uint64_t m_Pos;
+    uint64_t const m_End;
+    size_t const m_WindowSize;
+    std::vector<T> m_Window;
+    size_t m_WindowPos = 0;
   };
 
-  using PriorityQueue =
-      std::priority_queue<std::pair<T, uint32_t>, std::vector<std::pair<T, uint32_t>>,
-                          ItemIndexPairGreater>;
+  // Tournament tree of the runs: the inner nodes keep the losers of the matches and
+  // the node 0 keeps the winner, so the next winner is found with log(runs) comparisons.
+  // An empty run loses to any other run.
+  class LoserTree
+  {
+  public:
+    LoserTree(std::vector<RunReader> const & runs, LessT const & fLess)
+      : m_Runs(runs), m_Less(fLess), m_Tree(runs.size(), runs.size())
+    {
+      for (size_t i = runs.size(); i > 0; --i)
+        Replay(i - 1);
+    }
+
+    size_t GetWinner() const { return m_Tree[0]; }
+
+    // Replays the matches of the run |i| up to the root after its current item is changed.
+    void Replay(size_t i)
+    {
+      for (size_t node = (i + m_Tree.size()) / 2; node > 0; node /= 2)
+      {
+        if (Wins(m_Tree[node], i))
+          std::swap(m_Tree[node], i);
+      }
+      m_Tree[0] = i;
+    }
+
+  private:
+    bool Wins(size_t lhs, size_t rhs) const
+    {
+      // The nodes are filled with the fake run |m_Tree.size()| which wins everything
+      // before the tree is built.
+      if (lhs == m_Tree.size() || rhs == m_Tree.size())
+        return lhs == m_Tree.size();
+      if (m_Runs[rhs].IsEmpty())
+        return true;
+      if (m_Runs[lhs].IsEmpty())
+        return false;
+      if (m_Less(m_Runs[lhs].GetCurrent(), m_Runs[rhs].GetCurrent()))
+        return true;
+      return !m_Less(m_Runs[rhs].GetCurrent(), m_Runs[lhs].GetCurrent()) && lhs < rhs;
+    }
+
+    std::vector<RunReader> const & m_Runs;
+    LessT const & m_Less;
+    std::vector<size_t> m_Tree;
+  };
 
   void FlushToTmpFile()
   {
     if (m_Buffer.empty())
       return;
-    SorterT<LessT> sorter(m_Less);
-    sorter(m_Buffer.begin(), m_Buffer.end());
+    SortBuffer();
     m_pTmpWriter->Write(&m_Buffer[0], m_Buffer.size() * sizeof(T));
     m_Buffer.clear();
   }
 
-  void Push(PriorityQueue & q, uint32_t i, FileReader const & reader)
+  // Sorts the parts of the buffer in parallel and merges them.
+  void SortBuffer()
   {
-    T item;
-    reader.Read(static_cast<uint64_t>(i) * sizeof(T), &item, sizeof(T));
-    q.push(std::pair<T, uint32_t>(item, i));
+    size_t const partsCount = std::min<size_t>(m_ThreadsCount, m_Buffer.size() / 1024 + 1);
+    size_t const partSize = (m_Buffer.size() + partsCount - 1) / partsCount;
+    auto const partBegin = [&](size_t part) {
+      return m_Buffer.begin() + std::min(m_Buffer.size(), part * partSize);
+    };
+
+    // The pool is created by the first flush which needs it: small inputs are sorted
+    // by the calling thread only. The calling thread sorts the first part itself.
+    if (partsCount > 1 && !m_ThreadPool)
+    {
+      m_ThreadPool =
+          std::make_unique<base::thread_pool::computational::ThreadPool>(m_ThreadsCount - 1);
+    }
+
+    std::vector<std::future<void>> sortedParts;
+    for (size_t part = 1; part < partsCount; ++part)
+    {
+      sortedParts.emplace_back(m_ThreadPool->Submit([&, part] {
+        SorterT<LessT> sorter(m_Less);
+        sorter(partBegin(part), partBegin(part + 1));
+      }));
+    }
+    SorterT<LessT> sorter(m_Less);
+    sorter(partBegin(0), partBegin(1));
+    for (auto & sortedPart : sortedParts)
+      sortedPart.get();
+
+    for (size_t width = 1; width < partsCount; width *= 2)
+    {
+      for (size_t part = 0; part + width < partsCount; part += 2 * width)
+      {
+        std::inplace_merge(partBegin(part), partBegin(part + width),
+                           partBegin(part + 2 * width), m_Less);
+      }
+    }
   }
 
+  static size_t constexpr kMinBufferCapacity = 1024;
+
   std::string const m_TmpFileName;
   size_t const m_BufferCapacity;
   OutputSinkT & m_OutputSink;
   std::unique_ptr<FileWriter> m_pTmpWriter;
   std::vector<T> m_Buffer;
-  uint32_t m_ItemCount;
+  uint64_t m_ItemCount;
   LessT m_Less;
+  unsigned int const m_ThreadsCount;
+  std::unique_ptr<base::thread_pool::computational::ThreadPool> m_ThreadPool;
 };
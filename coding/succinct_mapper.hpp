@@ -3,6 +3,7 @@
 #include "coding/endianness.hpp"
 
 #include "base/assert.hpp"
+#include "base/exception.hpp"
 #include "base/macros.hpp"
 
 #include <type_traits>
@@ -54,7 +55,14 @@ void SkipPadding(Source & src)
 class MapVisitor
 {
 public:
-  explicit MapVisitor(uint8_t const * base) : m_base(base), m_cur(m_base) {}
+  DECLARE_EXCEPTION(OutOfBoundsException, RootException);
+
+  explicit MapVisitor(uint8_t const * base) : m_base(base), m_cur(m_base), m_end(nullptr) {}
+  // Throws OutOfBoundsException instead of reading past |end|: use it for
+  // data which may be truncated or corrupted, e.g. mapped files.
+  MapVisitor(uint8_t const * base, uint8_t const * end) : m_base(base), m_cur(m_base), m_end(end)
+  {
+  }
 
   template <typename T>
   std::enable_if_t<!std::is_pod<T>::value, MapVisitor &> operator()(T & val,
@@ -65,8 +73,9 @@ public:
   }
 
   template <typename T>
-  std::enable_if_t<std::is_pod<T>::value, MapVisitor &> operator()(T & val, char const * /* name */)
+  std::enable_if_t<std::is_pod<T>::value, MapVisitor &> operator()(T & val, char const * name)
   {
+    CheckBytesLeft(1, sizeof(T), name);
     T const * valPtr = reinterpret_cast<T const *>(m_cur);
     val = *valPtr;
 
@@ -75,10 +84,11 @@ public:
   }
 
   template <typename T>
-  MapVisitor & operator()(succinct::mapper::mappable_vector<T> & vec, char const * /* name */)
+  MapVisitor & operator()(succinct::mapper::mappable_vector<T> & vec, char const * name)
   {
     vec.clear();
     (*this)(vec.m_size, "size");
+    CheckBytesLeft(vec.m_size, sizeof(T), name);
     vec.m_data = reinterpret_cast<const T *>(m_cur);
 
     m_cur = Align8Ptr(m_cur + vec.m_size * sizeof(T));
@@ -88,8 +98,19 @@ public:
   uint64_t BytesRead() const { return static_cast<uint64_t>(m_cur - m_base); }
 
 private:
+  void CheckBytesLeft(uint64_t count, size_t size, char const * name) const
+  {
+    if (m_end == nullptr)
+      return;
+    // Padding may move |m_cur| past the end after the last value.
+    uint64_t const left = m_cur < m_end ? static_cast<uint64_t>(m_end - m_cur) : 0;
+    if (count > left / size)
+      MYTHROW(OutOfBoundsException, (name, "needs", count, "values of", size, "bytes, left", left));
+  }
+
   uint8_t const * const m_base;
   uint8_t const * m_cur;
+  uint8_t const * const m_end;
 
   DISALLOW_COPY_AND_MOVE(MapVisitor);
 };
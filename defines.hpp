@@ -21,6 +21,7 @@
 #define TOWNS_FILE "towns.csv"
 #define OFFSET_EXT ".offs"
 #define ID2REL_EXT ".id2rel"
+#define KEY_VALUE_BINARY_EXT ".kvbin"
 
 #define CENTERS_FILE_TAG "centers"
 #define DATA_FILE_TAG "dat"
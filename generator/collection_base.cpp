@@ -0,0 +1,117 @@
+#include "generator/collection_base.hpp"
+
+#include "base/thread_pool_computational.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace generator
+{
+namespace
+{
+// The indices are taken one by one by the calling thread and by the helper tasks.
+// A helper task started after all the indices are taken returns at once, so the calling
+// thread waits only for the indices being processed and never for the queued tasks.
+class ParallelLoop
+{
+public:
+  ParallelLoop(size_t count, std::function<void(size_t)> const & fn) : m_count(count), m_fn(fn) {}
+
+  void Run()
+  {
+    for (auto i = m_next++; i < m_count; i = m_next++)
+    {
+      try
+      {
+        m_fn(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_exception)
+          m_exception = std::current_exception();
+      }
+
+      if (++m_done == m_count)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished.notify_all();
+      }
+    }
+  }
+
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [&] { return m_done == m_count; });
+    if (m_exception)
+      std::rethrow_exception(m_exception);
+  }
+
+private:
+  size_t const m_count;
+  // Called for the taken indices only, that is before Wait() returns.
+  std::function<void(size_t)> const & m_fn;
+  std::atomic<size_t> m_next{0};
+  std::atomic<size_t> m_done{0};
+  std::mutex m_mutex;
+  std::condition_variable m_finished;
+  std::exception_ptr m_exception;
+};
+
+size_t GetSharedPoolThreadsCount()
+{
+  // The calling threads are counted too.
+  return std::max(2u, std::thread::hardware_concurrency()) - 1;
+}
+
+base::thread_pool::computational::ThreadPool & GetSharedPool()
+{
+  static base::thread_pool::computational::ThreadPool pool(GetSharedPoolThreadsCount());
+  return pool;
+}
+}  // namespace
+
+void ForEachIndexInParallel(size_t count, std::function<void(size_t)> const & fn)
+{
+  if (count < 2)
+  {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+
+  auto loop = std::make_shared<ParallelLoop>(count, fn);
+  auto const helpersCount = std::min(count - 1, GetSharedPoolThreadsCount());
+  auto & pool = GetSharedPool();
+  for (size_t i = 0; i < helpersCount; ++i)
+    pool.SubmitWork([loop] { loop->Run(); });
+
+  loop->Run();
+  loop->Wait();
+}
+
+void OperationsTimes::Add(std::string const & name, std::string const & operation,
+                          double seconds)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(std::begin(m_items), std::end(m_items), [&](Item const & item) {
+    return item.m_name == name && item.m_operation == operation;
+  });
+  if (it == std::end(m_items))
+    it = m_items.insert(std::end(m_items), Item{name, operation});
+
+  it->m_seconds += seconds;
+}
+
+std::vector<OperationsTimes::Item> OperationsTimes::GetItems() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_items;
+}
+}  // namespace generator
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <iterator>
+#include <mutex>
+#include <string>
 #include <vector>
 
 // Implementing this base class allows an object to be collection of objects.
@@ -33,3 +37,33 @@ public:
 protected:
   std::vector<T> m_collection;
 };
+
+namespace generator
+{
+// Calls |fn| for the indices [0, count) concurrently, e.g. for the independent items of
+// a collection. The threads are taken from a pool shared by all the calls and the calling
+// thread runs the indices too: nested and concurrent calls (see TranslatorsPool::Finish())
+// do not start more threads than the hardware concurrency.
+void ForEachIndexInParallel(size_t count, std::function<void(size_t)> const & fn);
+
+// Sums the seconds spent in an operation by the items of collections, e.g. in Finish() by
+// a translator and all its clones. It is shared by the clones and may be used concurrently.
+class OperationsTimes
+{
+public:
+  struct Item
+  {
+    std::string m_name;
+    std::string m_operation;
+    double m_seconds = 0.0;
+  };
+
+  void Add(std::string const & name, std::string const & operation, double seconds);
+  // The items are in the order of their first addition.
+  std::vector<Item> GetItems() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::vector<Item> m_items;
+};
+}  // namespace generator
@@ -4,6 +4,9 @@
 #include "generator/intermediate_elements.hpp"
 #include "generator/osm_element.hpp"
 
+#include "base/logging.hpp"
+#include "base/timer.hpp"
+
 using namespace feature;
 
 namespace generator
@@ -14,6 +17,7 @@ CollectorCollection::Clone(std::shared_ptr<cache::IntermediateDataReader> const
   auto p = std::make_shared<CollectorCollection>();
   for (auto const & c : m_collection)
     p->Append(c->Clone(cache));
+  p->m_times = m_times;
   return p;
 }
 
@@ -37,14 +41,20 @@ void CollectorCollection::CollectFeature(FeatureBuilder const & feature, OsmElem
 
 void CollectorCollection::Finish()
 {
-  for (auto & c : m_collection)
-    c->Finish();
+  ForEachIndexInParallel(m_collection.size(), [&](size_t i) {
+    base::Timer const timer;
+    m_collection[i]->Finish();
+    AddTime(i, "finish", timer);
+  });
 }
 
 void CollectorCollection::Save()
 {
-  for (auto & c : m_collection)
-    c->Save();
+  ForEachIndexInParallel(m_collection.size(), [&](size_t i) {
+    base::Timer const timer;
+    m_collection[i]->Save();
+    AddTime(i, "save", timer);
+  });
 }
 
 void CollectorCollection::Merge(CollectorInterface const & collector)
@@ -56,7 +66,27 @@ void CollectorCollection::MergeInto(CollectorCollection & collector) const
 {
   auto & otherCollection = collector.m_collection;
   CHECK_EQUAL(m_collection.size(), otherCollection.size(), ());
-  for (size_t i = 0; i < m_collection.size(); ++i)
+  ForEachIndexInParallel(m_collection.size(), [&](size_t i) {
+    base::Timer const timer;
     otherCollection[i]->Merge(*m_collection[i]);
+    collector.AddTime(i, "merge", timer);
+  });
+}
+
+void CollectorCollection::SetTimes(std::shared_ptr<OperationsTimes> const & times)
+{
+  m_times = times;
+  for (auto & c : m_collection)
+    c->SetTimes(times);
+}
+
+void CollectorCollection::AddTime(size_t i, std::string const & operation,
+                                  base::Timer const & timer) const
+{
+  auto const seconds = timer.ElapsedSeconds();
+  auto const & name = m_collection[i]->GetFilename();
+  LOG(LINFO, ("Collector", name, operation, "seconds:", seconds));
+  if (m_times)
+    m_times->Add("Collector " + name, operation, seconds);
 }
 }  // namespace generator
@@ -3,7 +3,11 @@
 #include "generator/collection_base.hpp"
 #include "generator/collector_interface.hpp"
 
+#include "base/timer.hpp"
+
+#include <cstddef>
 #include <memory>
+#include <string>
 
 struct OsmElement;
 class RelationElement;
@@ -36,5 +40,11 @@ public:
 
   void Merge(CollectorInterface const & collector) override;
   void MergeInto(CollectorCollection & collector) const override;
+  void SetTimes(std::shared_ptr<OperationsTimes> const & times) override;
+
+private:
+  void AddTime(size_t i, std::string const & operation, base::Timer const & timer) const;
+
+  std::shared_ptr<OperationsTimes> m_times;
 };
 }  // namespace generator
@@ -39,6 +39,7 @@ class CollectorCollection;
 class CollectorTag;
 class MaxspeedsCollector;
 class CityAreaCollector;
+class OperationsTimes;
 namespace cache
 {
 class IntermediateDataReader;
@@ -66,6 +67,8 @@ public:
   virtual void Save() = 0;
 
   virtual void Merge(CollectorInterface const &) = 0;
+  // See TranslatorInterface::SetTimes().
+  virtual void SetTimes(std::shared_ptr<OperationsTimes> const & /* times */) {}
 
   virtual void MergeInto(CityAreaCollector &) const { FailIfMethodUnsupported(); }
   virtual void MergeInto(routing::CameraCollector &) const { FailIfMethodUnsupported(); }
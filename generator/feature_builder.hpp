@@ -378,6 +378,48 @@ void ForEachParallelFromDatRawFormat(size_t threadsCount, std::string const & fi
   for (auto & thread : workers)
     thread.join();
 }
+
+/// Parallel process chunks of up to |chunkSize| consecutive features in .dat file:
+/// |toDo| gets a whole chunk, e.g. to look up the regions of the features in a batch.
+template <class SerializationPolicy = serialization_policy::MinSize, class ToDo>
+void ForEachChunkParallelFromDatRawFormat(size_t threadsCount, size_t chunkSize,
+                                          std::string const & filename, ToDo && toDo)
+{
+  CHECK_GREATER_OR_EQUAL(threadsCount, 1, ());
+  CHECK_GREATER_OR_EQUAL(chunkSize, 1, ());
+
+  FileReader reader(filename);
+  ReaderSource<FileReader> src(reader);
+  auto const fileSize = reader.Size();
+  std::mutex readMutex;
+  auto concurrentProcessor = [&] {
+    std::vector<FeatureBuilder> chunk;
+    for (;;)
+    {
+      chunk.clear();
+      {
+        std::lock_guard<std::mutex> lock(readMutex);
+        while (chunk.size() < chunkSize && src.Pos() < fileSize)
+        {
+          chunk.emplace_back();
+          ReadFromSourceRawFormat<SerializationPolicy>(src, chunk.back());
+        }
+      }
+
+      if (chunk.empty())
+        break;
+
+      toDo(chunk);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threadsCount; ++i)
+    workers.emplace_back(concurrentProcessor);
+  concurrentProcessor();
+  for (auto & thread : workers)
+    thread.join();
+}
 template <class SerializationPolicy = serialization_policy::MinSize>
 std::vector<FeatureBuilder> ReadAllDatRawFormat(std::string const & fileName)
 {
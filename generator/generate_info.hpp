@@ -17,7 +17,9 @@ struct GenerateInfo
   {
     Memory,
     Index,
-    File
+    File,
+    // Id-sorted blocks of delta-coded nodes. Requires the source sorted by ids.
+    Compressed
   };
 
   enum class OsmSourceType
@@ -88,6 +90,8 @@ struct GenerateInfo
       m_nodeStorageType = NodeStorageType::Index;
     else if (type == "mem")
       m_nodeStorageType = NodeStorageType::Memory;
+    else if (type == "compressed")
+      m_nodeStorageType = NodeStorageType::Compressed;
     else
       LOG(LCRITICAL, ("Incorrect node_storage type:", type));
   }
@@ -12,9 +12,14 @@
 #include "indexer/feature_visibility.hpp"
 #include "indexer/locality_object.hpp"
 
+#include "platform/platform_tests_support/scoped_file.hpp"
+
 #include "base/geo_object_id.hpp"
 
+#include <algorithm>
 #include <limits>
+#include <mutex>
+#include <vector>
 
 using namespace feature;
 
@@ -309,3 +314,42 @@ UNIT_TEST(FeatureBuilder_SerializeAccuratelyForIntermediate)
   Check(fb2);
   TEST(fb1.IsExactEq(fb2), ());
 }
+
+UNIT_CLASS_TEST(TestWithClassificator, FeatureBuilder_ForEachChunkParallelFromDatRawFormat)
+{
+  platform::tests_support::ScopedFile const file("feature_builder_chunks_test.dat",
+                                                 platform::tests_support::ScopedFile::Mode::DoNotCreate);
+  size_t const kFeaturesCount = 100;
+  {
+    FeatureBuilderWriter<> writer(file.GetFullPath());
+    for (size_t i = 0; i < kFeaturesCount; ++i)
+    {
+      FeatureParams params;
+      char const * arr[][1] = {{"building"}};
+      AddTypes(params, arr);
+      params.FinishAddingTypes();
+
+      FeatureBuilder fb;
+      fb.AddOsmId(base::MakeOsmNode(i));
+      fb.SetParams(params);
+      fb.SetCenter(m2::PointD(i, i));
+      TEST(fb.PreSerialize(), ());
+      writer.Write(fb);
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<uint64_t> ids;
+  ForEachChunkParallelFromDatRawFormat(3 /* threadsCount */, 7 /* chunkSize */, file.GetFullPath(),
+                                       [&](std::vector<FeatureBuilder> & chunk) {
+    TEST_LESS_OR_EQUAL(chunk.size(), 7, ());
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto const & fb : chunk)
+      ids.push_back(fb.GetMostGenericOsmId().GetSerialId());
+  });
+
+  std::sort(ids.begin(), ids.end());
+  TEST_EQUAL(ids.size(), kFeaturesCount, ());
+  for (size_t i = 0; i < kFeaturesCount; ++i)
+    TEST_EQUAL(ids[i], i, ());
+}
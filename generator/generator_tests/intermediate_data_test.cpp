@@ -11,18 +11,34 @@
 #include "generator/generate_info.hpp"
 #include "generator/intermediate_data.hpp"
 #include "generator/intermediate_elements.hpp"
+#include "generator/osm_source.hpp"
+#include "generator/generator_tests/source_data.hpp"
+
+#include "geometry/mercator.hpp"
+
+#include "platform/platform.hpp"
+#include "platform/platform_tests_support/scoped_dir.hpp"
+#include "platform/platform_tests_support/scoped_file.hpp"
 
 #include "coding/reader.hpp"
 #include "coding/writer.hpp"
 
+#include "base/file_name_utils.hpp"
+
 #include "defines.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 using namespace generator;
+using namespace platform::tests_support;
 using namespace std;
 
 UNIT_TEST(Intermediate_Data_empty_way_element_save_load_test)
@@ -115,3 +131,178 @@ UNIT_TEST(Intermediate_Data_relation_element_save_load_test)
   TEST_NOT_EQUAL(e2.tags["key1old"], "value1old", ());
   TEST_NOT_EQUAL(e2.tags["key2old"], "value2old", ());
 }
+
+UNIT_TEST(Intermediate_Data_compressed_point_storage_test)
+{
+  string const kNodesFile = "intermediate_nodes.dat";
+  ScopedFile const nodesFile(kNodesFile + ".compressed", ScopedFile::Mode::DoNotCreate);
+  auto const name = base::JoinPath(GetPlatform().WritableDir(), kNodesFile);
+
+  // Sparse ids: several blocks with gaps between and inside them.
+  vector<pair<uint64_t, pair<double, double>>> nodes;
+  for (uint64_t i = 1; i <= 1000; ++i)
+  {
+    auto const id = i * i + (i % 7 == 0 ? 100000000000 : 0) * i;
+    nodes.emplace_back(id, make_pair(-89.0 + i * 0.17, 179.5 - i * 0.35));
+  }
+  sort(nodes.begin(), nodes.end());
+
+  using NodeStorageType = feature::GenerateInfo::NodeStorageType;
+  {
+    auto writer = cache::CreatePointStorageWriter(NodeStorageType::Compressed, name);
+    for (auto const & node : nodes)
+      writer->AddPoint(node.first, node.second.first, node.second.second);
+    TEST_EQUAL(writer->GetNumProcessedPoints(), nodes.size(), ());
+  }
+
+  auto reader = cache::CreatePointStorageReader(NodeStorageType::Compressed, name);
+  double lat;
+  double lon;
+  for (auto const & node : nodes)
+  {
+    TEST(reader->GetPoint(node.first, lat, lon), (node.first));
+    TEST_NEAR(lat, node.second.first, 1e-7, (node.first));
+    TEST_NEAR(lon, node.second.second, 1e-7, (node.first));
+  }
+
+  TEST(!reader->GetPoint(0, lat, lon), ());
+  TEST(!reader->GetPoint(3, lat, lon), ());
+  TEST(!reader->GetPoint(nodes.back().first + 1, lat, lon), ());
+}
+
+UNIT_TEST(Intermediate_Data_index_file_test)
+{
+  string const kIndexFile = "intermediate_index.dat";
+  ScopedFile const indexFile(kIndexFile, ScopedFile::Mode::DoNotCreate);
+  auto const name = base::JoinPath(GetPlatform().WritableDir(), kIndexFile);
+
+  // Keys with a single value and a key with values in several blocks, added in reverse order.
+  multimap<uint64_t, uint64_t> elements;
+  for (uint64_t i = 1000; i > 0; --i)
+    elements.emplace(i * 5, i * i);
+  for (uint64_t i = 300; i > 0; --i)
+    elements.emplace(2502, i * 7);
+
+  {
+    cache::IndexFileWriter writer(name);
+    for (auto it = elements.crbegin(); it != elements.crend(); ++it)
+      writer.Add(it->first, it->second);
+    writer.WriteAll();
+  }
+
+  cache::IndexFileReader const reader(name);
+  uint64_t value;
+  for (uint64_t i = 1; i <= 1000; ++i)
+  {
+    TEST(reader.GetValueByKey(i * 5, value), (i));
+    TEST_EQUAL(value, i * i, ());
+    TEST(!reader.GetValueByKey(i * 5 + 1, value), (i));
+  }
+  TEST(!reader.GetValueByKey(0, value), ());
+
+  vector<uint64_t> values;
+  reader.ForEachByKey(2502, [&values](uint64_t v) {
+    values.push_back(v);
+    return base::ControlFlow::Continue;
+  });
+  TEST_EQUAL(values.size(), 300, ());
+  for (size_t i = 0; i < values.size(); ++i)
+    TEST_EQUAL(values[i], (i + 1) * 7, ());
+}
+
+UNIT_TEST(Intermediate_Data_shared_element_cache_reader_test)
+{
+  string const kWaysFile = "intermediate_ways.dat";
+  ScopedFile const waysFile(kWaysFile, ScopedFile::Mode::DoNotCreate);
+  ScopedFile const offsetsFile(kWaysFile + OFFSET_EXT, ScopedFile::Mode::DoNotCreate);
+  auto const name = base::JoinPath(GetPlatform().WritableDir(), kWaysFile);
+
+  vector<WayElement> ways;
+  for (uint64_t id = 1; id <= 100; ++id)
+  {
+    ways.emplace_back(id * 3);
+    for (uint64_t node = 0; node < id % 10; ++node)
+      ways.back().nodes.push_back(id * 100 + node);
+  }
+
+  {
+    cache::OSMElementCacheWriter writer(name);
+    for (auto const & way : ways)
+      writer.Write(way.m_wayOsmId, way);
+    writer.SaveOffsets();
+  }
+
+  cache::OSMElementCacheReader const reader(name, true /* preload */, true /* forceReload */);
+  vector<thread> threads;
+  vector<size_t> mismatches(4, 0);
+  for (size_t t = 0; t < mismatches.size(); ++t)
+  {
+    threads.emplace_back([&, t] {
+      for (size_t i = t; i < ways.size(); i += mismatches.size())
+      {
+        WayElement way(ways[i].m_wayOsmId);
+        if (!reader.Read(ways[i].m_wayOsmId, way) || way.nodes != ways[i].nodes)
+          ++mismatches[t];
+      }
+    });
+  }
+  for (auto & thread : threads)
+    thread.join();
+
+  for (auto const mismatchesCount : mismatches)
+    TEST_EQUAL(mismatchesCount, 0, ());
+
+  WayElement way(1);
+  TEST(!reader.Read(1, way), ());
+}
+
+UNIT_TEST(Intermediate_Data_generate_from_o5m_test)
+{
+  string const kDir = "intermediate_data_test";
+  ScopedDir const dir(kDir);
+  ScopedFile const osmFile(base::JoinPath(kDir, "way.o5m"),
+                           string(begin(way_o5m_data), end(way_o5m_data)));
+  vector<unique_ptr<ScopedFile>> intermediateFiles;
+  for (string const file : {NODES_FILE ".short", NODES_FILE ID2REL_EXT, WAYS_FILE,
+                            WAYS_FILE OFFSET_EXT, WAYS_FILE ID2REL_EXT, RELATIONS_FILE,
+                            RELATIONS_FILE OFFSET_EXT, TOWNS_FILE})
+  {
+    intermediateFiles.emplace_back(
+        make_unique<ScopedFile>(base::JoinPath(kDir, file), ScopedFile::Mode::DoNotCreate));
+  }
+
+  feature::GenerateInfo info;
+  info.m_intermediateDir = dir.GetFullPath();
+  info.m_osmFileName = osmFile.GetFullPath();
+  info.m_osmFileType = feature::GenerateInfo::OsmSourceType::O5M;
+  info.m_nodeStorageType = feature::GenerateInfo::NodeStorageType::Index;
+  TEST(GenerateIntermediateData(info, 2 /* threadsCount */), ());
+
+  SourceReader reader(info.m_osmFileName);
+  vector<OsmElement> elements;
+  ProcessOsmElementsFromO5M(reader, [&elements](OsmElement * e) { elements.push_back(*e); });
+
+  cache::IntermediateData intermediateData(info, true /* forceReload */);
+  auto const & cache = intermediateData.GetCache();
+  size_t waysCount = 0;
+  for (auto const & element : elements)
+  {
+    if (element.m_type == OsmElement::EntityType::Node)
+    {
+      double lat;
+      double lon;
+      TEST(cache->GetNode(element.m_id, lat, lon), (element.m_id));
+      auto const pt = MercatorBounds::FromLatLon(element.m_lat, element.m_lon);
+      TEST_NEAR(lat, pt.y, 1e-6, (element.m_id));
+      TEST_NEAR(lon, pt.x, 1e-6, (element.m_id));
+    }
+    else if (element.m_type == OsmElement::EntityType::Way)
+    {
+      WayElement way(element.m_id);
+      TEST(cache->GetWay(element.m_id, way), (element.m_id));
+      TEST_EQUAL(way.nodes, element.Nodes(), (element.m_id));
+      ++waysCount;
+    }
+  }
+  TEST_EQUAL(waysCount, 1, ());
+}
@@ -0,0 +1,104 @@
+#include "testing/testing.hpp"
+
+#include "generator/key_value_storage.hpp"
+
+#include "platform/platform.hpp"
+#include "platform/platform_tests_support/scoped_file.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "defines.hpp"
+
+using namespace generator;
+using platform::tests_support::ScopedFile;
+
+namespace
+{
+int GetRank(JsonValue const & json)
+{
+  return FromJSONObject<int>(base::GetJSONObligatoryField(json, "properties"), "rank");
+}
+}  // namespace
+
+UNIT_TEST(KeyValueStorage_Find)
+{
+  std::string const kv =
+      "0000000000000003 {\"properties\":{\"rank\":3}}\n"
+      "0000000000000001 {\"properties\":{\"rank\":1}}\n"
+      "broken line\n"
+      "0000000000000003 {\"properties\":{\"rank\":33}}\n"
+      "00000000000000FF {\"properties\":{\"rank\":255}}\n"
+      "0000000000000004 {not json}\n";
+  ScopedFile const kvFile("key_value_storage_test.jsonl", kv);
+  ScopedFile const binaryFile(std::string("key_value_storage_test.jsonl") + KEY_VALUE_BINARY_EXT,
+                              ScopedFile::Mode::DoNotCreate);
+
+  KeyValueStorage const storage(kvFile.GetFullPath(), 1 /* cacheValuesCountLimit */);
+  TEST_EQUAL(storage.Size(), 4, ());
+
+  // The values are decoded concurrently and evicted from the cache of a single value.
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&storage] {
+      for (size_t i = 0; i < 100; ++i)
+      {
+        auto const value = storage.Find(i % 2 == 0 ? 0x1 : 0xFF);
+        TEST(value, ());
+        TEST_EQUAL(GetRank(*value), i % 2 == 0 ? 1 : 255, ());
+      }
+    });
+  }
+  for (auto & thread : threads)
+    thread.join();
+
+  // The first value of a duplicated key is kept.
+  auto const duplicated = storage.Find(0x3);
+  TEST(duplicated, ());
+  TEST_EQUAL(GetRank(*duplicated), 3, ());
+
+  TEST(!storage.Find(0x2), ());
+  TEST(!storage.Find(0x4), ());
+
+  // The binary storage is reused.
+  KeyValueStorage const filtered(kvFile.GetFullPath(), 0 /* cacheValuesCountLimit */,
+                                 [](KeyValue const & kv) { return GetRank(*kv.second) > 1; });
+  TEST(!filtered.Find(0x1), ());
+  TEST(filtered.Find(0xFF), ());
+}
+
+UNIT_TEST(KeyValueStorage_RebuildChangedContent)
+{
+  std::string const kvName = "key_value_storage_rebuild_test.jsonl";
+  ScopedFile const kvFile(kvName, "0000000000000001 {\"properties\":{\"rank\":1}}\n");
+  ScopedFile const binaryFile(kvName + KEY_VALUE_BINARY_EXT, ScopedFile::Mode::DoNotCreate);
+
+  {
+    KeyValueStorage const storage(kvFile.GetFullPath(), 0 /* cacheValuesCountLimit */);
+    auto const value = storage.Find(0x1);
+    TEST(value, ());
+    TEST_EQUAL(GetRank(*value), 1, ());
+  }
+
+  // The file of the same size with another content is not taken for the built one.
+  {
+    std::ofstream kv(kvFile.GetFullPath());
+    kv << "0000000000000002 {\"properties\":{\"rank\":2}}\n";
+  }
+
+  KeyValueStorage const storage(kvFile.GetFullPath(), 0 /* cacheValuesCountLimit */);
+  TEST(!storage.Find(0x1), ());
+  auto const value = storage.Find(0x2);
+  TEST(value, ());
+  TEST_EQUAL(GetRank(*value), 2, ());
+
+  // The temporary files are renamed.
+  Platform::FilesList files;
+  Platform::GetFilesByRegExp(GetPlatform().WritableDir(), "key_value_storage_rebuild_test", files);
+  TEST_EQUAL(files.size(), 2, (files));
+}
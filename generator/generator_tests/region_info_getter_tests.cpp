@@ -0,0 +1,123 @@
+#include "testing/testing.hpp"
+
+#include "generator/data_version.hpp"
+#include "generator/feature_generator.hpp"
+#include "generator/generator_tests/common.hpp"
+#include "generator/key_value_storage.hpp"
+#include "generator/locality_sorter.hpp"
+#include "generator/regions/region_info_getter.hpp"
+
+#include "indexer/classificator_loader.hpp"
+#include "indexer/locality_index_builder.hpp"
+
+#include "platform/platform_tests_support/scoped_file.hpp"
+
+#include "base/geo_object_id.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "defines.hpp"
+
+using namespace generator;
+using namespace generator_tests;
+using platform::tests_support::ScopedFile;
+
+namespace
+{
+std::string MakeRegionValue(int rank, std::string const & dref)
+{
+  return "{\"properties\":{\"rank\":" + std::to_string(rank) +
+         (dref.empty() ? "" : ",\"dref\":\"" + dref + "\"") + "}}";
+}
+
+uint64_t const kNoRegion = 0;
+
+uint64_t GetId(boost::optional<KeyValue> const & region)
+{
+  return region ? region->first : kNoRegion;
+}
+}  // namespace
+
+UNIT_TEST(RegionInfoGetter_FindDeepestBatch)
+{
+  classificator::Load();
+
+  auto const countryId = base::MakeOsmRelation(1);
+  auto const cityId = base::MakeOsmRelation(2);
+  // The corners are given to make the polygons counterclockwise.
+  std::vector<OsmElementData> const regions = {
+      {1, {{"boundary", "administrative"}, {"admin_level", "2"}}, {{10, 0}, {0, 10}}, {}},
+      {2, {{"boundary", "administrative"}, {"admin_level", "8"}}, {{4, 2}, {2, 4}}, {}}};
+
+  ScopedFile const features("region_info_getter_test.mwm.tmp", ScopedFile::Mode::DoNotCreate);
+  ScopedFile const data("region_info_getter_test.data", ScopedFile::Mode::DoNotCreate);
+  ScopedFile const index("region_info_getter_test.idx", ScopedFile::Mode::DoNotCreate);
+  ScopedFile const kv("region_info_getter_test.jsonl", ScopedFile::Mode::DoNotCreate);
+  ScopedFile const kvBinary(std::string("region_info_getter_test.jsonl") + KEY_VALUE_BINARY_EXT,
+                            ScopedFile::Mode::DoNotCreate);
+  {
+    feature::FeaturesCollector collector(features.GetFullPath());
+    for (auto const & region : regions)
+    {
+      auto fb = FeatureBuilderFromOmsElementData(region);
+      TEST(fb.PreSerialize(), ());
+      collector.Collect(fb);
+    }
+  }
+  TEST(feature::GenerateRegionsData(features.GetFullPath(), data.GetFullPath()), ());
+  TEST(indexer::BuildRegionsIndexFromDataFile(data.GetFullPath(), index.GetFullPath(),
+                                              std::string(), DataVersion::kFileTag),
+       ());
+  TEST(feature::GenerateBorders(features.GetFullPath(), index.GetFullPath()), ());
+  {
+    std::ofstream kvStream(kv.GetFullPath());
+    kvStream << KeyValueStorage::SerializeDref(countryId.GetEncodedId()) << " "
+             << MakeRegionValue(2, {}) << "\n"
+             << KeyValueStorage::SerializeDref(cityId.GetEncodedId()) << " "
+             << MakeRegionValue(8, KeyValueStorage::SerializeDref(countryId.GetEncodedId()))
+             << "\n";
+  }
+
+  regions::RegionInfoGetter const getter(index.GetFullPath(), kv.GetFullPath());
+
+  std::vector<m2::PointD> points;
+  for (double x = -1.0; x <= 11.0; x += 0.5)
+  {
+    for (double y = 11.0; y >= -1.0; y -= 0.75)
+      points.emplace_back(x, y);
+  }
+  // Duplicates are resolved once.
+  points.push_back(points.front());
+  points.emplace_back(3.0, 3.0);
+  points.emplace_back(3.0, 3.0);
+
+  auto const deepest = getter.FindDeepest(points);
+  TEST_EQUAL(deepest.size(), points.size(), ());
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    auto const & p = points[i];
+    uint64_t expected;
+    if (p.x > 2.0 && p.x < 4.0 && p.y > 2.0 && p.y < 4.0)
+      expected = cityId.GetEncodedId();
+    else if (p.x > 0.0 && p.x < 10.0 && p.y > 0.0 && p.y < 10.0)
+      expected = countryId.GetEncodedId();
+    else if (p.x < 0.0 || p.x > 10.0 || p.y < 0.0 || p.y > 10.0)
+      expected = kNoRegion;
+    else
+      continue;  // On a border.
+
+    TEST_EQUAL(GetId(deepest[i]), expected, (p));
+    TEST_EQUAL(GetId(getter.FindDeepest(p)), expected, (p));
+  }
+
+  auto const selector = [cityId](KeyValue const & region) {
+    return region.first != cityId.GetEncodedId();
+  };
+  auto const selected = getter.FindDeepest({{3.0, 3.0}, {20.0, 20.0}}, selector);
+  TEST_EQUAL(selected.size(), 2, ());
+  TEST_EQUAL(GetId(selected[0]), countryId.GetEncodedId(), ());
+  TEST(!selected[1], ());
+}
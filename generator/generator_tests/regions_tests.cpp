@@ -1,6 +1,7 @@
 #include "testing/testing.hpp"
 
 #include "generator/feature_builder.hpp"
+#include "generator/feature_generator.hpp"
 #include "generator/generator_tests/common.hpp"
 #include "generator/osm2type.hpp"
 #include "generator/osm_element.hpp"
@@ -21,7 +22,10 @@
 #include "base/scope_guard.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <fstream>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <sstream>
@@ -29,6 +33,8 @@
 #include <utility>
 #include <vector>
 
+#include "defines.hpp"
+
 using namespace generator_tests;
 using namespace generator;
 using namespace generator::regions;
@@ -140,6 +146,41 @@ std::vector<std::string> GenerateTestRegions(std::vector<OsmElementData> const &
   return kvRegions;
 }
 
+std::string GenerateTestRegionsKv(std::vector<OsmElementData> const & testData,
+                                  size_t threadsCount)
+{
+  classificator::Load();
+
+  auto const collectorFilename = GetFileName();
+  auto const featuresFilename = GetFileName();
+  auto const kvFilename = GetFileName();
+  auto const repackedFilename = GetFileName();
+  SCOPE_GUARD(removeFiles, [&] {
+    for (auto const & filename : {collectorFilename, featuresFilename, kvFilename,
+                                  kvFilename + KEY_VALUE_BINARY_EXT, repackedFilename})
+    {
+      Platform::RemoveFileIfExists(filename);
+    }
+  });
+
+  CollectRegionInfo(collectorFilename, testData);
+  {
+    FeaturesCollector featuresCollector(featuresFilename);
+    for (auto const & elementData : testData)
+    {
+      auto fb = FeatureBuilderFromOmsElementData(elementData);
+      TEST(fb.PreSerialize(), ());
+      featuresCollector.Collect(fb);
+    }
+  }
+
+  GenerateRegions(featuresFilename, collectorFilename, kvFilename, repackedFilename,
+                  false /* verbose */, threadsCount);
+
+  std::ifstream kv(kvFilename);
+  return {std::istreambuf_iterator<char>(kv), std::istreambuf_iterator<char>()};
+}
+
 bool HasName(std::vector<string> const & coll, std::string const & name)
 {
   auto const end = std::end(coll);
@@ -283,6 +324,24 @@ public:
   }
 };
 
+Region MakeWavyRegion(RegionInfo & collector, m2::PointD const & center, double radius)
+{
+  size_t const kPointsCount = 2000;
+  std::vector<m2::PointD> poly;
+  for (size_t i = 0; i <= kPointsCount; ++i)
+  {
+    auto const angle = -2 * M_PI * (i % kPointsCount) / kPointsCount;
+    auto const r = radius * (1 + 0.05 * std::sin(37 * angle));
+    poly.emplace_back(center.x + r * std::cos(angle), center.y + r * std::sin(angle));
+  }
+
+  FeatureBuilder fb;
+  fb.SetOsmId(MakeOsmRelation(1 /* id */));
+  fb.AddPolygon(poly);
+  fb.SetArea();
+  return Region(fb, collector.Get(MakeOsmRelation(1 /* id */)));
+}
+
 bool NameExists(std::vector<std::string> const & coll, std::string const & name)
 {
   auto const end = std::end(coll);
@@ -624,3 +683,49 @@ UNIT_TEST(RegionsBuilderTest_GenerateRusSPetersburgSuburb)
                u8"suburb: Центральный район, sublocality: Дворцовый округ"),
        ());
 }
+
+UNIT_TEST(Region_IsOverlapPercentageLess)
+{
+  auto const filename = MakeCollectorData();
+  SCOPE_GUARD(removeCollectorFile, std::bind(Platform::RemoveFileIfExists, std::cref(filename)));
+  RegionInfo collector(filename);
+
+  auto const region = MakeWavyRegion(collector, {0, 0}, 10);
+  for (auto const & other : {MakeWavyRegion(collector, {0, 0}, 10),
+                             MakeWavyRegion(collector, {1, 1}, 5),
+                             MakeWavyRegion(collector, {5, 0}, 10),
+                             MakeWavyRegion(collector, {9, 9}, 4),
+                             MakeWavyRegion(collector, {20, 0}, 10)})
+  {
+    auto const overlap = region.CalculateOverlapPercentage(other);
+    for (auto const percentage : {1.0, 10.0, 50.0, 90.0, 99.0})
+    {
+      TEST_EQUAL(region.IsOverlapPercentageLess(other, percentage), overlap < percentage,
+                 (overlap, percentage));
+      TEST_EQUAL(other.IsOverlapPercentageLess(region, percentage), overlap < percentage,
+                 (overlap, percentage));
+    }
+  }
+}
+
+UNIT_TEST(RegionsGenerator_KvDoesNotDependOnThreadsCount)
+{
+  Tag const admin{"admin_level"};
+  Tag const place{"place"};
+  Tag const name{"name"};
+  TagValue const ba{"boundary", "administrative"};
+
+  std::vector<OsmElementData> const testData = {
+      {1, {name = u8"Country_1", admin = "2", ba}, {{0, 0}, {50, 50}}, {}},
+      {2, {name = u8"State_1", place = "state"}, {{10, 10}, {20, 20}}, {}},
+      {3, {name = u8"City_1", place = "city"}, {{12, 12}, {14, 14}}, {}},
+      {4, {name = u8"State_2", place = "state"}, {{30, 30}, {40, 40}}, {}},
+      {5, {name = u8"Country_2", admin = "2", ba}, {{60, 0}, {110, 50}}, {}},
+      {6, {name = u8"City_2", place = "city"}, {{70, 10}, {80, 20}}, {}},
+      {7, {name = u8"Country_3", admin = "2", ba}, {{0, 60}, {50, 110}}, {}},
+  };
+
+  auto const kv = GenerateTestRegionsKv(testData, 1 /* threadsCount */);
+  TEST_EQUAL(std::count(std::begin(kv), std::end(kv), '\n'), testData.size(), ());
+  TEST_EQUAL(GenerateTestRegionsKv(testData, 3 /* threadsCount */), kv, ());
+}
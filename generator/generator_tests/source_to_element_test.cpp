@@ -6,9 +6,11 @@
 
 #include "coding/parse_xml.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -73,3 +75,101 @@ UNIT_TEST(Source_To_Element_check_equivalence)
     TEST_EQUAL(elementsXML[i], elementsO5M[i], ());
   }
 }
+
+UNIT_TEST(Source_To_Element_o5m_chunks_by_segments)
+{
+  // Concatenation of the streams: every stream starts with a reset.
+  std::string src;
+  for (auto const & data : {std::string(std::begin(node_o5m_data), std::end(node_o5m_data)),
+                            std::string(std::begin(way_o5m_data), std::end(way_o5m_data)),
+                            std::string(std::begin(relation_o5m_data), std::end(relation_o5m_data))})
+  {
+    // Drop the end of the stream.
+    src.append(data, 0, data.size() - 1);
+  }
+  src.push_back(static_cast<char>(osm::O5MSource::EntityType::End));
+
+  auto const isKnown = [](OsmElement const & e) {
+    return e.m_type != OsmElement::EntityType::Unknown;
+  };
+
+  std::istringstream ss(src);
+  SourceReader reader(ss);
+  std::vector<OsmElement> expected;
+  ProcessOsmElementsFromO5M(reader, [&](OsmElement * e) {
+    if (isKnown(*e))
+      expected.push_back(*e);
+  });
+  TEST_GREATER(expected.size(), 11, ());
+
+  for (uint64_t const minSegmentSize : {uint64_t{1}, kMinO5MSegmentSize})
+  {
+    for (size_t const chunkSize : {1, 3, 1024})
+    {
+      // The processed chunks are refilled by the reader.
+      auto const chunksPool = std::make_shared<OsmElementChunksPool>();
+      std::istringstream ss(src);
+      SourceReader reader(ss);
+      std::vector<OsmElement> actual;
+      ProcessOsmElementChunksFromO5M(reader, 3 /* threadsCount */, chunkSize,
+                                     [&](std::vector<OsmElement> && elements) {
+        TEST_LESS_OR_EQUAL(elements.size(), chunkSize, ());
+        std::copy_if(elements.begin(), elements.end(), std::back_inserter(actual), isKnown);
+        chunksPool->Put(std::move(elements));
+      }, chunksPool, minSegmentSize);
+      TEST_EQUAL(actual, expected, (minSegmentSize, chunkSize));
+    }
+  }
+}
+
+UNIT_TEST(Source_To_Element_clear_keeps_strings)
+{
+  std::string const longValue(100, 'v');
+  OsmElement element;
+  element.AddTag("name", longValue.c_str());
+  element.AddMember(1, OsmElement::EntityType::Way, std::string(50, 'r'));
+  auto const * const valueData = element.m_tags[0].m_value.data();
+  auto const * const roleData = element.m_members[0].m_role.data();
+
+  element.Clear();
+  TEST(element.m_tags.empty(), ());
+  TEST(element.m_members.empty(), ());
+
+  element.AddTag("name", " value ");
+  element.AddMember(2, OsmElement::EntityType::Node, "outer");
+  TEST_EQUAL(element.m_tags[0].m_value, "value", ());
+  TEST_EQUAL(element.m_tags[0].m_value.data(), valueData, ());
+  TEST_EQUAL(element.m_members[0].m_role, "outer", ());
+  TEST_EQUAL(element.m_members[0].m_role.data(), roleData, ());
+
+  // The spare strings are not copied.
+  OsmElement copy = element;
+  TEST_EQUAL(copy, element, ());
+}
+
+UNIT_TEST(Source_To_Element_xml_chunks)
+{
+  std::vector<OsmElement> expected;
+  {
+    std::istringstream ss(relation_xml_data);
+    SourceReader reader(ss);
+    ProcessOsmElementsFromXML(reader, [&expected](OsmElement * e) { expected.push_back(*e); });
+  }
+
+  // The chunks and their elements are recycled by the parser.
+  auto const chunksPool = std::make_shared<OsmElementChunksPool>();
+  std::vector<OsmElement> actual;
+  for (size_t i = 0; i < 2; ++i)
+  {
+    actual.clear();
+    std::istringstream ss(relation_xml_data);
+    SourceReader reader(ss);
+    ProcessOsmElementChunks(reader, feature::GenerateInfo::OsmSourceType::XML,
+                            1 /* threadsCount */, 3 /* chunkSize */,
+                            [&](std::vector<OsmElement> && elements) {
+      std::copy(elements.begin(), elements.end(), std::back_inserter(actual));
+      chunksPool->Put(std::move(elements));
+    }, chunksPool);
+    TEST_EQUAL(actual, expected, ());
+  }
+}
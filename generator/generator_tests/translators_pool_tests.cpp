@@ -0,0 +1,140 @@
+#include "testing/testing.hpp"
+
+#include "generator/collection_base.hpp"
+#include "generator/osm_element.hpp"
+#include "generator/osm_element_chunks_pool.hpp"
+#include "generator/translator_collection.hpp"
+#include "generator/translator_interface.hpp"
+#include "generator/translators_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace generator;
+
+namespace
+{
+class TestTranslator : public TranslatorInterface
+{
+public:
+  explicit TestTranslator(std::shared_ptr<uint64_t> const & saved) : m_saved(saved) {}
+
+  // TranslatorInterface overrides:
+  std::shared_ptr<TranslatorInterface> Clone() const override
+  {
+    return std::make_shared<TestTranslator>(m_saved);
+  }
+
+  std::string GetName() const override { return "Test"; }
+
+  void Emit(OsmElement & element) override
+  {
+    // Makes the chunks of the big ids expensive.
+    if (element.m_id % 1000 == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    m_sum += element.m_id;
+  }
+
+  void Finish() override {}
+
+  bool Save() override
+  {
+    *m_saved = m_sum;
+    return true;
+  }
+
+  void Merge(TranslatorInterface const & other) override
+  {
+    m_sum += static_cast<TestTranslator const &>(other).m_sum;
+  }
+
+private:
+  std::shared_ptr<uint64_t> m_saved;
+  uint64_t m_sum = 0;
+};
+}  // namespace
+
+UNIT_TEST(TranslatorsPool_Emit)
+{
+  auto const saved = std::make_shared<uint64_t>(0);
+  auto const chunksPool = std::make_shared<OsmElementChunksPool>();
+  TranslatorsPool pool(std::make_shared<TestTranslator>(saved), 4 /* threadCount */, chunksPool);
+
+  uint64_t expectedSum = 0;
+  uint64_t id = 0;
+  for (size_t i = 0; i < 100; ++i)
+  {
+    auto chunk = chunksPool->Get(i % 10 == 0 ? 1000 : 10);
+    for (auto & element : chunk)
+    {
+      element.m_id = ++id;
+      expectedSum += id;
+    }
+    pool.Emit(std::move(chunk));
+  }
+
+  TEST(pool.Finish(), ());
+  TEST_EQUAL(*saved, expectedSum, ());
+}
+
+UNIT_TEST(TranslatorsPool_EmitCollection)
+{
+  size_t const kTranslatorsCount = 5;
+  auto collection = std::make_shared<TranslatorCollection>();
+  std::vector<std::shared_ptr<uint64_t>> saved;
+  for (size_t i = 0; i < kTranslatorsCount; ++i)
+  {
+    saved.push_back(std::make_shared<uint64_t>(0));
+    collection->Append(std::make_shared<TestTranslator>(saved.back()));
+  }
+
+  auto const times = std::make_shared<OperationsTimes>();
+  collection->SetTimes(times);
+  TranslatorsPool pool(collection, 8 /* threadCount */);
+  uint64_t expectedSum = 0;
+  uint64_t id = 0;
+  for (size_t i = 0; i < 50; ++i)
+  {
+    std::vector<OsmElement> chunk(10);
+    for (auto & element : chunk)
+    {
+      element.m_id = ++id;
+      expectedSum += id;
+    }
+    pool.Emit(std::move(chunk));
+  }
+
+  TEST(pool.Finish(), ());
+  for (auto const & s : saved)
+    TEST_EQUAL(*s, expectedSum, ());
+
+  // The times of all the clones are summed in one item per operation.
+  auto const items = times->GetItems();
+  TEST_EQUAL(items.size(), 3, ());
+  for (auto const & item : items)
+  {
+    TEST_EQUAL(item.m_name, "Translator Test", ());
+    TEST(item.m_operation == "finish" || item.m_operation == "merge" ||
+         item.m_operation == "save", (item.m_operation));
+  }
+}
+
+UNIT_TEST(ForEachIndexInParallel_Nested)
+{
+  size_t const kCount = 16;
+  std::vector<std::atomic<uint32_t>> calls(kCount * kCount);
+  for (auto & c : calls)
+    c = 0;
+
+  ForEachIndexInParallel(kCount, [&](size_t i) {
+    ForEachIndexInParallel(kCount, [&](size_t j) { ++calls[i * kCount + j]; });
+  });
+
+  for (auto const & c : calls)
+    TEST_EQUAL(c, 1, ());
+}
@@ -87,6 +87,7 @@ struct CliCommandOptions
   bool m_generate_streets_features = false;
   bool m_generate_geo_objects_features = false;
   bool m_generate_geocoder_token_index = false;
+  std::string m_geocoder_token_index_to_update;
   bool m_verbose = false;
 };
 
@@ -118,7 +119,8 @@ CliCommandOptions DefineOptions(int argc, char * argv[])
          "File name for process (without 'mwm' ext).")
      ("node_storage",
          po::value(&o.m_node_storage)->default_value("map"),
-         "Type of storage for intermediate points representation. Available: raw, map, mem.")
+         "Type of storage for intermediate points representation. Available: raw, map, mem, "
+         "compressed (requires the nodes sorted by ids).")
      ("preprocess",
          po::value(&o.m_preprocess)->default_value(false),
          "1st pass - create nodes/ways/relations data.")
@@ -176,6 +178,9 @@ CliCommandOptions DefineOptions(int argc, char * argv[])
      ("generate_geocoder_token_index",
          po::value(&o.m_generate_geocoder_token_index)->default_value(false),
          "Generate geocoder token index.")
+     ("geocoder_token_index_to_update",
+         po::value(&o.m_geocoder_token_index_to_update)->default_value(""),
+         "Existing geocoder token index to update: key_value is a diff to apply to it.")
      ("key_value",
          po::value(&o.m_key_value)->default_value(""),
          "Input key-value file (.jsonl or .jsonl.gz).")
@@ -263,7 +268,7 @@ int GeneratorToolMain(int argc, char ** argv)
     DataVersion{options.m_osm_file_name}.DumpToPath(genInfo.m_intermediateDir);
 
     LOG(LINFO, ("Generating intermediate data ...."));
-    if (!GenerateIntermediateData(genInfo))
+    if (!GenerateIntermediateData(genInfo, threadsCount))
       return EXIT_FAILURE;
   }
 
@@ -326,7 +331,7 @@ int GeneratorToolMain(int argc, char ** argv)
       LOG(LINFO, ("Saving geo objects index to", outFile));
       if (!indexer::BuildGeoObjectsIndexFromDataFile(
               locDataFile, outFile, DataVersion::LoadFromPath(path).GetVersionJson(),
-              DataVersion::kFileTag))
+              DataVersion::kFileTag, threadsCount))
       {
         LOG(LCRITICAL, ("Error generating geo objects index."));
         return EXIT_FAILURE;
@@ -345,7 +350,7 @@ int GeneratorToolMain(int argc, char ** argv)
 
       if (!indexer::BuildRegionsIndexFromDataFile(locDataFile, outFile,
                                                   DataVersion::LoadFromPath(path).GetVersionJson(),
-                                                  DataVersion::kFileTag))
+                                                  DataVersion::kFileTag, threadsCount))
       {
         LOG(LCRITICAL, ("Error generating regions index."));
         return EXIT_FAILURE;
@@ -379,7 +384,15 @@ int GeneratorToolMain(int argc, char ** argv)
     }
 
     geocoder::Geocoder geocoder;
-    geocoder.LoadFromJsonl(options.m_key_value, threadsCount);
+    if (options.m_geocoder_token_index_to_update.empty())
+    {
+      geocoder.LoadFromJsonl(options.m_key_value, threadsCount);
+    }
+    else
+    {
+      geocoder.LoadFromBinaryIndex(options.m_geocoder_token_index_to_update);
+      geocoder.ApplyJsonlDiff(options.m_key_value, threadsCount);
+    }
 
     auto const tokenIndexFile = base::JoinPath(path, options.m_output);
     geocoder.SaveToBinaryIndex(tokenIndexFile);
@@ -208,7 +208,7 @@ bool JsonHasBuilding(JsonValue const & json)
 }
 
 boost::optional<indexer::GeoObjectsIndex<IndexReader>> MakeTempGeoObjectsIndex(
-    std::string const & pathToGeoObjectsTmpMwm)
+    std::string const & pathToGeoObjectsTmpMwm, size_t threadsCount)
 {
   auto const dataFile = GetPlatform().TmpPathForFile();
   SCOPE_GUARD(removeDataFile, std::bind(Platform::RemoveFileIfExists, std::cref(dataFile)));
@@ -220,7 +220,9 @@ boost::optional<indexer::GeoObjectsIndex<IndexReader>> MakeTempGeoObjectsIndex(
 
   auto const indexFile = GetPlatform().TmpPathForFile();
   SCOPE_GUARD(removeIndexFile, std::bind(Platform::RemoveFileIfExists, std::cref(indexFile)));
-  if (!indexer::BuildGeoObjectsIndexFromDataFile(dataFile, indexFile, std::string(), DataVersion::kFileTag))
+  if (!indexer::BuildGeoObjectsIndexFromDataFile(dataFile, indexFile, std::string(),
+                                                 DataVersion::kFileTag,
+                                                 static_cast<unsigned int>(threadsCount)))
   {
     LOG(LCRITICAL, ("Error generating geo objects index."));
     return {};
@@ -23,7 +23,7 @@ namespace geo_objects
 using IndexReader = ReaderPtr<Reader>;
 
 boost::optional<indexer::GeoObjectsIndex<IndexReader>> MakeTempGeoObjectsIndex(
-    std::string const & pathToGeoObjectsTmpMwm);
+    std::string const & pathToGeoObjectsTmpMwm, size_t threadsCount = 1);
 
 bool JsonHasBuilding(JsonValue const & json);
 
@@ -45,8 +45,8 @@ bool GeoObjectsGenerator::GenerateGeoObjects()
 
 bool GeoObjectsGenerator::GenerateGeoObjectsPrivate()
 {
-  auto geoObjectIndexFuture =
-      std::async(std::launch::async, MakeTempGeoObjectsIndex, m_pathInGeoObjectsTmpMwm);
+  auto geoObjectIndexFuture = std::async(std::launch::async, MakeTempGeoObjectsIndex,
+                                         m_pathInGeoObjectsTmpMwm, m_threadsCount);
 
   AddBuildingsAndThingsWithHousesThenEnrichAllWithRegionAddresses(
       m_geoObjectMaintainer, m_pathInGeoObjectsTmpMwm, m_verbose, m_threadsCount);
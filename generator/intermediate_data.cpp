@@ -1,11 +1,19 @@
 #include "generator/intermediate_data.hpp"
 
+#include <functional>
+#include <iterator>
 #include <new>
 #include <set>
 #include <string>
 
+#include "coding/byte_stream.hpp"
+#include "coding/varint.hpp"
+
+#include "coding/internal/file_data.hpp"
+
 #include "base/assert.hpp"
 #include "base/checked_cast.hpp"
+#include "base/macros.hpp"
 #include "base/logging.hpp"
 
 #include "defines.hpp"
@@ -18,9 +26,17 @@ namespace cache
 {
 namespace
 {
-size_t const kFlushCount = 1024;
 double const kValueOrder = 1e7;
 string const kShortExtension = ".short";
+string const kCompressedExtension = ".compressed";
+
+// Number of nodes in a block of the compressed node storage.
+size_t const kNodesInCompressedBlock = 256;
+
+// Number of pairs in a block of IndexFileWriter and the maximum size of its sorting buffer:
+// the buffer grows with the number of pairs.
+uint64_t const kElementsInIndexBlock = 64;
+size_t const kIndexSorterBufferSize = 64 * 1024 * 1024;
 
 // An estimation.
 // OSM had around 4.1 billion nodes on 2017-11-08,
@@ -67,8 +83,8 @@ public:
   // PointStorageWriterInterface overrides:
   uint64_t GetNumProcessedPoints() const override { return m_numProcessedPoints; }
 
-private:
-  uint64_t m_numProcessedPoints;
+protected:
+  uint64_t m_numProcessedPoints = 0;
 };
 
 // RawFilePointStorageMmapReader -------------------------------------------------------------------
@@ -117,7 +133,6 @@ public:
 
 private:
   FileWriter m_fileWriter;
-  uint64_t m_numProcessedPoints = 0;
 };
 
 // RawMemPointStorageReader ------------------------------------------------------------------------
@@ -177,7 +192,6 @@ public:
 private:
   FileWriter m_fileWriter;
   vector<LatLon> m_data;
-  uint64_t m_numProcessedPoints = 0;
 };
 
 // MapFilePointStorageReader -----------------------------------------------------------------------
@@ -254,7 +268,134 @@ public:
 
 private:
   FileWriter m_fileWriter;
-  uint64_t m_numProcessedPoints = 0;
+};
+
+// CompressedPointStorage --------------------------------------------------------------------------
+// The nodes are stored in blocks of kNodesInCompressedBlock nodes sorted by ids. A node is
+// the varint delta of its id followed by the zigzag varint deltas of its coordinates,
+// the deltas are taken to the previous node of the block (to the first id and zero
+// coordinates for the first node). The blocks are followed by the block directory and
+// the number of the blocks.
+struct CompressedBlockInfo
+{
+  uint64_t m_firstId = 0;
+  uint64_t m_offset = 0;
+};
+static_assert(sizeof(CompressedBlockInfo) == 16, "Invalid structure size");
+static_assert(std::is_trivially_copyable<CompressedBlockInfo>::value, "");
+
+// CompressedPointStorageReader --------------------------------------------------------------------
+class CompressedPointStorageReader : public PointStorageReaderInterface
+{
+public:
+  explicit CompressedPointStorageReader(string const & name) :
+    m_mmapReader(name + kCompressedExtension)
+  {
+    uint64_t const size = m_mmapReader.Size();
+    uint64_t blocksCount = 0;
+    CHECK_GREATER_OR_EQUAL(size, sizeof(blocksCount), ("Damaged file."));
+    m_mmapReader.Read(size - sizeof(blocksCount), &blocksCount, sizeof(blocksCount));
+
+    uint64_t const directorySize = blocksCount * sizeof(CompressedBlockInfo);
+    CHECK_LESS_OR_EQUAL(directorySize, size - sizeof(blocksCount), ("Damaged file."));
+    m_dataSize = size - sizeof(blocksCount) - directorySize;
+
+    m_blocks.resize(base::checked_cast<size_t>(blocksCount));
+    if (!m_blocks.empty())
+      m_mmapReader.Read(m_dataSize, m_blocks.data(), base::checked_cast<size_t>(directorySize));
+  }
+
+  // PointStorageReaderInterface overrides:
+  bool GetPoint(uint64_t id, double & lat, double & lon) const override
+  {
+    auto const next = upper_bound(m_blocks.cbegin(), m_blocks.cend(), id,
+                                  [](uint64_t id, CompressedBlockInfo const & block) {
+                                    return id < block.m_firstId;
+                                  });
+    if (next == m_blocks.cbegin())
+      return false;
+
+    auto const & block = *prev(next);
+    auto const endOffset = next == m_blocks.cend() ? m_dataSize : next->m_offset;
+    uint8_t const * const end = m_mmapReader.Data() + endOffset;
+
+    ArrayByteSource src(m_mmapReader.Data() + block.m_offset);
+    uint64_t currentId = block.m_firstId;
+    LatLon ll;
+    while (src.PtrUC() < end)
+    {
+      currentId += ReadVarUint<uint64_t>(src);
+      ll.m_lat = static_cast<int32_t>(ll.m_lat + ReadVarInt<int64_t>(src));
+      ll.m_lon = static_cast<int32_t>(ll.m_lon + ReadVarInt<int64_t>(src));
+      if (currentId < id)
+        continue;
+      if (currentId > id)
+        return false;
+
+      bool ret = FromLatLon(ll, lat, lon);
+      if (!ret)
+        LOG(LERROR, ("Node with id =", id, "not found!"));
+      return ret;
+    }
+    return false;
+  }
+
+private:
+  MmapReader m_mmapReader;
+  uint64_t m_dataSize = 0;
+  vector<CompressedBlockInfo> m_blocks;
+};
+
+// CompressedPointStorageWriter --------------------------------------------------------------------
+class CompressedPointStorageWriter : public PointStorageWriterBase
+{
+public:
+  explicit CompressedPointStorageWriter(string const & name) :
+    m_fileWriter(name + kCompressedExtension)
+  {
+  }
+
+  ~CompressedPointStorageWriter()
+  {
+    if (!m_blocks.empty())
+      m_fileWriter.Write(m_blocks.data(), m_blocks.size() * sizeof(CompressedBlockInfo));
+    uint64_t const blocksCount = m_blocks.size();
+    m_fileWriter.Write(&blocksCount, sizeof(blocksCount));
+  }
+
+  // PointStorageWriterInterface overrides:
+  void AddPoint(uint64_t id, double lat, double lon) override
+  {
+    LatLon ll;
+    ToLatLon(lat, lon, ll);
+
+    if (m_numProcessedPoints != 0)
+    {
+      CHECK_GREATER(id, m_prevId, ("Compressed node storage requires the nodes sorted by ids,",
+                                   "use another node storage for an unsorted source."));
+    }
+
+    if (m_numProcessedPoints % kNodesInCompressedBlock == 0)
+    {
+      m_blocks.push_back({id, m_fileWriter.Pos()});
+      m_prevId = id;
+      m_prev = LatLon{};
+    }
+
+    WriteVarUint(m_fileWriter, id - m_prevId);
+    WriteVarInt(m_fileWriter, int64_t{ll.m_lat} - m_prev.m_lat);
+    WriteVarInt(m_fileWriter, int64_t{ll.m_lon} - m_prev.m_lon);
+    m_prevId = id;
+    m_prev = ll;
+
+    ++m_numProcessedPoints;
+  }
+
+private:
+  FileWriter m_fileWriter;
+  vector<CompressedBlockInfo> m_blocks;
+  uint64_t m_prevId = 0;
+  LatLon m_prev;
 };
 
 IndexFileReader const & GetOrCreateIndexReader(string const & name, bool forceReload)
@@ -269,6 +410,20 @@ IndexFileReader const & GetOrCreateIndexReader(string const & name, bool forceRe
   return indexes[name];
 }
 
+shared_ptr<OSMElementCacheReader const>
+GetOrCreateElementCacheReader(string const & name, bool preload, bool forceReload)
+{
+  static mutex m;
+  static unordered_map<string, shared_ptr<OSMElementCacheReader const>> readers;
+
+  lock_guard<mutex> lock(m);
+  auto & reader = readers[name];
+  if (forceReload || !reader)
+    reader = make_shared<OSMElementCacheReader>(name, preload, forceReload);
+
+  return reader;
+}
+
 PointStorageReaderInterface const &
 GetOrCreatePointStorageReader(feature::GenerateInfo::NodeStorageType type, string const & name,
                               bool forceReload)
@@ -288,82 +443,161 @@ GetOrCreatePointStorageReader(feature::GenerateInfo::NodeStorageType type, strin
 // IndexFileReader ---------------------------------------------------------------------------------
 IndexFileReader::IndexFileReader(string const & name)
 {
-  FileReader fileReader(name);
-  m_elements.clear();
-  size_t const fileSize = fileReader.Size();
-  if (fileSize == 0)
+  uint64_t size = 0;
+  CHECK(base::GetFileSize(name, size), ("Can't open file:", name));
+  if (size == 0)
     return;
 
-  LOG_SHORT(LINFO, ("Offsets reading is started for file", fileReader.GetName()));
-  CHECK_EQUAL(0, fileSize % sizeof(Element), ("Damaged file."));
+  m_mmapReader = make_unique<MmapReader>(name);
+  uint64_t blocksCount = 0;
+  CHECK_GREATER_OR_EQUAL(size, sizeof(blocksCount), ("Damaged file", name));
+  m_mmapReader->Read(size - sizeof(blocksCount), &blocksCount, sizeof(blocksCount));
 
-  try
-  {
-    m_elements.resize(base::checked_cast<size_t>(fileSize / sizeof(Element)));
-  }
-  catch (bad_alloc const &)
-  {
-    LOG(LCRITICAL, ("Insufficient memory for required offset map"));
-  }
+  uint64_t const directorySize = blocksCount * sizeof(BlockInfo);
+  CHECK_LESS_OR_EQUAL(directorySize, size - sizeof(blocksCount), ("Damaged file", name));
+  m_dataSize = size - sizeof(blocksCount) - directorySize;
 
-  fileReader.Read(0, &m_elements[0], base::checked_cast<size_t>(fileSize));
+  m_blocks.resize(base::checked_cast<size_t>(blocksCount));
+  if (!m_blocks.empty())
+    m_mmapReader->Read(m_dataSize, m_blocks.data(), base::checked_cast<size_t>(directorySize));
+}
 
-  sort(m_elements.begin(), m_elements.end(), ElementComparator());
+bool IndexFileReader::GetValueByKey(Key key, Value & value) const
+{
+  bool found = false;
+  ForEachByKey(key, [&](Value v) {
+    value = v;
+    found = true;
+    return base::ControlFlow::Break;
+  });
+  return found;
+}
 
-  LOG_SHORT(LINFO, ("Offsets reading is finished"));
+size_t IndexFileReader::FindFirstBlock(Key key) const
+{
+  // The pairs with |key| may start at the end of the block before the first block
+  // which begins with |key|.
+  auto it = lower_bound(m_blocks.cbegin(), m_blocks.cend(), key,
+                        [](BlockInfo const & block, Key key) { return block.m_firstKey < key; });
+  if (it != m_blocks.cbegin())
+    --it;
+  return static_cast<size_t>(distance(m_blocks.cbegin(), it));
 }
 
-bool IndexFileReader::GetValueByKey(Key key, Value & value) const
+// IndexFileWriter::Encoder ------------------------------------------------------------------------
+class IndexFileWriter::Encoder
 {
-  auto it = lower_bound(m_elements.begin(), m_elements.end(), key, ElementComparator());
-  if (it != m_elements.end() && it->first == key)
+public:
+  explicit Encoder(string const & name) : m_fileWriter(name) {}
+
+  void operator()(Element const & element)
   {
-    value = it->second;
-    return true;
+    if (m_count % kElementsInIndexBlock == 0)
+    {
+      m_blocks.push_back({element.first, m_fileWriter.Pos()});
+      m_prevKey = element.first;
+      m_prevValue = 0;
+    }
+
+    CHECK_GREATER_OR_EQUAL(element.first, m_prevKey, ());
+    WriteVarUint(m_fileWriter, element.first - m_prevKey);
+    WriteVarInt(m_fileWriter, static_cast<int64_t>(element.second - m_prevValue));
+    m_prevKey = element.first;
+    m_prevValue = element.second;
+    ++m_count;
   }
-  return false;
-}
+
+  void Finish()
+  {
+    if (!m_blocks.empty())
+      m_fileWriter.Write(m_blocks.data(), m_blocks.size() * sizeof(BlockInfo));
+    uint64_t const blocksCount = m_blocks.size();
+    m_fileWriter.Write(&blocksCount, sizeof(blocksCount));
+  }
+
+private:
+  using BlockInfo = IndexFileReader::BlockInfo;
+
+  FileWriter m_fileWriter;
+  vector<BlockInfo> m_blocks;
+  uint64_t m_count = 0;
+  Key m_prevKey = 0;
+  Value m_prevValue = 0;
+};
 
 // IndexFileWriter ---------------------------------------------------------------------------------
-IndexFileWriter::IndexFileWriter(string const & name) :
-  m_fileWriter(name.c_str())
+IndexFileWriter::IndexFileWriter(string const & name, unsigned int threadsCount)
+  : m_name(name)
+  , m_encoder(make_unique<Encoder>(name))
+  , m_sorter(make_unique<FileSorter<Element, Encoder>>(kIndexSorterBufferSize, name + EXTENSION_TMP,
+                                                       *m_encoder, less<Element>(), threadsCount))
 {
 }
 
-void IndexFileWriter::WriteAll()
+IndexFileWriter::~IndexFileWriter()
 {
-  if (m_elements.empty())
+  if (!m_sorter)
     return;
 
-  m_fileWriter.Write(&m_elements[0], m_elements.size() * sizeof(Element));
-  m_elements.clear();
+  LOG(LWARNING, ("The index is not written explicitly:", m_name));
+  try
+  {
+    WriteAll();
+  }
+  catch (RootException const & e)
+  {
+    LOG(LERROR, ("Can't write the index", m_name, e.Msg()));
+  }
+  catch (std::exception const & e)
+  {
+    LOG(LERROR, ("Can't write the index", m_name, e.what()));
+  }
+}
+
+void IndexFileWriter::WriteAll()
+{
+  CHECK(m_sorter, ("The index is written already:", m_name));
+  m_sorter->SortAndFinish();
+  m_sorter.reset();
+  m_encoder->Finish();
+  m_encoder.reset();
 }
 
 void IndexFileWriter::Add(Key k, Value const & v)
 {
-  if (m_elements.size() > kFlushCount)
-    WriteAll();
-
-  m_elements.emplace_back(k, v);
+  m_sorter->Add({k, v});
 }
 
 // OSMElementCacheReader ---------------------------------------------------------------------------
 OSMElementCacheReader::OSMElementCacheReader(string const & name, bool preload, bool forceReload)
-  : m_fileReader(name)
-  , m_offsetsReader(GetOrCreateIndexReader(name + OFFSET_EXT, forceReload))
+  : m_offsetsReader(GetOrCreateIndexReader(name + OFFSET_EXT, forceReload))
   , m_name(name)
-  , m_preload(preload)
 {
-  if (!m_preload)
+  uint64_t size = 0;
+  CHECK(base::GetFileSize(name, size), ("Can't open file:", name));
+  if (size == 0)
+    return;
+
+  m_mmapReader = make_unique<MmapReader>(name);
+  if (!preload)
     return;
-  size_t sz = m_fileReader.Size();
-  m_data.resize(sz);
-  m_fileReader.Read(0, m_data.data(), sz);
+
+  // Fault in the pages so that the lookups do not wait for the disk.
+  size_t const kPageSize = 4096;
+  uint8_t const * data = m_mmapReader->Data();
+  uint8_t volatile sum = 0;
+  for (uint64_t pos = 0; pos < size; pos += kPageSize)
+    sum += data[pos];
+  UNUSED_VALUE(sum);
 }
 
 // OSMElementCacheWriter ---------------------------------------------------------------------------
-OSMElementCacheWriter::OSMElementCacheWriter(string const & name, bool preload)
-  : m_fileWriter(name), m_offsets(name + OFFSET_EXT), m_name(name), m_preload(preload)
+OSMElementCacheWriter::OSMElementCacheWriter(string const & name, bool preload,
+                                             unsigned int threadsCount)
+  : m_fileWriter(name)
+  , m_offsets(name + OFFSET_EXT, threadsCount)
+  , m_name(name)
+  , m_preload(preload)
 {
 }
 
@@ -373,20 +607,23 @@ void OSMElementCacheWriter::SaveOffsets() { m_offsets.WriteAll(); }
 IntermediateDataReader::IntermediateDataReader(PointStorageReaderInterface const & nodes,
                                                feature::GenerateInfo const & info, bool forceReload)
   : m_nodes(nodes)
-  , m_ways(info.GetIntermediateFileName(WAYS_FILE), info.m_preloadCache, forceReload)
-  , m_relations(info.GetIntermediateFileName(RELATIONS_FILE), info.m_preloadCache, forceReload)
+  , m_ways(GetOrCreateElementCacheReader(info.GetIntermediateFileName(WAYS_FILE),
+                                          info.m_preloadCache, forceReload))
+  , m_relations(GetOrCreateElementCacheReader(info.GetIntermediateFileName(RELATIONS_FILE),
+                                               info.m_preloadCache, forceReload))
   , m_nodeToRelations(GetOrCreateIndexReader(info.GetIntermediateFileName(NODES_FILE, ID2REL_EXT), forceReload))
   , m_wayToRelations(GetOrCreateIndexReader(info.GetIntermediateFileName(WAYS_FILE, ID2REL_EXT), forceReload))
 {}
 
 // IntermediateDataWriter
 IntermediateDataWriter::IntermediateDataWriter(PointStorageWriterInterface & nodes,
-                                               feature::GenerateInfo const & info)
+                                               feature::GenerateInfo const & info,
+                                               unsigned int threadsCount)
   : m_nodes(nodes)
-  , m_ways(info.GetIntermediateFileName(WAYS_FILE), info.m_preloadCache)
-  , m_relations(info.GetIntermediateFileName(RELATIONS_FILE), info.m_preloadCache)
-  , m_nodeToRelations(info.GetIntermediateFileName(NODES_FILE, ID2REL_EXT))
-  , m_wayToRelations(info.GetIntermediateFileName(WAYS_FILE, ID2REL_EXT))
+  , m_ways(info.GetIntermediateFileName(WAYS_FILE), info.m_preloadCache, threadsCount)
+  , m_relations(info.GetIntermediateFileName(RELATIONS_FILE), info.m_preloadCache, threadsCount)
+  , m_nodeToRelations(info.GetIntermediateFileName(NODES_FILE, ID2REL_EXT), threadsCount)
+  , m_wayToRelations(info.GetIntermediateFileName(WAYS_FILE, ID2REL_EXT), threadsCount)
 {}
 
 void IntermediateDataWriter::AddRelation(Key id, RelationElement const & e)
@@ -423,6 +660,8 @@ CreatePointStorageReader(feature::GenerateInfo::NodeStorageType type, string con
     return make_unique<MapFilePointStorageReader>(name);
   case feature::GenerateInfo::NodeStorageType::Memory:
     return make_unique<RawMemPointStorageReader>(name);
+  case feature::GenerateInfo::NodeStorageType::Compressed:
+    return make_unique<CompressedPointStorageReader>(name);
   }
   UNREACHABLE();
 }
@@ -438,6 +677,8 @@ CreatePointStorageWriter(feature::GenerateInfo::NodeStorageType type, string con
     return make_unique<MapFilePointStorageWriter>(name);
   case feature::GenerateInfo::NodeStorageType::Memory:
     return make_unique<RawMemPointStorageWriter>(name);
+  case feature::GenerateInfo::NodeStorageType::Compressed:
+    return make_unique<CompressedPointStorageWriter>(name);
   }
   UNREACHABLE();
 }
@@ -3,9 +3,12 @@
 #include "generator/generate_info.hpp"
 #include "generator/intermediate_elements.hpp"
 
+#include "coding/byte_stream.hpp"
 #include "coding/file_reader.hpp"
+#include "coding/file_sort.hpp"
 #include "coding/file_writer.hpp"
 #include "coding/mmap_reader.hpp"
+#include "coding/varint.hpp"
 
 #include "base/assert.hpp"
 #include "base/control_flow.hpp"
@@ -15,6 +18,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <mutex>
@@ -70,6 +74,8 @@ public:
   virtual bool GetPoint(uint64_t id, double & lat, double & lon) const = 0;
 };
 
+// Index of (key, value) pairs sorted by keys and values. The pairs are delta coded in blocks
+// of a fixed size and the file is mapped, only the first keys of the blocks are kept in memory.
 class IndexFileReader
 {
 public:
@@ -83,56 +89,80 @@ public:
   template <typename ToDo>
   void ForEachByKey(Key k, ToDo && toDo) const
   {
-    auto range = std::equal_range(m_elements.begin(), m_elements.end(), k, ElementComparator());
-    for (; range.first != range.second; ++range.first)
+    for (auto block = FindFirstBlock(k); block < m_blocks.size(); ++block)
     {
-      if (toDo((*range.first).second) == base::ControlFlow::Break)
-        break;
+      uint8_t const * const data = m_mmapReader->Data();
+      uint64_t const endOffset =
+          block + 1 == m_blocks.size() ? m_dataSize : m_blocks[block + 1].m_offset;
+      ArrayByteSource src(data + m_blocks[block].m_offset);
+      Key key = m_blocks[block].m_firstKey;
+      Value value = 0;
+      while (src.PtrUC() < data + endOffset)
+      {
+        key += ReadVarUint<uint64_t>(src);
+        value += static_cast<Value>(ReadVarInt<int64_t>(src));
+        if (key < k)
+          continue;
+        if (key > k || toDo(value) == base::ControlFlow::Break)
+          return;
+      }
     }
   }
 
 private:
-  using Element = std::pair<Key, Value>;
+  friend class IndexFileWriter;
 
-  struct ElementComparator
+  struct BlockInfo
   {
-    bool operator()(Element const & r1, Element const & r2) const
-    {
-      return ((r1.first == r2.first) ? r1.second < r2.second : r1.first < r2.first);
-    }
-    bool operator()(Element const & r1, Key r2) const { return (r1.first < r2); }
-    bool operator()(Key r1, Element const & r2) const { return (r1 < r2.first); }
+    Key m_firstKey = 0;
+    uint64_t m_offset = 0;
   };
 
-  std::vector<Element> m_elements;
-};
+  // Returns the first block which may contain |key|.
+  size_t FindFirstBlock(Key key) const;
 
+  // Not set for an empty file which can not be mapped.
+  std::unique_ptr<MmapReader> m_mmapReader;
+  uint64_t m_dataSize = 0;
+  std::vector<BlockInfo> m_blocks;
+};
 
+// Collects (key, value) pairs in any order. The pairs are sorted on disk and encoded
+// for IndexFileReader by WriteAll.
 class IndexFileWriter
 {
 public:
   using Value = uint64_t;
 
-  explicit IndexFileWriter(std::string const & name);
+  // The buffered pairs are sorted by |threadsCount| threads before they are flushed.
+  explicit IndexFileWriter(std::string const & name, unsigned int threadsCount = 1);
+  ~IndexFileWriter();
 
+  // Writes the index, must be called after all the pairs are added.
   void WriteAll();
   void Add(Key k, Value const & v);
 
 private:
   using Element = std::pair<Key, Value>;
 
-  std::vector<Element> m_elements;
-  FileWriter m_fileWriter;
+  class Encoder;
+
+  std::string m_name;
+  std::unique_ptr<Encoder> m_encoder;
+  std::unique_ptr<FileSorter<Element, Encoder>> m_sorter;
 };
 
+// Reads the values from the mapped cache file. The reader is immutable so a single
+// instance is shared by all the threads, see IntermediateData.
 class OSMElementCacheReader
 {
 public:
+  // |preload| touches all the pages of the file when it is opened.
   explicit OSMElementCacheReader(std::string const & name, bool preload = false,
                                  bool forceReload = false);
 
   template <class Value>
-  bool Read(Key id, Value & value)
+  bool Read(Key id, Value & value) const
   {
     uint64_t pos = 0;
     if (!m_offsetsReader.GetValueByKey(id, pos))
@@ -141,35 +171,30 @@ public:
       return false;
     }
 
-    uint32_t valueSize = m_preload ? *(reinterpret_cast<uint32_t *>(m_data.data() + pos)) : 0;
-    size_t offset = pos + sizeof(uint32_t);
-
-    if (!m_preload)
-    {
-      // in case not-in-memory work we read buffer
-      m_fileReader.Read(pos, &valueSize, sizeof(valueSize));
-      m_data.resize(valueSize);
-      m_fileReader.Read(pos + sizeof(valueSize), m_data.data(), valueSize);
-      offset = 0;
-    }
+    CHECK(m_mmapReader, ("Empty file", m_name));
+    CHECK_LESS_OR_EQUAL(pos + sizeof(uint32_t), m_mmapReader->Size(), (m_name, id));
+    uint8_t const * data = m_mmapReader->Data() + pos;
+    uint32_t valueSize = 0;
+    std::memcpy(&valueSize, data, sizeof(valueSize));
+    CHECK_LESS_OR_EQUAL(pos + sizeof(uint32_t) + valueSize, m_mmapReader->Size(), (m_name, id));
 
-    MemReader reader(m_data.data() + offset, valueSize);
+    MemReader reader(data + sizeof(valueSize), valueSize);
     value.Read(reader);
     return true;
   }
 
 protected:
-  FileReader m_fileReader;
+  // Not set for an empty file which can not be mapped.
+  std::unique_ptr<MmapReader> m_mmapReader;
   IndexFileReader const & m_offsetsReader;
   std::string m_name;
-  std::vector<uint8_t> m_data;
-  bool m_preload = false;
 };
 
 class OSMElementCacheWriter
 {
 public:
-  explicit OSMElementCacheWriter(std::string const & name, bool preload = false);
+  explicit OSMElementCacheWriter(std::string const & name, bool preload = false,
+                                 unsigned int threadsCount = 1);
 
   template <typename Value>
   void Write(Key id, Value const & value)
@@ -204,31 +229,31 @@ public:
 
   // TODO |GetNode()|, |lat|, |lon| are used as y, x in real.
   bool GetNode(Key id, double & lat, double & lon) const { return m_nodes.GetPoint(id, lat, lon); }
-  bool GetWay(Key id, WayElement & e) { return m_ways.Read(id, e); }
+  bool GetWay(Key id, WayElement & e) const { return m_ways->Read(id, e); }
 
   template <typename ToDo>
   void ForEachRelationByWay(Key id, ToDo && toDo)
   {
-    RelationProcessor<ToDo> processor(m_relations, std::forward<ToDo>(toDo));
+    RelationProcessor<ToDo> processor(*m_relations, std::forward<ToDo>(toDo));
     m_wayToRelations.ForEachByKey(id, processor);
   }
 
   template <typename ToDo>
   void ForEachRelationByWayCached(Key id, ToDo && toDo)
   {
-    CachedRelationProcessor<ToDo> processor(m_relations, std::forward<ToDo>(toDo));
+    CachedRelationProcessor<ToDo> processor(*m_relations, std::forward<ToDo>(toDo));
     m_wayToRelations.ForEachByKey(id, processor);
   }
 
   template <typename ToDo>
   void ForEachRelationByNodeCached(Key id, ToDo && toDo)
   {
-    CachedRelationProcessor<ToDo> processor(m_relations, std::forward<ToDo>(toDo));
+    CachedRelationProcessor<ToDo> processor(*m_relations, std::forward<ToDo>(toDo));
     m_nodeToRelations.ForEachByKey(id, processor);
   }
 
 private:
-  using CacheReader = cache::OSMElementCacheReader;
+  using CacheReader = cache::OSMElementCacheReader const;
 
   template <typename Element, typename ToDo>
   class ElementProcessorBase
@@ -265,8 +290,9 @@ private:
   };
 
   PointStorageReaderInterface const & m_nodes;
-  cache::OSMElementCacheReader m_ways;
-  cache::OSMElementCacheReader m_relations;
+  // The readers are shared by all the clones of IntermediateData.
+  std::shared_ptr<cache::OSMElementCacheReader const> m_ways;
+  std::shared_ptr<cache::OSMElementCacheReader const> m_relations;
   cache::IndexFileReader const & m_nodeToRelations;
   cache::IndexFileReader const & m_wayToRelations;
 };
@@ -274,7 +300,8 @@ private:
 class IntermediateDataWriter
 {
 public:
-  IntermediateDataWriter(PointStorageWriterInterface & nodes, feature::GenerateInfo const & info);
+  IntermediateDataWriter(PointStorageWriterInterface & nodes, feature::GenerateInfo const & info,
+                         unsigned int threadsCount = 1);
 
   void AddNode(Key id, double lat, double lon) { m_nodes.AddPoint(id, lat, lon); }
   void AddWay(Key id, WayElement const & e) { m_ways.Write(id, e); }
@@ -1,57 +1,209 @@
 #include "generator/key_value_storage.hpp"
 
+#include "coding/file_writer.hpp"
 #include "coding/reader.hpp"
+#include "coding/write_to_sink.hpp"
+
+#include "coding/internal/file_data.hpp"
 
 #include "base/exception.hpp"
 #include "base/logging.hpp"
+#include "base/string_utils.hpp"
 
 #include <algorithm>
-#include <cstring>
 #include <iomanip>
+#include <list>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/crc.hpp>
 
+#include "defines.hpp"
 
 namespace generator
 {
+namespace
+{
+// The trailer of the binary storage: the size of the values, the number of the keys,
+// the size and the checksum of the jsonl file the storage is built from.
+size_t const kTrailerSize = 4 * sizeof(uint64_t);
+
+uint64_t GetChecksum(MmapReader const & reader)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(reader.Data(), static_cast<size_t>(reader.Size()));
+  return crc.checksum();
+}
+
+uint64_t GetChecksum(std::string const & path, uint64_t size)
+{
+  // An empty file can not be mapped.
+  return size == 0 ? boost::crc_32_type().checksum() : GetChecksum(MmapReader(path));
+}
+}  // namespace
+
+// KeyValueStorage::ValuesCache --------------------------------------------------------------------
+class KeyValueStorage::ValuesCache
+{
+public:
+  explicit ValuesCache(size_t capacity) : m_capacity{capacity} {}
+
+  std::shared_ptr<JsonValue> Find(uint64_t key)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto const it = m_index.find(key);
+    if (it == m_index.end())
+      return {};
+
+    m_values.splice(m_values.begin(), m_values, it->second);
+    return it->second->second;
+  }
+
+  void Insert(uint64_t key, std::shared_ptr<JsonValue> const & value)
+  {
+    if (m_capacity == 0)
+      return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_index.count(key) != 0)
+      return;
+
+    m_values.emplace_front(key, value);
+    m_index.emplace(key, m_values.begin());
+    if (m_values.size() > m_capacity)
+    {
+      m_index.erase(m_values.back().first);
+      m_values.pop_back();
+    }
+  }
+
+private:
+  using Values = std::list<std::pair<uint64_t, std::shared_ptr<JsonValue>>>;
+
+  size_t const m_capacity;
+  std::mutex m_mutex;
+  // The values from the most recently used.
+  Values m_values;
+  std::unordered_map<uint64_t, Values::iterator> m_index;
+};
+
+// KeyValueStorage ---------------------------------------------------------------------------------
 KeyValueStorage::KeyValueStorage(std::string const & path, size_t cacheValuesCountLimit,
                                  std::function<bool(KeyValue const &)> const & pred)
-  : m_storage{path, std::ios_base::in | std::ios_base::out | std::ios_base::app}
-  , m_cacheValuesCountLimit{cacheValuesCountLimit}
+  : m_pred{pred}
+  , m_cache{std::make_unique<ValuesCache>(cacheValuesCountLimit)}
+{
+  if (!IsBinaryUpToDate(path))
+    BuildBinary(path);
+
+  m_mmapReader = std::make_unique<MmapReader>(path + KEY_VALUE_BINARY_EXT);
+  auto const size = m_mmapReader->Size();
+  uint64_t trailer[4];
+  m_mmapReader->Read(size - kTrailerSize, trailer, kTrailerSize);
+  m_valuesSize = trailer[0];
+  m_entriesCount = static_cast<size_t>(trailer[1]);
+
+  auto const entriesOffset = (m_valuesSize + sizeof(uint64_t) - 1) / sizeof(uint64_t) *
+                             sizeof(uint64_t);
+  CHECK_EQUAL(entriesOffset + m_entriesCount * sizeof(Entry) + kTrailerSize, size,
+              ("Damaged file", path + KEY_VALUE_BINARY_EXT));
+  m_entries = reinterpret_cast<Entry const *>(m_mmapReader->Data() + entriesOffset);
+}
+
+KeyValueStorage::~KeyValueStorage() = default;
+
+KeyValueStorage::KeyValueStorage(KeyValueStorage &&) = default;
+
+KeyValueStorage & KeyValueStorage::operator=(KeyValueStorage &&) = default;
+
+// static
+bool KeyValueStorage::IsBinaryUpToDate(std::string const & kvPath)
 {
-  if (!m_storage)
-    MYTHROW(Reader::OpenException, ("Failed to open file", path));
+  uint64_t kvSize = 0;
+  if (!base::GetFileSize(kvPath, kvSize))
+    MYTHROW(Reader::OpenException, ("Failed to open file", kvPath));
+
+  auto const binaryPath = kvPath + KEY_VALUE_BINARY_EXT;
+  uint64_t binarySize = 0;
+  if (!base::GetFileSize(binaryPath, binarySize) || binarySize < kTrailerSize)
+    return false;
+
+  MmapReader reader(binaryPath);
+  uint64_t builtFrom[2];
+  reader.Read(binarySize - sizeof(builtFrom), builtFrom, sizeof(builtFrom));
+  // The checksum is computed only for a file of the same size.
+  return builtFrom[0] == kvSize && builtFrom[1] == GetChecksum(kvPath, kvSize);
+}
+
+// static
+void KeyValueStorage::BuildBinary(std::string const & kvPath)
+{
+  struct Line
+  {
+    uint64_t m_key;
+    uint64_t m_valueOffset;
+    uint64_t m_valueSize;
+  };
 
+  std::ifstream kv{kvPath};
+  if (!kv)
+    MYTHROW(Reader::OpenException, ("Failed to open file", kvPath));
+
+  std::vector<Line> lines;
   std::string line;
   std::streamoff lineNumber = 0;
-  while (std::getline(m_storage, line))
+  uint64_t lineOffset = 0;
+  while (std::getline(kv, line))
   {
     ++lineNumber;
 
     uint64_t key;
     auto value = std::string{};
-    if (!ParseKeyValueLine(line, lineNumber, key, value))
-      continue;
+    if (ParseKeyValueLine(line, lineNumber, key, value))
+      lines.push_back({key, lineOffset + line.size() - value.size(), value.size()});
+    lineOffset += line.size() + 1;
+  }
 
-    std::shared_ptr<JsonValue> json;
-    try
-    {
-      json = std::make_shared<JsonValue>(base::LoadFromString(value));
-    }
-    catch (base::Json::Exception const & e)
+  std::stable_sort(lines.begin(), lines.end(),
+                   [](Line const & lhs, Line const & rhs) { return lhs.m_key < rhs.m_key; });
+  lines.erase(std::unique(lines.begin(), lines.end(),
+                          [](Line const & lhs, Line const & rhs) { return lhs.m_key == rhs.m_key; }),
+              lines.end());
+
+  uint64_t kvSize = 0;
+  CHECK(base::GetFileSize(kvPath, kvSize), (kvPath));
+  auto const binaryPath = kvPath + KEY_VALUE_BINARY_EXT;
+  // The storages of the same file may be built concurrently by several processes:
+  // each one writes its own file, the renaming is atomic.
+  auto const tmpPath = binaryPath + "." + strings::to_string(std::random_device()()) +
+                       EXTENSION_TMP;
+  {
+    FileWriter writer{tmpPath};
+    std::vector<Entry> entries;
+    entries.reserve(lines.size());
+    std::unique_ptr<MmapReader> reader;
+    if (kvSize != 0)
+      reader = std::make_unique<MmapReader>(kvPath);
+    for (auto const & l : lines)
     {
-      LOG(LWARNING, ("Cannot create base::Json in line", lineNumber, ":", e.Msg()));
-      continue;
+      entries.push_back({l.m_key, writer.Pos()});
+      writer.Write(reader->Data() + l.m_valueOffset, static_cast<size_t>(l.m_valueSize));
     }
 
-    if (!pred({key, json}))
-      continue;
-
-    if (m_cacheValuesCountLimit <= m_values.size())
-      m_values.emplace(key, std::move(value));
-    else
-      m_values.emplace(key, std::move(json));
+    // The table of the keys is aligned to be read in place.
+    uint64_t const valuesSize = writer.Pos();
+    WriteZeroesToSink(writer, (sizeof(uint64_t) - valuesSize % sizeof(uint64_t)) % sizeof(uint64_t));
+    if (!entries.empty())
+      writer.Write(entries.data(), entries.size() * sizeof(Entry));
+    uint64_t const trailer[] = {valuesSize, entries.size(), kvSize,
+                                reader ? GetChecksum(*reader) : GetChecksum(kvPath, kvSize)};
+    writer.Write(trailer, sizeof(trailer));
   }
+  CHECK(base::RenameFileX(tmpPath, binaryPath), (tmpPath, binaryPath));
 
-  m_storage.clear();
+  LOG(LINFO, ("Binary key-value storage", binaryPath, "is built:", lines.size(), "keys."));
 }
 
 // static
@@ -88,36 +240,36 @@ std::string KeyValueStorage::SerializeFullLine(uint64_t key, JsonValue && value)
   return result.str();
 }
 
-void KeyValueStorage::Insert(uint64_t key, JsonValue && value)
-{
-  auto json = Serialize(value);
-
-  CHECK(!json.empty(), ());
-
-  auto emplaceResult = m_values.emplace(key, std::move(json));
-
-  if (!emplaceResult.second)  // it is ok for OSM relation with several outer borders
-    return;
-
-  auto const & emplaceIterator = emplaceResult.first;
-  auto const & result = boost::get<std::string>(emplaceIterator->second);
-
-  m_storage << SerializeDref(key) << " " << result << "\n";
-}
-
 std::shared_ptr<JsonValue> KeyValueStorage::Find(uint64_t key) const
 {
-  auto const it = m_values.find(key);
-  if (it == std::end(m_values))
+  if (auto json = m_cache->Find(key))
+    return json;
+
+  auto const end = m_entries + m_entriesCount;
+  auto const it = std::lower_bound(m_entries, end, key, [](Entry const & entry, uint64_t key) {
+    return entry.m_key < key;
+  });
+  if (it == end || it->m_key != key)
     return {};
 
-  if (auto json = boost::get<std::shared_ptr<JsonValue>>(&it->second))
-    return *json;
+  auto const valueEnd = std::next(it) == end ? m_valuesSize : std::next(it)->m_offset;
+  auto const value = reinterpret_cast<char const *>(m_mmapReader->Data() + it->m_offset);
+  std::shared_ptr<JsonValue> json;
+  try
+  {
+    json = std::make_shared<JsonValue>(
+        base::LoadFromString(std::string(value, static_cast<size_t>(valueEnd - it->m_offset))));
+  }
+  catch (base::Json::Exception const & e)
+  {
+    LOG(LWARNING, ("Cannot create base::Json for key", SerializeDref(key), ":", e.Msg()));
+    return {};
+  }
 
-  auto const & jsonString = boost::get<std::string>(it->second);
+  if (!m_pred({key, json}))
+    return {};
 
-  auto json = std::make_shared<JsonValue>(base::LoadFromString(jsonString));
-  CHECK(json, ());
+  m_cache->Insert(key, json);
   return json;
 }
 
@@ -129,5 +281,5 @@ std::string KeyValueStorage::SerializeDref(uint64_t number)
   return stream.str();
 }
 
-size_t KeyValueStorage::Size() const { return m_values.size(); }
+size_t KeyValueStorage::Size() const { return m_entriesCount; }
 }  // namespace generator
@@ -1,15 +1,15 @@
 #pragma once
 
+#include "coding/mmap_reader.hpp"
+
 #include <cstdint>
 #include <fstream>
 #include <functional>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <utility>
 
 #include <boost/optional.hpp>
-#include <boost/variant.hpp>
 
 #include "3party/jansson/myjansson.hpp"
 
@@ -34,6 +34,9 @@ private:
 
 using KeyValue = std::pair<uint64_t, std::shared_ptr<JsonValue>>;
 
+// Read-only storage of the values of a jsonl key-value file. The file is converted to
+// the binary storage (see BuildBinary()) which is mapped, the values are decoded on demand
+// by Find() and the last decoded values are kept in the LRU cache.
 class KeyValueStorage
 {
 public:
@@ -44,20 +47,32 @@ public:
   // https://jira.mail.ru/browse/MAPSB2B-41
   static uint32_t constexpr kDefaultPrecision = 9;
 
+  // |cacheValuesCountLimit| is the capacity of the cache of the decoded values.
+  // The binary storage of |kvPath| is built if it is absent or built from another content
+  // of the file. The producers of the file build it explicitly (see BuildBinary()) so that
+  // the storage can be opened in a read-only directory.
   explicit KeyValueStorage(std::string const & kvPath, size_t cacheValuesCountLimit,
                            std::function<bool(KeyValue const &)> const & pred = DefaultPred);
+  ~KeyValueStorage();
 
-  KeyValueStorage(KeyValueStorage &&) = default;
-  KeyValueStorage & operator=(KeyValueStorage &&) = default;
+  KeyValueStorage(KeyValueStorage &&);
+  KeyValueStorage & operator=(KeyValueStorage &&);
 
   KeyValueStorage(KeyValueStorage const &) = delete;
   KeyValueStorage & operator=(KeyValueStorage const &) = delete;
 
-  void Insert(uint64_t key, JsonValue && valueJson);
+  // Writes the binary storage of the jsonl file |kvPath| to |kvPath| + KEY_VALUE_BINARY_EXT:
+  // the values sorted by the keys followed by the table of the keys and the offsets of
+  // the values and by the size and the checksum of the jsonl file. The first value of
+  // a duplicated key is kept.
+  static void BuildBinary(std::string const & kvPath);
 
   static std::string SerializeFullLine(uint64_t key, JsonValue && valueJson);
 
+  // Returns nullptr if there is no |key|, its value is not a valid json or it does not
+  // satisfy the predicate of the storage.
   std::shared_ptr<JsonValue> Find(uint64_t key) const;
+  // Returns the number of the keys including the ones filtered out by the predicate.
   size_t Size() const;
 
   static std::string Serialize(base::JSONPtr const & ptr)
@@ -68,13 +83,25 @@ public:
   static std::string SerializeDref(uint64_t number);
 
 private:
-  using Value = boost::variant<std::shared_ptr<JsonValue>, std::string>;
+  struct Entry
+  {
+    uint64_t m_key = 0;
+    uint64_t m_offset = 0;
+  };
+
+  class ValuesCache;
 
   static bool DefaultPred(KeyValue const &) { return true; }
   static bool ParseKeyValueLine(std::string const & line, std::streamoff lineNumber, uint64_t & key,
                                 std::string & value);
-  std::fstream m_storage;
-  std::unordered_map<uint64_t, Value> m_values;
-  size_t m_cacheValuesCountLimit;
+  static bool IsBinaryUpToDate(std::string const & kvPath);
+
+  std::unique_ptr<MmapReader> m_mmapReader;
+  // The table of the keys in |m_mmapReader|.
+  Entry const * m_entries = nullptr;
+  size_t m_entriesCount = 0;
+  uint64_t m_valuesSize = 0;
+  std::function<bool(KeyValue const &)> m_pred;
+  std::unique_ptr<ValuesCache> m_cache;
 };
 }  // namespace generator
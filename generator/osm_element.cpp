@@ -67,9 +67,10 @@ void OsmElement::AddTag(char const * key, char const * value)
   SKIP_KEY_BY_PREFIX("official_name");
 #undef SKIP_KEY_BY_PREFIX
 
-  std::string val{value};
-  strings::Trim(val);
-  m_tags.emplace_back(key, std::move(val));
+  auto & tag = m_spareTags.EmplaceBack(m_tags);
+  tag.m_key.assign(key);
+  tag.m_value.assign(value);
+  strings::Trim(tag.m_value);
 }
 
 void OsmElement::AddTag(std::string const & key, std::string const & value)
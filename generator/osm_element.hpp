@@ -9,8 +9,10 @@
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 struct OsmElement
@@ -30,8 +32,8 @@ struct OsmElement
   struct Member
   {
     Member() = default;
-    Member(uint64_t ref, EntityType type, std::string const & role)
-      : m_ref(ref), m_type(type), m_role(role) {}
+    Member(uint64_t ref, EntityType type, std::string role)
+      : m_ref(ref), m_type(type), m_role(std::move(role)) {}
 
     bool operator==(Member const & other) const
     {
@@ -46,7 +48,7 @@ struct OsmElement
   struct Tag
   {
     Tag() = default;
-    Tag(std::string const & key, std::string const & value) : m_key(key), m_value(value) {}
+    Tag(std::string key, std::string value) : m_key(std::move(key)), m_value(std::move(value)) {}
 
     bool operator==(Tag const & other) const
     {
@@ -62,6 +64,46 @@ struct OsmElement
     std::string m_value;
   };
 
+  // The members and the tags removed by Clear(). Their strings keep their capacities and are
+  // assigned by AddMember() and AddTag(), so a refilled element allocates only the strings
+  // which are longer than the ones it had. The spare items are not copied with the element.
+  template <typename T>
+  class SpareItems
+  {
+  public:
+    SpareItems() = default;
+    SpareItems(SpareItems const &) {}
+    SpareItems(SpareItems &&) = default;
+
+    SpareItems & operator=(SpareItems const &) { return *this; }
+    SpareItems & operator=(SpareItems &&) = default;
+
+    // Moves |items| to the spare ones.
+    void Take(std::vector<T> & items)
+    {
+      std::move(items.begin(), items.end(), std::back_inserter(m_items));
+      items.clear();
+    }
+
+    // Appends a spare item or a new one to |items|.
+    T & EmplaceBack(std::vector<T> & items)
+    {
+      if (m_items.empty())
+      {
+        items.emplace_back();
+      }
+      else
+      {
+        items.emplace_back(std::move(m_items.back()));
+        m_items.pop_back();
+      }
+      return items.back();
+    }
+
+  private:
+    std::vector<T> m_items;
+  };
+
   static EntityType StringToEntityType(std::string const & type)
   {
     if (type == "way")
@@ -74,6 +116,8 @@ struct OsmElement
     return EntityType::Unknown;
   }
 
+  // Keeps the capacities of the containers and of the strings of the members and the tags,
+  // see OsmElementChunksPool.
   void Clear()
   {
     m_type = EntityType::Unknown;
@@ -87,8 +131,8 @@ struct OsmElement
     m_role.clear();
 
     m_nodes.clear();
-    m_members.clear();
-    m_tags.clear();
+    m_spareMembers.Take(m_members);
+    m_spareTags.Take(m_tags);
   }
 
   std::string ToString(std::string const & shift = std::string()) const;
@@ -118,9 +162,16 @@ struct OsmElement
   }
 
   void AddNd(uint64_t ref) { m_nodes.emplace_back(ref); }
+  void AddMember(uint64_t ref, EntityType type, char const * role)
+  {
+    auto & member = m_spareMembers.EmplaceBack(m_members);
+    member.m_ref = ref;
+    member.m_type = type;
+    member.m_role.assign(role);
+  }
   void AddMember(uint64_t ref, EntityType type, std::string const & role)
   {
-    m_members.emplace_back(ref, type, role);
+    AddMember(ref, type, role.c_str());
   }
 
   void AddTag(char const * key, char const * value);
@@ -162,6 +213,9 @@ struct OsmElement
   std::vector<uint64_t> m_nodes;
   std::vector<Member> m_members;
   std::vector<Tag> m_tags;
+
+  SpareItems<Member> m_spareMembers;
+  SpareItems<Tag> m_spareTags;
 };
 
 base::GeoObjectId GetGeoObjectId(OsmElement const & element);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "generator/osm_element.hpp"
+
+#include "base/thread_safe_queue.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace generator
+{
+// Free list of the chunks of elements. The processed chunks are put back here and
+// refilled by the reader. The elements are refilled after OsmElement::Clear() so the
+// containers of the elements and the strings of their members and tags keep their
+// capacities and most of the elements are read without allocations.
+class OsmElementChunksPool
+{
+public:
+  using Chunk = std::vector<OsmElement>;
+
+  // Returns a free chunk of |size| elements or a new one.
+  Chunk Get(size_t size)
+  {
+    Chunk chunk;
+    if (m_chunks.TryPop(chunk))
+      chunk.resize(size);
+    else
+      chunk = Chunk(size);
+    return chunk;
+  }
+
+  void Put(Chunk && chunk) { m_chunks.Push(std::move(chunk)); }
+
+private:
+  base::threads::ThreadSafeQueue<Chunk> m_chunks;
+};
+}  // namespace generator
@@ -3,6 +3,7 @@
 #include "generator/intermediate_data.hpp"
 #include "generator/intermediate_elements.hpp"
 #include "generator/osm_element.hpp"
+#include "generator/osm_element_chunks_pool.hpp"
 #include "generator/towns_dumper.hpp"
 #include "generator/translator_factory.hpp"
 
@@ -14,10 +15,16 @@
 #include "base/assert.hpp"
 #include "base/stl_helpers.hpp"
 #include "base/file_name_utils.hpp"
+#include "base/thread_pool_computational.hpp"
+#include "base/thread_safe_queue.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <set>
+#include <thread>
 
 #include "defines.hpp"
 
@@ -106,52 +113,289 @@ void AddElementToCache(cache::IntermediateDataWriter & cache, OsmElement & eleme
   }
 }
 
-void BuildIntermediateDataFromXML(SourceReader & stream, cache::IntermediateDataWriter & cache,
-                                  TownsDumper & towns)
+void ProcessOsmElementsFromXML(SourceReader & stream, function<void(OsmElement *)> processor)
 {
   ProcessorOsmElementsFromXml processorOsmElementsFromXml(stream);
   OsmElement element;
   while (processorOsmElementsFromXml.TryRead(element))
-  {
-    towns.CheckElement(element);
-    AddElementToCache(cache, element);
-  }
+    processor(&element);
 }
 
-void ProcessOsmElementsFromXML(SourceReader & stream, function<void(OsmElement *)> processor)
+void ProcessOsmElementsFromO5M(SourceReader & stream, function<void(OsmElement *)> processor)
 {
-  ProcessorOsmElementsFromXml processorOsmElementsFromXml(stream);
+  ProcessorOsmElementsFromO5M processorOsmElementsFromO5M(stream);
   OsmElement element;
-  while (processorOsmElementsFromXml.TryRead(element))
+  while (processorOsmElementsFromO5M.TryRead(element))
     processor(&element);
 }
 
-void BuildIntermediateDataFromO5M(SourceReader & stream, cache::IntermediateDataWriter & cache,
-                                  TownsDumper & towns)
+namespace
 {
-  auto processor = [&](OsmElement * element) {
-    towns.CheckElement(*element);
-    AddElementToCache(cache, *element);
+using ElementChunk = vector<OsmElement>;
+using ElementChunksQueue = base::threads::BoundedThreadSafeQueue<base::threads::DataWrapper<ElementChunk>>;
+
+// Number of the chunks which are read ahead of their processing.
+size_t const kChunksInQueue = 16;
+
+// Pushes the elements of |processor| to |chunks| by |chunkSize|, the empty wrapper marks the end.
+// The chunks are taken from |chunksPool| if it is set.
+void ReadElementChunks(ProcessorOsmElementsInterface & processor, size_t chunkSize,
+                       OsmElementChunksPool * chunksPool, ElementChunksQueue & chunks)
+{
+  CHECK_GREATER(chunkSize, 0, ());
+  auto const getChunk = [&]() {
+    return chunksPool ? chunksPool->Get(chunkSize) : ElementChunk(chunkSize);
   };
 
-  // Use only this function here, look into ProcessOsmElementsFromO5M
-  // for more details.
-  ProcessOsmElementsFromO5M(stream, processor);
+  size_t pos = 0;
+  ElementChunk chunk = getChunk();
+  while (processor.TryRead(chunk[pos]))
+  {
+    if (++pos != chunkSize)
+      continue;
+
+    chunks.Push(move(chunk));
+    chunk = getChunk();
+    pos = 0;
+  }
+  chunk.resize(pos);
+  if (!chunk.empty())
+    chunks.Push(move(chunk));
+  chunks.Push({});
 }
 
-void ProcessOsmElementsFromO5M(SourceReader & stream, function<void(OsmElement *)> processor)
+void ForEachElementChunk(ElementChunksQueue & chunks, ProcessOsmElementChunkFn const & fn)
 {
-  ProcessorOsmElementsFromO5M processorOsmElementsFromO5M(stream);
-  OsmElement element;
-  while (processorOsmElementsFromO5M.TryRead(element))
-    processor(&element);
+  while (true)
+  {
+    base::threads::DataWrapper<ElementChunk> chunk;
+    chunks.WaitAndPop(chunk);
+    if (chunk.IsEmpty())
+      return;
+
+    fn(move(chunk.Get()));
+  }
+}
+
+uint8_t const kO5MReset = static_cast<uint8_t>(osm::O5MSource::EntityType::Reset);
+uint8_t const kO5MEnd = static_cast<uint8_t>(osm::O5MSource::EntityType::End);
+uint8_t const kO5MHeader = static_cast<uint8_t>(osm::O5MSource::EntityType::Header);
+
+// Every segment starts with the reset and the header so that it is an O5M stream itself.
+uint8_t const kO5MSegmentPrefix[] = {kO5MReset, kO5MHeader, 0x04, 'o', '5', 'm', '2'};
+
+// Size of the blocks which the segments are passed by to the decoders.
+size_t const kO5MBlockSize = 1024 * 1024;
+size_t const kO5MBlocksInQueue = 16;
+
+// Part of an O5M stream between two reset points. The bytes are passed from
+// the splitting thread to the decoding one by blocks and the decoded elements
+// are passed to the consumer by chunks.
+class O5MSegment
+{
+public:
+  using Block = vector<uint8_t>;
+
+  O5MSegment() : m_blocks(kO5MBlocksInQueue), m_chunks(kChunksInQueue) {}
+
+  // The empty block marks the end of the segment.
+  void PushBlock(Block && block) { m_blocks.Push(move(block)); }
+
+  void Decode(size_t chunkSize, OsmElementChunksPool * chunksPool)
+  {
+    ProcessorOsmElementsFromO5M processor([this](uint8_t * buffer, size_t size) {
+      return Read(buffer, size);
+    });
+    ReadElementChunks(processor, chunkSize, chunksPool, m_chunks);
+  }
+
+  void ForEachChunk(ProcessOsmElementChunkFn const & fn) { ForEachElementChunk(m_chunks, fn); }
+
+private:
+  size_t Read(uint8_t * buffer, size_t size)
+  {
+    while (m_blockPos == m_block.size())
+    {
+      m_blocks.WaitAndPop(m_block);
+      m_blockPos = 0;
+      if (m_block.empty())
+        return 0;
+    }
+
+    auto const count = min(size, m_block.size() - m_blockPos);
+    memcpy(buffer, m_block.data() + m_blockPos, count);
+    m_blockPos += count;
+    return count;
+  }
+
+  base::threads::BoundedThreadSafeQueue<Block> m_blocks;
+  Block m_block;
+  size_t m_blockPos = 0;
+  ElementChunksQueue m_chunks;
+};
+
+// Splits the O5M |stream| into segments which start at reset points and are not shorter than
+// |minSegmentSize| bytes (but the last one) and passes them to |onSegment| before filling them.
+// Only the dataset boundaries are parsed here, the datasets are copied as is.
+void SplitO5M(SourceReader & stream, uint64_t minSegmentSize,
+              function<void(shared_ptr<O5MSegment> const &)> const & onSegment)
+{
+  osm::StreamBuffer buffer([&stream](uint8_t * buffer, size_t size) {
+    return stream.Read(reinterpret_cast<char *>(buffer), size);
+  }, kO5MBlockSize);
+  CHECK_EQUAL(buffer.Get(), kO5MReset, ("Incorrect o5m start."));
+
+  shared_ptr<O5MSegment> segment;
+  O5MSegment::Block block;
+  uint64_t segmentSize = 0;
+  auto const flushBlock = [&] {
+    segmentSize += block.size();
+    segment->PushBlock(move(block));
+    block = {};
+    block.reserve(kO5MBlockSize);
+  };
+  auto const startSegment = [&] {
+    segment = make_shared<O5MSegment>();
+    onSegment(segment);
+    segmentSize = 0;
+    block.assign(begin(kO5MSegmentPrefix), end(kO5MSegmentPrefix));
+  };
+  auto const finishSegment = [&] {
+    block.push_back(kO5MEnd);
+    flushBlock();
+    segment->PushBlock({});
+  };
+
+  startSegment();
+  while (true)
+  {
+    auto const type = buffer.Get();
+    if (type == kO5MEnd)
+      break;
+
+    if (type == kO5MReset)
+    {
+      if (segmentSize + block.size() >= minSegmentSize)
+      {
+        finishSegment();
+        startSegment();
+      }
+      else
+      {
+        block.push_back(type);
+      }
+      continue;
+    }
+
+    // A dataset: the type, the varint length and the payload. The headers are
+    // dropped because every segment has its own one.
+    auto const datasetBegin = block.size();
+    block.push_back(type);
+    uint64_t length = 0;
+    uint8_t byte;
+    size_t shift = 0;
+    do
+    {
+      byte = buffer.Get();
+      block.push_back(byte);
+      length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+
+    if (length != 0)
+    {
+      auto const payloadBegin = block.size();
+      block.resize(payloadBegin + length);
+      buffer.Read(block.data() + payloadBegin, length);
+    }
+
+    if (type == kO5MHeader)
+      block.resize(datasetBegin);
+
+    if (block.size() >= kO5MBlockSize)
+      flushBlock();
+  }
+  finishSegment();
+}
+}  // namespace
+
+void ProcessOsmElementChunksFromO5M(SourceReader & stream, size_t threadsCount, size_t chunkSize,
+                                    ProcessOsmElementChunkFn const & fn,
+                                    shared_ptr<OsmElementChunksPool> const & chunksPool,
+                                    uint64_t minSegmentSize)
+{
+  CHECK_GREATER(threadsCount, 0, ());
+
+  base::thread_pool::computational::ThreadPool pool(threadsCount);
+  // The segments in the order of the stream. The capacity limits the number of the segments
+  // in flight: the decoders of the later segments wait while their chunks are not consumed.
+  using SegmentsQueue =
+      base::threads::BoundedThreadSafeQueue<base::threads::DataWrapper<shared_ptr<O5MSegment>>>;
+  SegmentsQueue segments(threadsCount);
+
+  thread splitter([&] {
+    SplitO5M(stream, minSegmentSize, [&](shared_ptr<O5MSegment> const & segment) {
+      segments.Push(shared_ptr<O5MSegment>(segment));
+      pool.SubmitWork([segment, chunkSize, chunksPool] {
+        segment->Decode(chunkSize, chunksPool.get());
+      });
+    });
+    segments.Push({});
+  });
+
+  while (true)
+  {
+    base::threads::DataWrapper<shared_ptr<O5MSegment>> segment;
+    segments.WaitAndPop(segment);
+    if (segment.IsEmpty())
+      break;
+
+    segment.Get()->ForEachChunk(fn);
+  }
+
+  splitter.join();
+}
+
+void ProcessOsmElementChunksFromXML(SourceReader & stream, size_t chunkSize,
+                                    ProcessOsmElementChunkFn const & fn,
+                                    shared_ptr<OsmElementChunksPool> const & chunksPool)
+{
+  ElementChunksQueue chunks(kChunksInQueue);
+  thread parser([&] {
+    ProcessorOsmElementsFromXml processor(stream);
+    ReadElementChunks(processor, chunkSize, chunksPool.get(), chunks);
+  });
+
+  ForEachElementChunk(chunks, fn);
+  parser.join();
+}
+
+void ProcessOsmElementChunks(SourceReader & stream, feature::GenerateInfo::OsmSourceType type,
+                             size_t threadsCount, size_t chunkSize,
+                             ProcessOsmElementChunkFn const & fn,
+                             shared_ptr<OsmElementChunksPool> const & chunksPool)
+{
+  switch (type)
+  {
+  case feature::GenerateInfo::OsmSourceType::O5M:
+    ProcessOsmElementChunksFromO5M(stream, threadsCount, chunkSize, fn, chunksPool);
+    return;
+  case feature::GenerateInfo::OsmSourceType::XML:
+    ProcessOsmElementChunksFromXML(stream, chunkSize, fn, chunksPool);
+    return;
+  }
+  UNREACHABLE();
 }
 
 ProcessorOsmElementsFromO5M::ProcessorOsmElementsFromO5M(SourceReader & stream)
-  : m_stream(stream)
-  , m_dataset([&](uint8_t * buffer, size_t size) {
-      return m_stream.Read(reinterpret_cast<char *>(buffer), size);
+  : ProcessorOsmElementsFromO5M([&stream](uint8_t * buffer, size_t size) {
+      return stream.Read(reinterpret_cast<char *>(buffer), size);
   })
+{
+}
+
+ProcessorOsmElementsFromO5M::ProcessorOsmElementsFromO5M(osm::TReadFunc reader)
+  : m_dataset(std::move(reader))
   , m_pos(m_dataset.begin())
 {
 }
@@ -172,7 +416,7 @@ bool ProcessorOsmElementsFromO5M::TryRead(OsmElement & element)
     }
   };
 
-  element = {};
+  element.Clear();
 
   // Be careful, we could call Nodes(), Members(), Tags() from O5MSource::Entity
   // only once (!). Because these functions read data from file simultaneously with
@@ -215,7 +459,18 @@ bool ProcessorOsmElementsFromO5M::TryRead(OsmElement & element)
 }
 
 ProcessorOsmElementsFromXml::ProcessorOsmElementsFromXml(SourceReader & stream)
-  : m_xmlSource([&, this](auto * element) { m_queue.emplace(*element); })
+  : m_xmlSource([&, this](auto * element) {
+      // The parsed element is swapped with a free one: the parser refills the containers
+      // of the free element after OsmElement::Clear().
+      OsmElement queued;
+      if (!m_freeElements.empty())
+      {
+        queued = move(m_freeElements.back());
+        m_freeElements.pop_back();
+      }
+      swap(queued, *element);
+      m_queue.push(move(queued));
+    })
   , m_parser(stream, m_xmlSource)
 {
 }
@@ -225,7 +480,9 @@ bool ProcessorOsmElementsFromXml::TryReadFromQueue(OsmElement & element)
   if (m_queue.empty())
     return false;
 
-  element = m_queue.front();
+  // The containers of |element|, e.g. of a recycled chunk, are given to the parser.
+  swap(element, m_queue.front());
+  m_freeElements.push_back(move(m_queue.front()));
   m_queue.pop();
   return true;
 }
@@ -244,25 +501,72 @@ bool ProcessorOsmElementsFromXml::TryRead(OsmElement & element)
 // Generate functions implementations.
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool GenerateIntermediateData(feature::GenerateInfo & info)
+bool GenerateIntermediateData(feature::GenerateInfo & info, size_t threadsCount)
 {
   auto nodes = cache::CreatePointStorageWriter(info.m_nodeStorageType,
                                                info.GetIntermediateFileName(NODES_FILE));
-  cache::IntermediateDataWriter cache(*nodes, info);
+  cache::IntermediateDataWriter cache(*nodes, info, static_cast<unsigned int>(threadsCount));
   TownsDumper towns;
   SourceReader reader = info.m_osmFileName.empty() ? SourceReader() : SourceReader(info.m_osmFileName);
 
   LOG(LINFO, ("Data source:", info.m_osmFileName));
 
-  switch (info.m_osmFileType)
-  {
-  case feature::GenerateInfo::OsmSourceType::XML:
-    BuildIntermediateDataFromXML(reader, cache, towns);
-    break;
-  case feature::GenerateInfo::OsmSourceType::O5M:
-    BuildIntermediateDataFromO5M(reader, cache, towns);
-    break;
-  }
+  // The nodes, the ways and the relations are written to the different files of |cache|
+  // so every kind of the elements is written by its own stage. The stages get the elements
+  // in the order of the stream so the files are the same as the ones written sequentially.
+  // Every chunk is shared by the stages which process the elements of their types in place.
+  // The chunk is put back to the pool with the containers of its elements by the stage
+  // which releases it last.
+  using SharedChunk = shared_ptr<ElementChunk>;
+  using SharedChunksQueue = base::threads::BoundedThreadSafeQueue<SharedChunk>;
+  auto const runStage = [&](SharedChunksQueue & chunks, OsmElement::EntityType type,
+                            function<void(OsmElement &)> fn) {
+    return thread([&chunks, type, fn{move(fn)}] {
+      while (true)
+      {
+        SharedChunk chunk;
+        chunks.WaitAndPop(chunk);
+        if (!chunk)
+          return;
+
+        for (auto & element : *chunk)
+        {
+          if (element.m_type == type)
+            fn(element);
+        }
+      }
+    });
+  };
+  auto const addToCache = [&cache](OsmElement & element) { AddElementToCache(cache, element); };
+  SharedChunksQueue nodesChunks(kChunksInQueue);
+  SharedChunksQueue waysChunks(kChunksInQueue);
+  SharedChunksQueue relationsChunks(kChunksInQueue);
+  auto nodesStage = runStage(nodesChunks, OsmElement::EntityType::Node, [&](OsmElement & element) {
+    towns.CheckElement(element);
+    AddElementToCache(cache, element);
+  });
+  auto waysStage = runStage(waysChunks, OsmElement::EntityType::Way, addToCache);
+  auto relationsStage = runStage(relationsChunks, OsmElement::EntityType::Relation, addToCache);
+
+  size_t const kChunkSize = 1024;
+  auto const chunksPool = make_shared<OsmElementChunksPool>();
+  ProcessOsmElementChunks(reader, info.m_osmFileType, threadsCount, kChunkSize,
+                          [&](ElementChunk && chunk) {
+    SharedChunk const shared(new ElementChunk(move(chunk)), [chunksPool](ElementChunk * released) {
+      chunksPool->Put(move(*released));
+      delete released;
+    });
+    nodesChunks.Push(SharedChunk(shared));
+    waysChunks.Push(SharedChunk(shared));
+    relationsChunks.Push(SharedChunk(shared));
+  }, chunksPool);
+
+  nodesChunks.Push({});
+  waysChunks.Push({});
+  relationsChunks.Push({});
+  nodesStage.join();
+  waysStage.join();
+  relationsStage.join();
 
   cache.SaveIndex();
   towns.Dump(info.GetIntermediateFileName(TOWNS_FILE));
@@ -2,20 +2,23 @@
 
 #include "generator/generate_info.hpp"
 #include "generator/intermediate_data.hpp"
+#include "generator/osm_element.hpp"
+#include "generator/osm_element_chunks_pool.hpp"
 #include "generator/osm_o5m_source.hpp"
 #include "generator/osm_xml_source.hpp"
 #include "generator/translator_interface.hpp"
 
 #include "coding/parse_xml.hpp"
 
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <queue>
 #include <sstream>
 #include <string>
+#include <vector>
 
-struct OsmElement;
 class FeatureParams;
 
 namespace generator
@@ -43,11 +46,37 @@ public:
   uint64_t Read(char * buffer, uint64_t bufferSize);
 };
 
-bool GenerateIntermediateData(feature::GenerateInfo & info);
+// Decodes the input on |threadsCount| threads (see ProcessOsmElementChunks()) and
+// writes the nodes, the ways and the relations to the intermediate cache concurrently.
+bool GenerateIntermediateData(feature::GenerateInfo & info, size_t threadsCount = 1);
 
 void ProcessOsmElementsFromO5M(SourceReader & stream, std::function<void(OsmElement *)> processor);
 void ProcessOsmElementsFromXML(SourceReader & stream, std::function<void(OsmElement *)> processor);
 
+using ProcessOsmElementChunkFn = std::function<void(std::vector<OsmElement> && elements)>;
+
+// Minimal size of the O5M stream part which is decoded by a single thread.
+uint64_t constexpr kMinO5MSegmentSize = 16 * 1024 * 1024;
+
+// Reads the elements of |stream| on background threads and passes them to |fn|
+// in chunks of |chunkSize| elements in the order of the stream. The chunks are taken
+// from |chunksPool| if it is set, |fn| may put the processed chunks back there.
+// The stream is split at reset points (see https://wiki.openstreetmap.org/wiki/O5m#Reset)
+// into segments of at least |minSegmentSize| bytes, the segments are decoded
+// on |threadsCount| threads concurrently.
+void ProcessOsmElementChunksFromO5M(SourceReader & stream, size_t threadsCount, size_t chunkSize,
+                                    ProcessOsmElementChunkFn const & fn,
+                                    std::shared_ptr<OsmElementChunksPool> const & chunksPool = {},
+                                    uint64_t minSegmentSize = kMinO5MSegmentSize);
+// The XML stream is parsed on a single background thread.
+void ProcessOsmElementChunksFromXML(SourceReader & stream, size_t chunkSize,
+                                    ProcessOsmElementChunkFn const & fn,
+                                    std::shared_ptr<OsmElementChunksPool> const & chunksPool = {});
+void ProcessOsmElementChunks(SourceReader & stream, feature::GenerateInfo::OsmSourceType type,
+                             size_t threadsCount, size_t chunkSize,
+                             ProcessOsmElementChunkFn const & fn,
+                             std::shared_ptr<OsmElementChunksPool> const & chunksPool = {});
+
 class ProcessorOsmElementsInterface
 {
 public:
@@ -60,12 +89,12 @@ class ProcessorOsmElementsFromO5M : public ProcessorOsmElementsInterface
 {
 public:
   explicit ProcessorOsmElementsFromO5M(SourceReader & stream);
+  explicit ProcessorOsmElementsFromO5M(osm::TReadFunc reader);
 
   // ProcessorOsmElementsInterface overrides:
   bool TryRead(OsmElement & element) override;
 
 private:
-  SourceReader & m_stream;
   osm::O5MSource m_dataset;
   osm::O5MSource::Iterator m_pos;
 };
@@ -84,5 +113,7 @@ private:
   XMLSource m_xmlSource;
   XMLSequenceParser<SourceReader, XMLSource> m_parser;
   std::queue<OsmElement> m_queue;
+  // The elements whose containers are reused by the parser.
+  std::vector<OsmElement> m_freeElements;
 };
 }  // namespace generator
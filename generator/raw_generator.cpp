@@ -13,10 +13,34 @@
 #include <string>
 #include <vector>
 
+#include <sys/resource.h>
+
 using namespace std;
 
 namespace generator
 {
+namespace
+{
+uint64_t GetPeakMemoryBytes()
+{
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+#if defined(GEOCORE_OS_MAC)
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  // Kilobytes on Linux.
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+string CountToString(boost::optional<uint64_t> const & count)
+{
+  return count ? to_string(*count) : "-";
+}
+}  // namespace
+
 RawGenerator::RawGenerator(feature::GenerateInfo & genInfo, size_t threadsCount, size_t chunkSize)
   : m_genInfo(genInfo)
   , m_threadsCount(threadsCount)
@@ -69,9 +93,11 @@ void RawGenerator::GenerateCustom(std::shared_ptr<TranslatorInterface> const & t
 
 bool RawGenerator::Execute()
 {
+  m_stagesStats.clear();
   if (!GenerateFilteredFeatures())
     return false;
 
+  base::Timer const timer;
   while (!m_finalProcessors.empty())
   {
     base::thread_pool::computational::ThreadPool threadPool(m_threadsCount);
@@ -87,10 +113,50 @@ bool RawGenerator::Execute()
     }
   }
 
+  // The final processors read the written features.
+  AddStageStats("Final processing", timer, m_featuresCount, {} /* elementsOut */);
   LOG(LINFO, ("Final processing is finished."));
+
+  for (auto const & stats : m_stagesStats)
+  {
+    LOG(LINFO, ("Stage:", stats.m_name, "elements in:", CountToString(stats.m_elementsIn),
+                "elements out:", CountToString(stats.m_elementsOut), "seconds:", stats.m_seconds,
+                "peak memory (MB):", stats.m_peakBytes / (1024 * 1024)));
+  }
   return true;
 }
 
+std::vector<RawGenerator::StageStats> const & RawGenerator::GetStagesStats() const
+{
+  return m_stagesStats;
+}
+
+void RawGenerator::AddStageStats(std::string const & name, base::Timer const & timer,
+                                 boost::optional<uint64_t> const & elementsIn,
+                                 boost::optional<uint64_t> const & elementsOut)
+{
+  StageStats stats;
+  stats.m_name = name;
+  stats.m_elementsIn = elementsIn;
+  stats.m_elementsOut = elementsOut;
+  stats.m_seconds = timer.ElapsedSeconds();
+  stats.m_peakBytes = GetPeakMemoryBytes();
+  m_stagesStats.push_back(move(stats));
+}
+
+void RawGenerator::AddOperationsStats(OperationsTimes const & times)
+{
+  auto const peakBytes = GetPeakMemoryBytes();
+  for (auto const & item : times.GetItems())
+  {
+    StageStats stats;
+    stats.m_name = item.m_name + ": " + item.m_operation;
+    stats.m_seconds = item.m_seconds;
+    stats.m_peakBytes = peakBytes;
+    m_stagesStats.push_back(move(stats));
+  }
+}
+
 std::vector<std::string> const & RawGenerator::GetNames() const
 {
   return m_names;
@@ -101,40 +167,37 @@ bool RawGenerator::GenerateFilteredFeatures()
   SourceReader reader = m_genInfo.m_osmFileName.empty() ? SourceReader()
                                                         : SourceReader(m_genInfo.m_osmFileName);
 
-  std::unique_ptr<ProcessorOsmElementsInterface> sourceProcessor;
-  switch (m_genInfo.m_osmFileType) {
-  case feature::GenerateInfo::OsmSourceType::O5M:
-    sourceProcessor = std::make_unique<ProcessorOsmElementsFromO5M>(reader);
-    break;
-  case feature::GenerateInfo::OsmSourceType::XML:
-    sourceProcessor = std::make_unique<ProcessorOsmElementsFromXml>(reader);
-    break;
-  }
-  CHECK(sourceProcessor, ());
-
-  TranslatorsPool translators(m_translators, m_threadsCount);
+  auto const chunksPool = std::make_shared<OsmElementChunksPool>();
+  // Must be set before the translators are cloned by the pool.
+  auto const times = std::make_shared<OperationsTimes>();
+  m_translators->SetTimes(times);
+  TranslatorsPool translators(m_translators, m_threadsCount, chunksPool);
   RawGeneratorWriter rawGeneratorWriter(m_queue, m_genInfo.m_tmpDir);
   rawGeneratorWriter.Run();
 
-  size_t element_pos = 0;
-  std::vector<OsmElement> elements(m_chunkSize);
-  while (sourceProcessor->TryRead(elements[element_pos]))
-  {
-    if (++element_pos != m_chunkSize)
-      continue;
-
-    translators.Emit(std::move(elements));
-    elements = vector<OsmElement>(m_chunkSize);
-    element_pos = 0;
-  }
-  elements.resize(element_pos);
-  translators.Emit(std::move(elements));
-
+  // The input is decoded on the background threads, see ProcessOsmElementChunks().
+  base::Timer timer;
+  uint64_t elementsCount = 0;
+  ProcessOsmElementChunks(reader, m_genInfo.m_osmFileType, m_threadsCount, m_chunkSize,
+                          [&](vector<OsmElement> && elements) {
+    elementsCount += elements.size();
+    translators.Emit(move(elements));
+  }, chunksPool);
+
+  // The features are counted when they are written, see below.
+  AddStageStats("Reading and translation", timer, elementsCount, {} /* elementsOut */);
   LOG(LINFO, ("Input was processed."));
+  timer.Reset();
   if (!translators.Finish())
     return false;
 
+  AddStageStats("Finishing, merging and saving of translators", timer, {} /* elementsIn */,
+                {} /* elementsOut */);
+  AddOperationsStats(*times);
+  timer.Reset();
   rawGeneratorWriter.ShutdownAndJoin();
+  m_featuresCount = rawGeneratorWriter.GetFeaturesCount();
+  AddStageStats("Writing of features", timer, m_featuresCount, m_featuresCount);
   m_names = rawGeneratorWriter.GetNames();
   LOG(LINFO, ("Names:", m_names));
   return true;
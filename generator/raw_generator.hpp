@@ -1,5 +1,6 @@
 #pragma once
 
+#include "generator/collection_base.hpp"
 #include "generator/features_processing_helpers.hpp"
 #include "generator/final_processor_intermediate_mwm.hpp"
 #include "generator/generate_info.hpp"
@@ -7,16 +8,37 @@
 #include "generator/translator_collection.hpp"
 #include "generator/translator_interface.hpp"
 
+#include "base/timer.hpp"
+
+#include <cstdint>
 #include <memory>
 #include <queue>
 #include <string>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 namespace generator
 {
 class RawGenerator
 {
 public:
+  // Statistics of a stage of Execute(), they are logged at the end of Execute().
+  // The stage of the translators is followed by the rows of the individual translators and
+  // collectors, e.g. "Translator Regions: finish", their seconds are summed over all the
+  // clones and the seconds of a translator include the ones of its collectors.
+  struct StageStats
+  {
+    std::string m_name;
+    // Not set when the stage does not know the count, e.g. the features produced by
+    // the translators are counted only when they are written.
+    boost::optional<uint64_t> m_elementsIn;
+    boost::optional<uint64_t> m_elementsOut;
+    double m_seconds = 0.0;
+    // Peak resident memory of the process by the end of the stage.
+    uint64_t m_peakBytes = 0;
+  };
+
   explicit RawGenerator(feature::GenerateInfo & genInfo, size_t threadsCount = 1,
                         size_t chunkSize = 1024);
 
@@ -30,6 +52,7 @@ public:
   std::vector<std::string> const & GetNames() const;
   std::shared_ptr<FeatureProcessorQueue> GetQueue();
   void ForceReloadCache();
+  std::vector<StageStats> const & GetStagesStats() const;
 
 private:
   using FinalProcessorPtr = std::shared_ptr<FinalProcessorIntermediateMwmInterface>;
@@ -43,6 +66,10 @@ private:
   };
 
   bool GenerateFilteredFeatures();
+  void AddStageStats(std::string const & name, base::Timer const & timer,
+                     boost::optional<uint64_t> const & elementsIn,
+                     boost::optional<uint64_t> const & elementsOut);
+  void AddOperationsStats(OperationsTimes const & times);
 
   feature::GenerateInfo & m_genInfo;
   size_t m_threadsCount;
@@ -52,5 +79,7 @@ private:
   std::shared_ptr<TranslatorCollection> m_translators;
   std::priority_queue<FinalProcessorPtr, std::vector<FinalProcessorPtr>, FinalProcessorPtrCmp> m_finalProcessors;
   std::vector<std::string> m_names;
+  std::vector<StageStats> m_stagesStats;
+  uint64_t m_featuresCount = 0;
 };
 }  // namespace generator
@@ -47,6 +47,12 @@ std::vector<std::string> RawGeneratorWriter::GetNames()
   return names;
 }
 
+uint64_t RawGeneratorWriter::GetFeaturesCount() const
+{
+  CHECK(!m_thread.joinable(), ());
+  return m_featuresCount;
+}
+
 void RawGeneratorWriter::Write(std::vector<ProcessedData> const & vecChunks)
 {
   for (auto const & chunk : vecChunks)
@@ -68,6 +74,7 @@ void RawGeneratorWriter::Write(std::vector<ProcessedData> const & vecChunks)
       auto const & buffer = chunk.m_buffer;
       WriteVarUint(*writer, static_cast<uint32_t>(buffer.size()));
       writer->Write(buffer.data(), buffer.size());
+      ++m_featuresCount;
     }
   }
 }
@@ -3,6 +3,7 @@
 #include "generator/feature_builder.hpp"
 #include "generator/features_processing_helpers.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <thread>
@@ -21,6 +22,8 @@ public:
   void Run();
   void ShutdownAndJoin();
   std::vector<std::string> GetNames();
+  // Returns the number of the written features, a feature is counted once per its file.
+  uint64_t GetFeaturesCount() const;
 
 private:
   using FeatureBuilderWriter = feature::FeatureBuilderWriter<feature::serialization_policy::MaxAccuracy>;
@@ -31,5 +34,6 @@ private:
   std::shared_ptr<FeatureProcessorQueue> m_queue;
   std::string m_path;
   std::unordered_map<std::string, std::unique_ptr<FileWriter>> m_writers;
+  uint64_t m_featuresCount = 0;
 };
 }  // namespace generator
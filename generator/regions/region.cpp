@@ -9,7 +9,10 @@
 #include "base/assert.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <numeric>
+#include <vector>
 
 #include <boost/geometry.hpp>
 
@@ -19,6 +22,85 @@ namespace generator
 {
 namespace regions
 {
+namespace
+{
+// Polygons with less points are not simplified.
+size_t const kMinPointsToSimplify = 256;
+// Tolerances of the simplified polygons relative to the size of the polygon rect,
+// from the coarsest one.
+double const kSimplificationTolerances[] = {1.0 / 256, 1.0 / 2048};
+
+double CalculateIntersectionArea(BoostPolygon const & lhs, BoostPolygon const & rhs)
+{
+  std::vector<BoostPolygon> coll;
+  boost::geometry::intersection(lhs, rhs, coll);
+  auto const binOp = [](double x, BoostPolygon const & y) { return x + boost::geometry::area(y); };
+  return std::accumulate(std::begin(coll), std::end(coll), 0., binOp);
+}
+}  // namespace
+
+// Region::SimplifiedPolygons ----------------------------------------------------------------------
+// Douglas-Peucker simplifications of a polygon with the bounds of their area errors.
+// A simplified ring is within the tolerance of the original one, so the symmetric difference
+// of the polygons lies within the tolerance of the original rings and its area does not exceed
+// 2 * tolerance * perimeter + pi * tolerance^2 * segments count.
+class Region::SimplifiedPolygons
+{
+public:
+  struct Level
+  {
+    BoostPolygon m_polygon;
+    double m_areaError = 0.0;
+  };
+
+  explicit SimplifiedPolygons(std::shared_ptr<BoostPolygon> const & polygon) : m_polygon{polygon}
+  {
+  }
+
+  // Returns the levels from the coarsest one.
+  std::vector<Level> const & GetLevels() const
+  {
+    std::call_once(m_buildOnce, [this] { Build(); });
+    return m_levels;
+  }
+
+private:
+  void Build() const
+  {
+    auto const & polygon = *m_polygon;
+    auto const pointsCount = boost::geometry::num_points(polygon);
+    if (pointsCount < kMinPointsToSimplify)
+      return;
+
+    BoostRect rect;
+    boost::geometry::envelope(polygon, rect);
+    auto const size = std::max(rect.max_corner().get<0>() - rect.min_corner().get<0>(),
+                               rect.max_corner().get<1>() - rect.min_corner().get<1>());
+    auto const perimeter = boost::geometry::perimeter(polygon);
+    for (auto const relativeTolerance : kSimplificationTolerances)
+    {
+      auto const tolerance = relativeTolerance * size;
+      Level level;
+      boost::geometry::simplify(polygon, level.m_polygon, tolerance);
+      // Simplification can make a polygon invalid, then its area is meaningless.
+      if (2 * boost::geometry::num_points(level.m_polygon) > pointsCount ||
+          !boost::geometry::is_valid(level.m_polygon))
+      {
+        continue;
+      }
+
+      level.m_areaError =
+          2 * tolerance * perimeter + M_PI * tolerance * tolerance * pointsCount;
+      m_levels.push_back(std::move(level));
+    }
+  }
+
+  std::shared_ptr<BoostPolygon> m_polygon;
+  mutable std::once_flag m_buildOnce;
+  mutable std::vector<Level> m_levels;
+};
+
+// Region ------------------------------------------------------------------------------------------
 Region::Region(FeatureBuilder const & fb, RegionDataProxy const & rd)
   : RegionWithName(fb.GetParams().name)
   , RegionWithData(rd)
@@ -28,6 +110,7 @@ Region::Region(FeatureBuilder const & fb, RegionDataProxy const & rd)
   boost::geometry::envelope(*m_polygon, m_rect);
   m_area = boost::geometry::area(*m_polygon);
   CHECK_GREATER_OR_EQUAL(m_area, 0.0, ());
+  m_simplifiedPolygons = std::make_shared<SimplifiedPolygons>(m_polygon);
 }
 
 Region::Region(StringUtf8Multilang const & name, RegionDataProxy const & rd,
@@ -119,6 +202,7 @@ void Region::SetPolygon(std::shared_ptr<BoostPolygon> const & polygon)
   boost::geometry::envelope(*m_polygon, m_rect);
   m_area = boost::geometry::area(*m_polygon);
   CHECK_GREATER_OR_EQUAL(m_area, 0.0, ());
+  m_simplifiedPolygons = std::make_shared<SimplifiedPolygons>(m_polygon);
 }
 
 bool Region::Contains(Region const & smaller) const
@@ -138,15 +222,48 @@ double Region::CalculateOverlapPercentage(Region const & other) const
   if (!boost::geometry::intersects(other.m_rect, m_rect))
     return 0.0;
 
-  std::vector<BoostPolygon> coll;
-  boost::geometry::intersection(*other.m_polygon, *m_polygon, coll);
-  auto const min =
-      std::min(boost::geometry::area(*other.m_polygon), boost::geometry::area(*m_polygon));
-  auto const binOp = [](double x, BoostPolygon const & y) { return x + boost::geometry::area(y); };
-  auto const sum = std::accumulate(std::begin(coll), std::end(coll), 0., binOp);
+  auto const sum = CalculateIntersectionArea(*other.m_polygon, *m_polygon);
+  auto const min = std::min(other.m_area, m_area);
   return (sum / min) * 100;
 }
 
+bool Region::IsOverlapPercentageLess(Region const & other, double percentage) const
+{
+  CHECK(m_polygon, ());
+  CHECK(other.m_polygon, ());
+
+  auto const min = std::min(other.m_area, m_area);
+  if (min == 0.0)
+    return CalculateOverlapPercentage(other) < percentage;
+
+  auto const threshold = percentage / 100 * min;
+  BoostRect rectsIntersection;
+  if (!boost::geometry::intersection(other.m_rect, m_rect, rectsIntersection) ||
+      boost::geometry::area(rectsIntersection) < threshold)
+  {
+    return true;
+  }
+
+  auto const & levels = m_simplifiedPolygons->GetLevels();
+  auto const & otherLevels = other.m_simplifiedPolygons->GetLevels();
+  for (size_t i = 0; i < std::max(levels.size(), otherLevels.size()); ++i)
+  {
+    auto const & polygon = i < levels.size() ? levels[i].m_polygon : *m_polygon;
+    auto const & otherPolygon = i < otherLevels.size() ? otherLevels[i].m_polygon
+                                                      : *other.m_polygon;
+    auto const error = (i < levels.size() ? levels[i].m_areaError : 0.0) +
+                       (i < otherLevels.size() ? otherLevels[i].m_areaError : 0.0);
+    auto const area = CalculateIntersectionArea(otherPolygon, polygon);
+    if (area + error < threshold)
+      return true;
+    if (area - error >= threshold)
+      return false;
+  }
+
+  auto const sum = CalculateIntersectionArea(*other.m_polygon, *m_polygon);
+  return (sum / min) * 100 < percentage;
+}
+
 bool Region::ContainsRect(Region const & smaller) const
 {
   return boost::geometry::covered_by(smaller.m_rect, m_rect);
@@ -46,6 +46,9 @@ public:
   bool Contains(PlacePoint const & place) const;
   bool Contains(BoostPoint const & point) const;
   double CalculateOverlapPercentage(Region const & other) const;
+  // Returns whether CalculateOverlapPercentage(other) is less than |percentage|. Decides on
+  // simplified polygons when their errors cannot change the answer.
+  bool IsOverlapPercentageLess(Region const & other, double percentage) const;
   BoostPoint GetCenter() const;
   bool IsLocality() const;
   BoostRect const & GetRect() const { return m_rect; }
@@ -54,10 +57,14 @@ public:
   double GetArea() const { return m_area; }
 
 private:
+  class SimplifiedPolygons;
+
   void FillPolygon(feature::FeatureBuilder const & fb);
 
   boost::optional<PlacePoint> m_placeLabel;
   std::shared_ptr<BoostPolygon> m_polygon;
+  // Shared by the copies of the region, built on the first overlap test.
+  std::shared_ptr<SimplifiedPolygons> m_simplifiedPolygons;
   BoostRect m_rect;
   double m_area;
 };
@@ -4,6 +4,9 @@
 
 #include "base/logging.hpp"
 
+#include <algorithm>
+#include <utility>
+
 namespace generator
 {
 namespace regions
@@ -13,6 +16,11 @@ RegionInfoGetter::RegionInfoGetter(std::string const & indexPath, std::string co
     , m_storage(kvPath, 1'000'000)
 {
   m_borders.Deserialize(indexPath);
+
+  m_borders.ForEachId([this](uint64_t id) {
+    if (auto const region = m_storage.Find(id))
+      m_ranks.push_back({id, GetRank(*region), GetDref(*region)});
+  });
 }
 
 boost::optional<KeyValue> RegionInfoGetter::FindDeepest(m2::PointD const & point) const
@@ -25,55 +33,116 @@ boost::optional<KeyValue> RegionInfoGetter::FindDeepest(
 {
   static_assert(std::is_base_of<ConcurrentGetProcessability, RegionInfoGetter>::value, "");
 
-  auto const ids = SearchObjectsInIndex(point);
-  return GetDeepest(point, ids, selector);
+  return GetDeepest(point, GetCandidates(Index::GetIntervalsAtPoint(point)), selector);
 }
 
-std::vector<base::GeoObjectId> RegionInfoGetter::SearchObjectsInIndex(m2::PointD const & point) const
+std::vector<boost::optional<KeyValue>> RegionInfoGetter::FindDeepest(
+    std::vector<m2::PointD> const & points) const
 {
-  std::vector<base::GeoObjectId> ids;
-  auto const emplace = [&ids] (base::GeoObjectId const & osmId) { ids.emplace_back(osmId); };
-  m_index.ForEachAtPoint(emplace, point);
-  return ids;
+  return FindDeepest(points, [] (...) { return true; });
 }
 
-boost::optional<KeyValue> RegionInfoGetter::GetDeepest(m2::PointD const & point,
-    std::vector<base::GeoObjectId> const & ids, Selector const & selector) const
+std::vector<boost::optional<KeyValue>> RegionInfoGetter::FindDeepest(
+    std::vector<m2::PointD> const & points, Selector const & selector) const
 {
-  // Minimize CPU consumption by minimizing the number of calls to heavy m_borders.IsPointInside().
-  std::multimap<int, KeyValue> regionsByRank;
-  for (auto const & id : ids)
+  std::vector<std::pair<int64_t, size_t>> order;
+  order.reserve(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    order.emplace_back(Index::GetCellOrder(points[i]), i);
+  std::sort(order.begin(), order.end());
+
+  std::vector<boost::optional<KeyValue>> result(points.size());
+  covering::Intervals intervals;
+  Candidates candidates;
+  boost::optional<size_t> prev;
+  for (auto const & item : order)
   {
-    auto const region = m_storage.Find(id.GetEncodedId());
-    if (!region)
+    auto const i = item.second;
+    auto const & point = points[i];
+    if (prev && points[*prev] == point)
     {
-      LOG(LWARNING, ("Id not found in region key-value storage:", id));
+      result[i] = result[*prev];
       continue;
     }
 
-    auto rank = GetRank(*region);
-    regionsByRank.emplace(rank, KeyValue{id.GetEncodedId(), std::move(region)});
+    auto pointIntervals = Index::GetIntervalsAtPoint(point);
+    if (!prev || pointIntervals != intervals)
+    {
+      intervals = std::move(pointIntervals);
+      candidates = GetCandidates(intervals);
+    }
+
+    result[i] = GetDeepest(point, candidates, selector);
+    prev = i;
   }
 
+  return result;
+}
+
+RegionInfoGetter::Candidates RegionInfoGetter::GetCandidates(
+    covering::Intervals const & intervals) const
+{
+  Candidates candidates;
+  m_index.ForEachInIntervals([&](base::GeoObjectId const & id) {
+    auto region = GetRegionRank(id.GetEncodedId());
+    if (!region)
+    {
+      LOG(LWARNING, ("Id not found in region key-value storage:", id));
+      return;
+    }
+
+    candidates.push_back(std::move(*region));
+  }, intervals);
+
+  // The deepest regions first, the regions of the same rank in the reverse order of the index.
+  std::reverse(candidates.begin(), candidates.end());
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](RegionRank const & lhs, RegionRank const & rhs) {
+                     return lhs.m_rank > rhs.m_rank;
+                   });
+  return candidates;
+}
+
+boost::optional<KeyValue> RegionInfoGetter::GetDeepest(m2::PointD const & point,
+    Candidates const & candidates, Selector const & selector) const
+{
+  // Minimize CPU consumption by minimizing the number of calls to heavy m_borders.IsPointInside().
   boost::optional<uint64_t> borderCheckSkipRegionId;
-  for (auto i = regionsByRank.rbegin(); i != regionsByRank.rend(); ++i)
+  for (auto const & region : candidates)
   {
-    auto & kv = i->second;
-    auto regionId = kv.first;
+    auto const regionId = region.m_id;
     if (regionId != borderCheckSkipRegionId && !m_borders.IsPointInside(regionId, point))
       continue;
 
-    if (selector(kv))
-      return std::move(kv);
+    auto kv = KeyValue{regionId, m_storage.Find(regionId)};
+    if (kv.second && selector(kv))
+      return kv;
 
     // Skip border check for parent region.
-    if (auto dref = GetDref(*kv.second))
-      borderCheckSkipRegionId = dref;
+    if (region.m_dref)
+      borderCheckSkipRegionId = region.m_dref;
   }
 
   return {};
 }
 
+boost::optional<RegionInfoGetter::RegionRank> RegionInfoGetter::GetRegionRank(uint64_t id) const
+{
+  auto const it = std::lower_bound(m_ranks.cbegin(), m_ranks.cend(), id,
+                                   [](RegionRank const & region, uint64_t id) {
+                                     return region.m_id < id;
+                                   });
+  if (it != m_ranks.cend() && it->m_id == id)
+    return *it;
+
+  // The region has no border.
+  auto const region = m_storage.Find(id);
+  if (!region)
+    return {};
+
+  return RegionRank{id, GetRank(*region), GetDref(*region)};
+}
+
 int RegionInfoGetter::GetRank(JsonValue const & json) const
 {
   auto && properties = base::GetJSONObligatoryField(json, "properties");
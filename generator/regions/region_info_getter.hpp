@@ -9,6 +9,7 @@
 
 #include "geometry/point2d.hpp"
 
+#include "base/buffer_vector.hpp"
 #include "base/geo_object_id.hpp"
 
 #include <string>
@@ -35,21 +36,43 @@ public:
 
   boost::optional<KeyValue> FindDeepest(m2::PointD const & point) const;
   boost::optional<KeyValue> FindDeepest(m2::PointD const & point, Selector const & selector) const;
+  // Finds the deepest regions of a batch of points. The points are processed in the order of
+  // the index cells, so the neighbouring points share the index scans. The results are in
+  // the order of |points|.
+  std::vector<boost::optional<KeyValue>> FindDeepest(std::vector<m2::PointD> const & points) const;
+  std::vector<boost::optional<KeyValue>> FindDeepest(std::vector<m2::PointD> const & points,
+                                                     Selector const & selector) const;
   KeyValueStorage const & GetStorage() const noexcept;
 
 private:
   using IndexReader = ReaderPtr<Reader>;
+  using Index = indexer::RegionsIndex<IndexReader>;
 
-  std::vector<base::GeoObjectId> SearchObjectsInIndex(m2::PointD const & point) const;
-  boost::optional<KeyValue> GetDeepest(m2::PointD const & point, std::vector<base::GeoObjectId> const & ids,
+  // Fields of a region which are needed to choose the deepest region.
+  struct RegionRank
+  {
+    uint64_t m_id = 0;
+    int m_rank = 0;
+    boost::optional<uint64_t> m_dref;
+  };
+
+  // Candidate regions of a point from the deepest ones.
+  using Candidates = buffer_vector<RegionRank, 16>;
+
+  Candidates GetCandidates(covering::Intervals const & intervals) const;
+  boost::optional<KeyValue> GetDeepest(m2::PointD const & point, Candidates const & candidates,
                                        Selector const & selector) const;
   int GetRank(JsonValue const & json) const;
   // Get parent id of object: optional field `properties.dref` in JSON.
   boost::optional<uint64_t> GetDref(JsonValue const & json) const;
 
-  indexer::RegionsIndex<IndexReader> m_index;
+  boost::optional<RegionRank> GetRegionRank(uint64_t id) const;
+
+  Index m_index;
   indexer::Borders m_borders;
   KeyValueStorage m_storage;
+  // Ranks of the regions of |m_borders| sorted by the ids.
+  std::vector<RegionRank> m_ranks;
 };
 }  // namespace regions
 }  // namespace generator
@@ -17,10 +17,13 @@
 #include "base/file_name_utils.hpp"
 #include "base/logging.hpp"
 #include "base/stl_helpers.hpp"
+#include "base/thread_pool_computational.hpp"
 #include "base/timer.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <map>
 #include <memory>
 #include <numeric>
@@ -53,6 +56,7 @@ public:
     , m_pathOutRegionsKv{pathOutRegionsKv}
     , m_pathOutRepackedRegionsTmpMwm{pathOutRepackedRegionsTmpMwm}
     , m_verbose{verbose}
+    , m_threadsCount{threadsCount}
     , m_regionsInfoCollector{pathInRegionsCollector}
     , m_regionsKv{pathOutRegionsKv, std::ofstream::out}
   {
@@ -66,18 +70,55 @@ public:
     RegionsBuilder builder{std::move(regions), std::move(placePointsMap), threadsCount};
 
     GenerateRegions(builder);
+    m_regionsKv.close();
+    // The regions are looked up by the next stages in the binary storage.
+    KeyValueStorage::BuildBinary(m_pathOutRegionsKv);
     LOG(LINFO, ("Finish generating regions.", timer.ElapsedSeconds(), "seconds."));
   }
 
 private:
+  // Objects of a country in the order of writing with the paths to their regions.
+  struct CountryObjects
+  {
+    std::vector<base::GeoObjectId> m_order;
+    std::map<base::GeoObjectId, NodePath> m_paths;
+  };
+
   void GenerateRegions(RegionsBuilder & builder)
   {
-    builder.ForEachCountry([&](std::string const & /*name*/, Node::PtrList const & outers) {
-      auto const & countryPlace = outers.front()->GetData();
-      auto const & countryName =
-          countryPlace.GetTranslatedOrTransliteratedName(StringUtf8Multilang::GetLangIndex("en"));
-      GenerateKv(countryName, outers);
-    });
+    // The objects of the countries are collected sequentially as the first country of an object
+    // wins. Their values are built concurrently and written in the order of the countries.
+    std::queue<std::future<std::string>> countriesKv;
+    auto const writeCountriesKv = [&](bool waitAll) {
+      while (!countriesKv.empty())
+      {
+        auto & countryKv = countriesKv.front();
+        if (!waitAll &&
+            countryKv.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+          break;
+        }
+
+        m_regionsKv << countryKv.get();
+        countriesKv.pop();
+      }
+    };
+
+    {
+      base::thread_pool::computational::ThreadPool threadPool(m_threadsCount);
+      builder.ForEachCountry([&](std::string const & /*name*/, Node::PtrList const & outers) {
+        auto const & countryPlace = outers.front()->GetData();
+        auto const & countryName = countryPlace.GetTranslatedOrTransliteratedName(
+            StringUtf8Multilang::GetLangIndex("en"));
+        auto countryObjects = CollectCountryObjects(countryName, outers);
+        countriesKv.push(threadPool.Submit(
+            [this, countryObjects = std::move(countryObjects)]() {
+              return SerializeObjectsKv(countryObjects);
+            }));
+        writeCountriesKv(false /* waitAll */);
+      });
+      writeCountriesKv(true /* waitAll */);
+    }
 
     LOG(LINFO, ("Regions objects key-value for", builder.GetCountryInternationalNames().size(),
                 "countries storage saved to", m_pathOutRegionsKv));
@@ -157,7 +198,8 @@ private:
     return feature;
   }
 
-  void GenerateKv(std::string const & countryName, Node::PtrList const & outers)
+  CountryObjects CollectCountryObjects(std::string const & countryName,
+                                      Node::PtrList const & outers)
   {
     LOG(LINFO, ("Generate country", countryName));
 
@@ -165,8 +207,9 @@ private:
     size_t countryRegionsCount = 0;
     size_t countryObjectCount = 0;
 
-    std::vector<base::GeoObjectId> objectsOrder;
-    std::map<base::GeoObjectId, NodePath> objectsPaths;
+    CountryObjects countryObjects;
+    auto & objectsOrder = countryObjects.m_order;
+    auto & objectsPaths = countryObjects.m_paths;
 
     for (auto const & tree : outers)
     {
@@ -206,23 +249,25 @@ private:
       });
     }
 
-    WriteObjectsInKv(objectsOrder, objectsPaths);
-
     LOG(LINFO, ("Country regions of", *country, "has built:", countryRegionsCount, "total regions.",
                 countryObjectCount, "objects."));
+    return countryObjects;
   }
 
-  void WriteObjectsInKv(std::vector<base::GeoObjectId> const & objectsOrder,
-                        std::map<base::GeoObjectId, NodePath> const & objectsPaths)
+  std::string SerializeObjectsKv(CountryObjects const & countryObjects) const
   {
-    for (auto const & objectId : objectsOrder)
+    std::string kv;
+    for (auto const & objectId : countryObjects.m_order)
     {
-      auto pathIter = objectsPaths.find(objectId);
-      CHECK(pathIter != objectsPaths.end(), ());
+      auto pathIter = countryObjects.m_paths.find(objectId);
+      CHECK(pathIter != countryObjects.m_paths.end(), ());
       auto const & path = pathIter->second;
-      m_regionsKv << KeyValueStorage::SerializeDref(objectId.GetEncodedId()) << " "
-                  << KeyValueStorage::Serialize(BuildRegionValue(path)) << "\n";
+      kv += KeyValueStorage::SerializeDref(objectId.GetEncodedId());
+      kv += ' ';
+      kv += KeyValueStorage::Serialize(BuildRegionValue(path));
+      kv += '\n';
     }
+    return kv;
   }
 
   std::tuple<RegionsBuilder::Regions, PlacePointsMap> ReadDatasetFromTmpMwm(
@@ -319,6 +364,7 @@ private:
   std::string m_pathOutRepackedRegionsTmpMwm;
 
   bool m_verbose{false};
+  size_t m_threadsCount;
 
   RegionInfo m_regionsInfoCollector;
 
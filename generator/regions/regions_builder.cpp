@@ -13,6 +13,7 @@
 #include <chrono>
 #include <fstream>
 #include <functional>
+#include <iterator>
 #include <numeric>
 #include <queue>
 #include <thread>
@@ -22,6 +23,21 @@ namespace generator
 {
 namespace regions
 {
+namespace
+{
+template <typename RectsTree, typename Items, typename GetRect>
+RectsTree MakeRectsTree(Items const & items, GetRect && getRect)
+{
+  std::vector<typename RectsTree::value_type> rects;
+  rects.reserve(items.size());
+  for (size_t i = 0; i < items.size(); ++i)
+    rects.emplace_back(getRect(items[i]), i);
+
+  // Packing construction.
+  return RectsTree(rects.begin(), rects.end());
+}
+}  // namespace
+
 RegionsBuilder::RegionsBuilder(Regions && regions, PlacePointsMap && placePointsMap,
                                size_t threadsCount)
   : m_threadsCount(threadsCount)
@@ -36,6 +52,8 @@ RegionsBuilder::RegionsBuilder(Regions && regions, PlacePointsMap && placePoints
 
   m_regionsInAreaOrder = FormRegionsInAreaOrder(std::move(regions));
   m_countriesOuters = ExtractCountriesOuters(m_regionsInAreaOrder);
+  m_regionsTree = MakeRectsTree<RectsTree>(
+      m_regionsInAreaOrder, [](Region const & region) { return region.GetRect(); });
   m_placePointsMap = std::move(placePointsMap);
 }
 
@@ -117,15 +135,18 @@ Node::Ptr RegionsBuilder::BuildCountryRegionTree(
     boost::optional<std::string> const & countryCode,
     CountrySpecifier const & countrySpecifier) const
 {
-  auto nodes = MakeCountryNodesInAreaOrder(outer, m_regionsInAreaOrder, countryCode,
-                                           countrySpecifier);
+  auto nodes = MakeCountryNodesInAreaOrder(outer, countryCode, countrySpecifier);
+  auto const nodesTree = MakeRectsTree<RectsTree>(
+      nodes, [](Node::Ptr const & node) { return node->GetData().GetRect(); });
+  AffiliationsMemo affiliationsMemo;
 
-  for (auto i = std::crbegin(nodes), end = std::crend(nodes); i != end; ++i)
+  for (size_t i = nodes.size(); i > 0; --i)
   {
-    if (auto parent = ChooseParent(nodes, i, countrySpecifier))
+    auto const & node = nodes[i - 1];
+    if (auto parent = ChooseParent(nodes, nodesTree, i - 1, countrySpecifier, affiliationsMemo))
     {
-      (*i)->SetParent(parent);
-      parent->AddChild(*i);
+      node->SetParent(parent);
+      parent->AddChild(node);
     }
   }
 
@@ -133,44 +154,64 @@ Node::Ptr RegionsBuilder::BuildCountryRegionTree(
 }
 
 std::vector<Node::Ptr> RegionsBuilder::MakeCountryNodesInAreaOrder(
-    Region const & countryOuter, Regions const & regionsInAreaOrder,
-    boost::optional<std::string> const & countryCode,
+    Region const & countryOuter, boost::optional<std::string> const & countryCode,
     CountrySpecifier const & countrySpecifier) const
 {
+  std::vector<RectsTree::value_type> regionsInOuterRect;
+  m_regionsTree.query(boost::geometry::index::covered_by(countryOuter.GetRect()),
+                      std::back_inserter(regionsInOuterRect));
+  std::sort(std::begin(regionsInOuterRect), std::end(regionsInOuterRect),
+            base::LessBy(&RectsTree::value_type::second));
+
   std::vector<Node::Ptr> nodes{
       std::make_shared<Node>(LevelRegion{PlaceLevel::Country, countryOuter})};
-  for (auto const & region : regionsInAreaOrder)
+  for (auto const & item : regionsInOuterRect)
   {
-    if (countryOuter.ContainsRect(region))
-    {
-      auto && regionIsoCode = region.GetIsoCode();
-      if (regionIsoCode && countryCode && GetCountryCode(*regionIsoCode) != *countryCode)
-        continue;
+    auto const & region = m_regionsInAreaOrder[item.second];
+    auto && regionIsoCode = region.GetIsoCode();
+    if (regionIsoCode && countryCode && GetCountryCode(*regionIsoCode) != *countryCode)
+      continue;
 
-      auto level = strings::IsASCIINumeric(region.GetName()) ? PlaceLevel::Unknown
-                                                             : countrySpecifier.GetLevel(region);
-      auto node = std::make_shared<Node>(LevelRegion{level, region});
-      nodes.emplace_back(std::move(node));
-    }
+    auto level = strings::IsASCIINumeric(region.GetName()) ? PlaceLevel::Unknown
+                                                           : countrySpecifier.GetLevel(region);
+    auto node = std::make_shared<Node>(LevelRegion{level, region});
+    nodes.emplace_back(std::move(node));
   }
 
   return nodes;
 }
 
 Node::Ptr RegionsBuilder::ChooseParent(std::vector<Node::Ptr> const & nodesInAreaOrder,
-                                       std::vector<Node::Ptr>::const_reverse_iterator forItem,
-                                       CountrySpecifier const & countrySpecifier) const
+                                       RectsTree const & nodesTree, size_t forItem,
+                                       CountrySpecifier const & countrySpecifier,
+                                       AffiliationsMemo & affiliationsMemo) const
 {
-  auto const & node = *forItem;
-  auto const & region = node->GetData();
-
-  auto const from = FindAreaLowerBoundRely(nodesInAreaOrder, forItem);
-  CHECK(from <= forItem, ());
+  auto const & region = nodesInAreaOrder[forItem]->GetData();
+
+  auto const forItemIt =
+      std::crbegin(nodesInAreaOrder) + (nodesInAreaOrder.size() - 1 - forItem);
+  auto const from = FindAreaLowerBoundRely(nodesInAreaOrder, forItemIt);
+  CHECK(from <= forItemIt, ());
+  auto const fromItem = nodesInAreaOrder.size() - 1 -
+                        static_cast<size_t>(std::distance(std::crbegin(nodesInAreaOrder), from));
+
+  // A parent contains the rect or the center of the region, so its rect intersects both.
+  auto queryRect = region.GetRect();
+  boost::geometry::expand(queryRect, region.GetCenter());
+  std::vector<RectsTree::value_type> candidates;
+  nodesTree.query(boost::geometry::index::intersects(queryRect) &&
+                      boost::geometry::index::satisfies([fromItem](auto const & item) {
+                        return item.second <= fromItem;
+                      }),
+                  std::back_inserter(candidates));
+  // From the smaller areas to the larger ones.
+  std::sort(std::begin(candidates), std::end(candidates),
+            [](auto const & lhs, auto const & rhs) { return lhs.second > rhs.second; });
 
   Node::Ptr parent;
-  for (auto i = from, end = std::crend(nodesInAreaOrder); i != end; ++i)
+  for (auto const & item : candidates)
   {
-    auto const & candidate = *i;
+    auto const & candidate = nodesInAreaOrder[item.second];
     auto const & candidateRegion = candidate->GetData();
 
     if (parent)
@@ -183,20 +224,24 @@ Node::Ptr RegionsBuilder::ChooseParent(std::vector<Node::Ptr> const & nodesInAre
     if (!candidateRegion.ContainsRect(region) && !candidateRegion.Contains(region.GetCenter()))
       continue;
 
-    if (i == forItem)
+    if (item.second == forItem)
       continue;
 
-    auto const c = CompareAffiliation(candidateRegion, region, countrySpecifier);
+    auto const c = CompareAffiliation(candidateRegion, region, countrySpecifier, affiliationsMemo);
     if (c == 1)
     {
-      if (parent && 0 <= CompareAffiliation(candidateRegion, parent->GetData(), countrySpecifier))
+      if (parent && 0 <= CompareAffiliation(candidateRegion, parent->GetData(), countrySpecifier,
+                                            affiliationsMemo))
+      {
         continue;
+      }
 
       parent = candidate;
     }
   }
 
-  CHECK(!parent || -1 == CompareAffiliation(region, parent->GetData(), countrySpecifier),
+  CHECK(!parent ||
+            -1 == CompareAffiliation(region, parent->GetData(), countrySpecifier, affiliationsMemo),
         (GetRegionNotation(region), GetRegionNotation(parent->GetData())));
   return parent;
 }
@@ -263,7 +308,7 @@ int RegionsBuilder::CompareAffiliation(LevelRegion const & l, LevelRegion const
   if (IsAreaLessRely(l, r) && r.Contains(l))
     return -1;
 
-  if (l.CalculateOverlapPercentage(r) < 50.0)
+  if (l.IsOverlapPercentageLess(r, 50.0))
     return 0;
 
   auto const lArea = l.GetArea();
@@ -286,6 +331,21 @@ int RegionsBuilder::CompareAffiliation(LevelRegion const & l, LevelRegion const
   return countrySpecifier.RelateByWeight(l, r);
 }
 
+// static
+int RegionsBuilder::CompareAffiliation(LevelRegion const & l, LevelRegion const & r,
+                                       CountrySpecifier const & countrySpecifier,
+                                       AffiliationsMemo & affiliationsMemo)
+{
+  auto const key = std::make_pair(&l, &r);
+  auto const it = affiliationsMemo.find(key);
+  if (it != affiliationsMemo.end())
+    return it->second;
+
+  auto const c = CompareAffiliation(l, r, countrySpecifier);
+  affiliationsMemo.emplace(key, c);
+  return c;
+}
+
 // static
 bool RegionsBuilder::IsAreaLessRely(Region const & l, Region const & r)
 {
@@ -9,8 +9,10 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/geometry/index/rtree.hpp>
 #include <boost/optional.hpp>
 
 namespace generator
@@ -55,21 +57,32 @@ private:
   Node::Ptr BuildCountryRegionTree(Region const & outer,
                                    boost::optional<std::string> const & countryCode,
                                    CountrySpecifier const & countrySpecifier) const;
+  // R-tree of the rects of the regions or the nodes with their positions in the area order.
+  using RectsTree = boost::geometry::index::rtree<std::pair<BoostRect, size_t>,
+                                                  boost::geometry::index::rstar<16>>;
+
   std::vector<Node::Ptr> MakeCountryNodesInAreaOrder(
-      Region const & countryOuter, Regions const & regionsInAreaOrder,
-      boost::optional<std::string> const & countryCode,
+      Region const & countryOuter, boost::optional<std::string> const & countryCode,
       CountrySpecifier const & countrySpecifier) const;
+  // Memo of CompareAffiliation() for the regions of the nodes of a country tree.
+  using AffiliationsMemo = std::map<std::pair<LevelRegion const *, LevelRegion const *>, int>;
+
   Node::Ptr ChooseParent(std::vector<Node::Ptr> const & nodesInAreaOrder,
-                         std::vector<Node::Ptr>::const_reverse_iterator forItem,
-                         CountrySpecifier const & countrySpecifier) const;
+                         RectsTree const & nodesTree, size_t forItem,
+                         CountrySpecifier const & countrySpecifier,
+                         AffiliationsMemo & affiliationsMemo) const;
   std::vector<Node::Ptr>::const_reverse_iterator FindAreaLowerBoundRely(
       std::vector<Node::Ptr> const & nodesInAreaOrder,
       std::vector<Node::Ptr>::const_reverse_iterator forItem) const;
   static void InsertIntoSubtree(Node::Ptr & subtree, Node::Ptr && newNode,
                                 CountrySpecifier const & countrySpecifier);
+  static int CompareAffiliation(LevelRegion const & l, LevelRegion const & r,
+                                CountrySpecifier const & countrySpecifier,
+                                AffiliationsMemo & affiliationsMemo);
 
   Regions m_countriesOuters;
   Regions m_regionsInAreaOrder;
+  RectsTree m_regionsTree;
   PlacePointsMap m_placePointsMap;
   size_t m_threadsCount;
 };
@@ -11,6 +11,7 @@
 #include "base/logging.hpp"
 
 #include <utility>
+#include <vector>
 
 #include "3party/jansson/myjansson.hpp"
 
@@ -34,17 +35,38 @@ void StreetsBuilder::AssembleStreets(std::string const & pathInStreetsTmpMwm)
 
 void StreetsBuilder::AssembleBindings(std::string const & pathInGeoObjectsTmpMwm)
 {
-  auto const transform = [this](FeatureBuilder & fb, uint64_t /* currPos */) {
-    std::string streetName = fb.GetParams().GetStreet();
-    if (!streetName.empty())
+  // The regions of the bindings are looked up by chunks: the neighbouring objects of a chunk
+  // share the index scans, see regions::RegionInfoGetter::FindDeepest().
+  auto const transform = [this](std::vector<FeatureBuilder> & fbs) {
+    std::vector<FeatureBuilder *> bindings;
+    std::vector<m2::PointD> points;
+    for (auto & fb : fbs)
     {
+      if (fb.GetParams().GetStreet().empty())
+        continue;
+
+      bindings.push_back(&fb);
+      points.push_back(fb.GetKeyPoint());
+    }
+
+    auto const regions = FindStreetRegionOwners(points);
+
+    std::lock_guard<std::mutex> lock{m_updateMutex};
+    for (size_t i = 0; i < bindings.size(); ++i)
+    {
+      if (!regions[i])
+        continue;
+
+      auto & fb = *bindings[i];
+      std::string streetName = fb.GetParams().GetStreet();
       // TODO maybe (lagrunge): add localizations on street:lang tags
       StringUtf8Multilang multilangName;
       multilangName.AddString(StringUtf8Multilang::kDefaultCode, streetName);
-      AddStreetBinding(std::move(streetName), fb, multilangName);
+      AddStreetBinding(regions[i]->first, std::move(streetName), fb, multilangName);
     }
   };
-  ForEachParallelFromDatRawFormat(m_threadsCount, pathInGeoObjectsTmpMwm, transform);
+  ForEachChunkParallelFromDatRawFormat(m_threadsCount, kBindingsChunkSize, pathInGeoObjectsTmpMwm,
+                                       transform);
 }
 
 void StreetsBuilder::SaveStreetsKv(std::ostream & streamStreetsKv)
@@ -129,38 +151,44 @@ void StreetsBuilder::AddStreetPoint(FeatureBuilder & fb)
   street.m_geometry.SetPin({fb.GetKeyPoint(), osmId});
 }
 
-void StreetsBuilder::AddStreetBinding(std::string && streetName, FeatureBuilder & fb,
-                                      StringUtf8Multilang const & multiLangName)
+void StreetsBuilder::AddStreetBinding(uint64_t regionId, std::string && streetName,
+                                      FeatureBuilder & fb, StringUtf8Multilang const & multiLangName)
 {
-  auto const region = FindStreetRegionOwner(fb.GetKeyPoint());
-  if (!region)
-    return;
-
-  std::lock_guard<std::mutex> lock{m_updateMutex};
-
-  auto & street = InsertStreet(region->first, std::move(streetName), multiLangName);
+  auto & street = InsertStreet(regionId, std::move(streetName), multiLangName);
   street.m_geometry.AddBinding(NextOsmSurrogateId(), fb.GetKeyPoint());
 }
 
 boost::optional<KeyValue> StreetsBuilder::FindStreetRegionOwner(m2::PointD const & point,
                                                                 bool needLocality)
 {
-  auto const isStreetAdministrator = [needLocality](KeyValue const & region) {
-    auto && address = base::GetJSONObligatoryFieldByPath(*region.second, "properties", "locales",
-                                                         "default", "address");
+  return m_regionInfoGetter.FindDeepest(point, [needLocality](KeyValue const & region) {
+    return IsStreetAdministrator(region, needLocality);
+  });
+}
 
-    if (base::GetJSONOptionalField(address, "suburb"))
-      return false;
-    if (base::GetJSONOptionalField(address, "sublocality"))
-      return false;
+std::vector<boost::optional<KeyValue>> StreetsBuilder::FindStreetRegionOwners(
+    std::vector<m2::PointD> const & points, bool needLocality)
+{
+  return m_regionInfoGetter.FindDeepest(points, [needLocality](KeyValue const & region) {
+    return IsStreetAdministrator(region, needLocality);
+  });
+}
 
-    if (needLocality && !base::GetJSONOptionalField(address, "locality"))
-      return false;
+// static
+bool StreetsBuilder::IsStreetAdministrator(KeyValue const & region, bool needLocality)
+{
+  auto && address = base::GetJSONObligatoryFieldByPath(*region.second, "properties", "locales",
+                                                       "default", "address");
 
-    return true;
-  };
+  if (base::GetJSONOptionalField(address, "suburb"))
+    return false;
+  if (base::GetJSONOptionalField(address, "sublocality"))
+    return false;
+
+  if (needLocality && !base::GetJSONOptionalField(address, "locality"))
+    return false;
 
-  return m_regionInfoGetter.FindDeepest(point, isStreetAdministrator);
+  return true;
 }
 
 StringUtf8Multilang MergeNames(const StringUtf8Multilang & first,
@@ -18,6 +18,7 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/optional.hpp>
 
@@ -48,6 +49,9 @@ private:
   };
   using RegionStreets = std::unordered_map<std::string, Street>;
 
+  // Number of the consecutive geo objects whose street bindings are looked up in a batch.
+  static size_t constexpr kBindingsChunkSize = 4096;
+
   void SaveRegionStreetsKv(std::ostream & streamStreetsKv, uint64_t regionId,
                            RegionStreets const & streets);
 
@@ -55,10 +59,14 @@ private:
   void AddStreetHighway(feature::FeatureBuilder & fb);
   void AddStreetArea(feature::FeatureBuilder & fb);
   void AddStreetPoint(feature::FeatureBuilder & fb);
-  void AddStreetBinding(std::string && streetName, feature::FeatureBuilder & fb,
-                        StringUtf8Multilang const & multiLangName);
+  void AddStreetBinding(uint64_t regionId, std::string && streetName,
+                        feature::FeatureBuilder & fb, StringUtf8Multilang const & multiLangName);
   boost::optional<KeyValue> FindStreetRegionOwner(m2::PointD const & point,
                                                   bool needLocality = false);
+  // The results are in the order of |points|.
+  std::vector<boost::optional<KeyValue>> FindStreetRegionOwners(
+      std::vector<m2::PointD> const & points, bool needLocality = false);
+  static bool IsStreetAdministrator(KeyValue const & region, bool needLocality);
   Street & InsertStreet(uint64_t regionId, std::string && streetName,
                         StringUtf8Multilang const & multilangName);
   base::JSONPtr MakeStreetValue(uint64_t regionId, JsonValue const & regionObject,
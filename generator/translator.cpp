@@ -62,6 +62,11 @@ void Translator::Emit(OsmElement & element)
   }
 }
 
+void Translator::SetTimes(std::shared_ptr<OperationsTimes> const & times)
+{
+  m_collector->SetTimes(times);
+}
+
 void Translator::Finish()
 {
   m_collector->Finish();
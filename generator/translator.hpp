@@ -40,6 +40,7 @@ public:
 
   // TranslatorInterface overrides:
   void Emit(OsmElement & element) override;
+  void SetTimes(std::shared_ptr<OperationsTimes> const & times) override;
   void Finish() override;
   bool Save() override;
 
@@ -2,8 +2,12 @@
 
 #include "generator/osm_element.hpp"
 
+#include "base/logging.hpp"
+#include "base/timer.hpp"
+
 #include <algorithm>
 #include <iterator>
+#include <vector>
 
 namespace generator
 {
@@ -13,9 +17,22 @@ TranslatorCollection::Clone() const
   auto p = std::make_shared<TranslatorCollection>();
   for (auto const & c : m_collection)
     p->Append(c->Clone());
+  p->m_times = m_times;
   return p;
 }
 
+std::string TranslatorCollection::GetName() const
+{
+  return "Collection";
+}
+
+void TranslatorCollection::SetTimes(std::shared_ptr<OperationsTimes> const & times)
+{
+  m_times = times;
+  for (auto & t : m_collection)
+    t->SetTimes(times);
+}
+
 void TranslatorCollection::Emit(OsmElement /* const */ & element)
 {
   for (auto & t : m_collection)
@@ -27,15 +44,23 @@ void TranslatorCollection::Emit(OsmElement /* const */ & element)
 
 void TranslatorCollection::Finish()
 {
-  for (auto & t : m_collection)
-    t->Finish();
+  ForEachIndexInParallel(m_collection.size(), [&](size_t i) {
+    base::Timer const timer;
+    m_collection[i]->Finish();
+    AddTime(i, "finish", timer);
+  });
 }
 
 bool TranslatorCollection::Save()
 {
-  return std::all_of(std::begin(m_collection), std::end(m_collection), [](auto & t) {
-    return t->Save();
+  // Not std::vector<bool>: the elements are written concurrently.
+  std::vector<char> saved(m_collection.size(), false);
+  ForEachIndexInParallel(m_collection.size(), [&](size_t i) {
+    base::Timer const timer;
+    saved[i] = m_collection[i]->Save();
+    AddTime(i, "save", timer);
   });
+  return std::all_of(std::begin(saved), std::end(saved), [](char s) { return s; });
 }
 
 void TranslatorCollection::Merge(TranslatorInterface const & other)
@@ -47,7 +72,20 @@ void TranslatorCollection::MergeInto(TranslatorCollection & other) const
 {
   auto & otherCollection = other.m_collection;
   CHECK_EQUAL(m_collection.size(), otherCollection.size(), ());
-  for (size_t i = 0; i < m_collection.size(); ++i)
+  ForEachIndexInParallel(m_collection.size(), [&](size_t i) {
+    base::Timer const timer;
     otherCollection[i]->Merge(*m_collection[i]);
+    other.AddTime(i, "merge", timer);
+  });
+}
+
+void TranslatorCollection::AddTime(size_t i, std::string const & operation,
+                                   base::Timer const & timer) const
+{
+  auto const seconds = timer.ElapsedSeconds();
+  auto const name = m_collection[i]->GetName();
+  LOG(LINFO, ("Translator", name, operation, "seconds:", seconds));
+  if (m_times)
+    m_times->Add("Translator " + name, operation, seconds);
 }
 }  // namespace generator
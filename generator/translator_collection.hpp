@@ -3,7 +3,11 @@
 #include "generator/collection_base.hpp"
 #include "generator/translator_interface.hpp"
 
+#include "base/timer.hpp"
+
+#include <cstddef>
 #include <memory>
+#include <string>
 
 namespace generator
 {
@@ -13,6 +17,8 @@ class TranslatorCollection : public CollectionBase<std::shared_ptr<TranslatorInt
 public:
   // TranslatorInterface overrides:
   std::shared_ptr<TranslatorInterface> Clone() const override;
+  std::string GetName() const override;
+  void SetTimes(std::shared_ptr<OperationsTimes> const & times) override;
 
   void Emit(OsmElement /* const */ & element) override;
 
@@ -21,5 +27,10 @@ public:
 
   void Merge(TranslatorInterface const & other) override;
   void MergeInto(TranslatorCollection & other) const override;
+
+private:
+  void AddTime(size_t i, std::string const & operation, base::Timer const & timer) const;
+
+  std::shared_ptr<OperationsTimes> m_times;
 };
 }  // namespace generator
@@ -25,6 +25,11 @@ TranslatorGeoObjects::Clone() const
   return Translator::CloneBase<TranslatorGeoObjects>();
 }
 
+std::string TranslatorGeoObjects::GetName() const
+{
+  return "GeoObjects";
+}
+
 void TranslatorGeoObjects::Merge(TranslatorInterface const & other)
 {
   other.MergeInto(*this);
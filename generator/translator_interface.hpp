@@ -24,6 +24,7 @@ class TranslatorWorld;
 class TranslatorWorldWithAds;
 class TranslatorStreets;
 class TranslatorCollection;
+class OperationsTimes;
 
 // Implementing this interface allows an object to create intermediate data from OsmElement.
 class TranslatorInterface
@@ -33,6 +34,12 @@ public:
 
   virtual std::shared_ptr<TranslatorInterface> Clone() const = 0;
 
+  // The name is used in the logs and in the statistics of the stages of RawGenerator.
+  virtual std::string GetName() const = 0;
+  // The times of Finish(), Merge() and Save() are added to |times| by the translator, its
+  // collectors and their future clones.
+  virtual void SetTimes(std::shared_ptr<OperationsTimes> const & /* times */) {}
+
   virtual void Preprocess(OsmElement &) {}
   virtual void Emit(OsmElement & element) = 0;
   virtual void Finish() = 0;
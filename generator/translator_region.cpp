@@ -69,6 +69,11 @@ TranslatorRegion::Clone() const
   return Translator::CloneBase<TranslatorRegion>();
 }
 
+std::string TranslatorRegion::GetName() const
+{
+  return "Regions";
+}
+
 void TranslatorRegion::Merge(TranslatorInterface const & other)
 {
   other.MergeInto(*this);
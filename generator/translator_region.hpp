@@ -4,6 +4,7 @@
 #include "generator/translator.hpp"
 
 #include <memory>
+#include <string>
 
 namespace feature
 {
@@ -27,6 +28,7 @@ public:
 
   // TranslatorInterface overrides:
   std::shared_ptr<TranslatorInterface> Clone() const override;
+  std::string GetName() const override;
 
   void Merge(TranslatorInterface const & other) override;
   void MergeInto(TranslatorRegion & other) const override;
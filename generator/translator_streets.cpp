@@ -21,6 +21,11 @@ TranslatorStreets::Clone() const
   return Translator::CloneBase<TranslatorStreets>();
 }
 
+std::string TranslatorStreets::GetName() const
+{
+  return "Streets";
+}
+
 void TranslatorStreets::Merge(TranslatorInterface const & other)
 {
   other.MergeInto(*this);
@@ -4,6 +4,7 @@
 #include "generator/translator.hpp"
 
 #include <memory>
+#include <string>
 
 namespace cache
 {
@@ -22,6 +23,7 @@ public:
 
   // TranslatorInterface overrides:
   std::shared_ptr<TranslatorInterface> Clone() const override;
+  std::string GetName() const override;
 
   void Merge(TranslatorInterface const & other) override;
   void MergeInto(TranslatorStreets & other) const override;
@@ -1,45 +1,84 @@
 #include "generator/translators_pool.hpp"
 
+#include <functional>
 #include <future>
 
 namespace generator
 {
+namespace
+{
+// Number of chunks waiting for the workers per worker.
+size_t const kChunksPerWorker = 2;
+}  // namespace
+
 TranslatorsPool::TranslatorsPool(std::shared_ptr<TranslatorInterface> const & original,
-                                 size_t threadCount)
-  : m_threadPool(threadCount)
+                                 size_t threadCount,
+                                 std::shared_ptr<OsmElementChunksPool> const & chunksPool)
+  : m_chunks(threadCount * kChunksPerWorker)
+  , m_chunksPool(chunksPool)
 {
   CHECK_GREATER_OR_EQUAL(threadCount, 1, ());
 
-  m_translators.Push(original);
+  m_translators.push_back(original);
   for (size_t i = 1; i < threadCount; ++i)
-    m_translators.Push(original->Clone());
+    m_translators.push_back(original->Clone());
+
+  for (auto const & translator : m_translators)
+    m_workers.emplace_back(&TranslatorsPool::Work, this, std::ref(*translator));
+}
+
+TranslatorsPool::~TranslatorsPool()
+{
+  StopWorkers();
 }
 
 void TranslatorsPool::Emit(std::vector<OsmElement> && elements)
 {
-  std::shared_ptr<TranslatorInterface> translator;
-  m_translators.WaitAndPop(translator);
-  m_threadPool.SubmitWork([&, translator, elements{std::move(elements)}]() mutable {
+  if (!elements.empty())
+    m_chunks.Push(std::move(elements));
+}
+
+void TranslatorsPool::Work(TranslatorInterface & translator)
+{
+  while (true)
+  {
+    std::vector<OsmElement> elements;
+    m_chunks.WaitAndPop(elements);
+    if (elements.empty())
+      return;
+
     for (auto & element : elements)
-      translator->Emit(element);
+      translator.Emit(element);
+
+    if (m_chunksPool)
+      m_chunksPool->Put(std::move(elements));
+  }
+}
+
+void TranslatorsPool::StopWorkers()
+{
+  if (m_workers.empty())
+    return;
 
-    m_translators.Push(translator);
-  });
+  for (size_t i = 0; i < m_workers.size(); ++i)
+    m_chunks.Push({});
+  for (auto & worker : m_workers)
+    worker.join();
+  m_workers.clear();
 }
 
 bool TranslatorsPool::Finish()
 {
-  m_threadPool.WaitingStop();
+  StopWorkers();
   using TranslatorPtr = std::shared_ptr<TranslatorInterface>;
   base::threads::ThreadSafeQueue<std::future<TranslatorPtr>> queue;
-  while (!m_translators.Empty())
+  for (auto const & translator : m_translators)
   {
     std::promise<TranslatorPtr> p;
-    std::shared_ptr<TranslatorInterface> translator;
-    m_translators.TryPop(translator);
     p.set_value(translator);
     queue.Push(p.get_future());
   }
+  m_translators.clear();
 
   base::thread_pool::computational::ThreadPool pool(queue.Size() / 2 + 1);
   CHECK_GREATER_OR_EQUAL(queue.Size(), 1, ());
@@ -2,27 +2,41 @@
 
 #include "generator/intermediate_data.hpp"
 #include "generator/osm_element.hpp"
+#include "generator/osm_element_chunks_pool.hpp"
 #include "generator/translator_interface.hpp"
 
 #include "base/thread_pool_computational.hpp"
 #include "base/thread_safe_queue.hpp"
 
 #include <memory>
+#include <thread>
 #include <vector>
 
 namespace generator
 {
+// Every worker thread owns a translator and takes the next chunk from the shared queue
+// when it is done with the previous one, so an expensive chunk does not hold the others.
 class TranslatorsPool
 {
 public:
+  // The processed chunks are put back to |chunksPool| if it is set.
   explicit TranslatorsPool(std::shared_ptr<TranslatorInterface> const & original,
-                           size_t threadCount);
+                           size_t threadCount,
+                           std::shared_ptr<OsmElementChunksPool> const & chunksPool = {});
+  ~TranslatorsPool();
 
+  // Blocks only when all the workers are busy and the queue of chunks is full.
   void Emit(std::vector<OsmElement> && elements);
   bool Finish();
 
 private:
-  base::thread_pool::computational::ThreadPool m_threadPool;
-  base::threads::ThreadSafeQueue<std::shared_ptr<TranslatorInterface>> m_translators;
+  void Work(TranslatorInterface & translator);
+  void StopWorkers();
+
+  std::vector<std::shared_ptr<TranslatorInterface>> m_translators;
+  // An empty chunk stops a worker.
+  base::threads::BoundedThreadSafeQueue<std::vector<OsmElement>> m_chunks;
+  std::shared_ptr<OsmElementChunksPool> m_chunksPool;
+  std::vector<std::thread> m_workers;
 };
 }  // namespace generator
@@ -6,6 +6,10 @@
 
 #include "indexer/search_string_utils.hpp"
 
+#include "coding/endianness.hpp"
+#include "coding/file_writer.hpp"
+#include "coding/succinct_mapper.hpp"
+
 #include "base/assert.hpp"
 #include "base/exception.hpp"
 #include "base/logging.hpp"
@@ -15,14 +19,12 @@
 #include "base/timer.hpp"
 
 #include <algorithm>
-#include <fstream>
+#include <memory>
 #include <numeric>
 #include <set>
 #include <thread>
 #include <utility>
 
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
 #include <boost/exception/exception.hpp>
 #include <boost/exception/diagnostic_information.hpp>
 #include <boost/iostreams/device/file.hpp>
@@ -38,6 +40,17 @@ namespace
 {
 size_t const kMaxResults = 100;
 
+// "GEOCIDX\0" as little-endian uint64_t.
+uint64_t const kBinaryIndexMagic = 0x00584449434f4547;
+
+struct BinaryIndexHeader
+{
+  uint64_t m_magic;
+  uint32_t m_version;
+  // 0 - little-endian, 1 - big-endian.
+  uint32_t m_endianness;
+};
+
 // While Result's |m_certainty| is deliberately vaguely defined,
 // current implementation is a log-prob type measure of our belief
 // that the labeling of tokens is correct, provided the labeling is
@@ -131,9 +144,40 @@ strings::UniString MakeHouseNumber(Tokens const & tokens)
 // Geocoder::Context -------------------------------------------------------------------------------
 Geocoder::Context::Context(string const & query) : m_beam(kMaxResults)
 {
+  Reset(query);
+}
+
+void Geocoder::Context::Reset(string const & query)
+{
+  Clear();
   search::NormalizeAndTokenizeAsUtf8(query, m_tokens);
   m_tokenTypes.assign(m_tokens.size(), Type::Count);
+
+  auto const subqueriesCount =
+      m_tokens.size() * m_tokens.size() * static_cast<size_t>(Type::Count);
+  if (m_subqueryDocIds.size() < subqueriesCount)
+    m_subqueryDocIds.resize(subqueriesCount);
+  m_subqueryDocIdsFilled.assign(subqueriesCount, false);
+}
+
+void Geocoder::Context::Clear()
+{
+  m_tokens.clear();
+  m_tokenTypes.clear();
+  m_indexTokenIds.clear();
   m_numUsedTokens = 0;
+  m_houseNumberPositionsInQuery.clear();
+  m_beam.Clear();
+  m_layers.clear();
+  m_subqueryDocIdsFilled.clear();
+}
+
+void Geocoder::Context::FindIndexTokens(Index const & index)
+{
+  m_indexTokenIds.clear();
+  m_indexTokenIds.reserve(m_tokens.size());
+  for (auto const & token : m_tokens)
+    m_indexTokenIds.push_back(index.FindToken(token));
 }
 
 vector<Type> & Geocoder::Context::GetTokenTypes() { return m_tokenTypes; }
@@ -158,6 +202,12 @@ string const & Geocoder::Context::GetToken(size_t id) const
   return m_tokens[id];
 }
 
+Index::TokenId Geocoder::Context::GetIndexTokenId(size_t id) const
+{
+  CHECK_LESS(id, m_indexTokenIds.size(), ());
+  return m_indexTokenIds[id];
+}
+
 void Geocoder::Context::MarkToken(size_t id, Type type)
 {
   CHECK_LESS(id, m_tokens.size(), ());
@@ -227,6 +277,17 @@ void Geocoder::Context::MarkHouseNumberPositionsInQuery(vector<size_t> const & t
   m_houseNumberPositionsInQuery.insert(tokenIds.begin(), tokenIds.end());
 }
 
+size_t Geocoder::Context::GetSubqueryDocIdsIndex(size_t l, size_t r, Type type) const
+{
+  CHECK_LESS(l, r, ());
+  CHECK_LESS_OR_EQUAL(r, m_tokens.size(), ());
+  CHECK_LESS(type, Type::Count, ());
+  auto const span = l * m_tokens.size() + (r - 1);
+  auto const i = span * static_cast<size_t>(Type::Count) + static_cast<size_t>(type);
+  CHECK_LESS(i, m_subqueryDocIdsFilled.size(), ());
+  return i;
+}
+
 bool Geocoder::Context::IsGoodForPotentialHouseNumberAt(BeamKey const & beamKey,
                                                         set<size_t> const & tokenIds) const
 {
@@ -281,23 +342,42 @@ bool Geocoder::Context::ContainsTokenIds(BeamKey const & beamKey, set<size_t> co
 }
 
 // Geocoder ----------------------------------------------------------------------------------------
-void Geocoder::LoadFromJsonl(std::string const & pathToJsonHierarchy, unsigned int loadThreadsCount)
-try
+// static
+template <typename Fn>
+void Geocoder::ReadJsonl(std::string const & path, Fn && fn)
 {
-  using namespace boost::iostreams;
-  filtering_istreambuf fileStreamBuf;
-
-  if (strings::EndsWith(pathToJsonHierarchy, ".gz"))
+  if (strings::EndsWith(path, ".gz"))
+  {
+    // The decompressed stream is read by blocks and the blocks are parsed concurrently.
+    using namespace boost::iostreams;
+    filtering_istreambuf fileStreamBuf;
     fileStreamBuf.push(gzip_decompressor());
 
-  file_source file(pathToJsonHierarchy);
-  if (!file.is_open())
-    MYTHROW(OpenException, ("Failed to open file", pathToJsonHierarchy));
-  fileStreamBuf.push(file);
+    file_source file(path);
+    if (!file.is_open())
+      MYTHROW(OpenException, ("Failed to open file", path));
+    fileStreamBuf.push(file);
+
+    std::istream fileStream(&fileStreamBuf);
+    HierarchyReader reader{fileStream};
+    fn(reader);
+  }
+  else
+  {
+    // Plain files are memory-mapped and parsed in place.
+    HierarchyReader reader{path};
+    fn(reader);
+  }
+}
 
-  std::istream fileStream(&fileStreamBuf);
-  m_hierarchy = HierarchyReader{fileStream}.Read(loadThreadsCount);
+void Geocoder::LoadFromJsonl(std::string const & pathToJsonHierarchy, unsigned int loadThreadsCount)
+try
+{
+  ReadJsonl(pathToJsonHierarchy, [&](HierarchyReader & reader) {
+    m_hierarchy = reader.Read(loadThreadsCount);
+  });
   m_index.BuildIndex(loadThreadsCount);
+  m_binaryIndexReader.reset();
 }
 catch (boost::exception const & err)
 {
@@ -308,16 +388,71 @@ catch (std::exception const & err)
   MYTHROW(Exception, ("Failed to load jsonl:", err.what()));
 }
 
+void Geocoder::ApplyJsonlDiff(std::string const & pathToJsonDiff, unsigned int loadThreadsCount)
+try
+{
+  HierarchyReader::Diff diff;
+  ReadJsonl(pathToJsonDiff, [&](HierarchyReader & reader) {
+    diff = reader.ReadDiff(loadThreadsCount);
+  });
+
+  vector<uint32_t> entriesPositions;
+  m_hierarchy =
+      m_hierarchy.ApplyChanges(diff.m_changes, move(diff.m_removedOsmIds), entriesPositions);
+  // The previous index is still mapped while the index is updated from it.
+  auto const numIndexed = m_index.UpdateIndex(entriesPositions, loadThreadsCount);
+  LOG(LINFO, ("Applied the diff:", diff.m_changes.GetEntries().size(), "changed entries,",
+              numIndexed, "entries indexed"));
+  // The updated hierarchy and index do not refer to the mapped binary index anymore.
+  m_binaryIndexReader.reset();
+}
+catch (boost::exception const & err)
+{
+  MYTHROW(Exception, ("Failed to apply jsonl diff:", boost::diagnostic_information(err)));
+}
+catch (std::exception const & err)
+{
+  MYTHROW(Exception, ("Failed to apply jsonl diff:", err.what()));
+}
+
 void Geocoder::LoadFromBinaryIndex(std::string const & pathToTokenIndex)
 try
 {
-  std::ifstream ifs{pathToTokenIndex};
-  if (!ifs)
-    MYTHROW(OpenException, ("Failed to open file", pathToTokenIndex));
-  ifs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+  auto reader = make_unique<MmapReader>(pathToTokenIndex);
+  auto const * data = reader->Data();
+
+  BinaryIndexHeader header;
+  if (reader->Size() < sizeof(header))
+    MYTHROW(Exception, ("Too small file", pathToTokenIndex));
+  auto const headerSize = coding::Map(header, data, "header");
+
+  if (header.m_magic != kBinaryIndexMagic)
+    MYTHROW(Exception, ("Not a geocoder index file", pathToTokenIndex));
+  if (header.m_version != kIndexFormatVersion)
+  {
+    MYTHROW(Exception, ("Unsupported index format version", header.m_version, "expected",
+                        static_cast<uint32_t>(kIndexFormatVersion)));
+  }
+  if (header.m_endianness != (IsBigEndianMacroBased() ? 1 : 0))
+    MYTHROW(Exception, ("Index endianness mismatch", pathToTokenIndex));
+
+  Hierarchy hierarchy;
+  Index index{m_hierarchy};
+  // Every size field is checked against the mapped bytes before the data it covers is mapped.
+  coding::MapVisitor visitor(data + headerSize, data + reader->Size());
+  try
+  {
+    visitor(hierarchy, "hierarchy");
+    visitor(index, "index");
+  }
+  catch (coding::MapVisitor::OutOfBoundsException const & e)
+  {
+    MYTHROW(Exception, ("Truncated geocoder index", pathToTokenIndex, e.Msg()));
+  }
 
-  boost::archive::binary_iarchive ia{ifs};
-  ia >> *this;
+  m_hierarchy.Swap(hierarchy);
+  m_index.Swap(index);
+  m_binaryIndexReader = move(reader);
 }
 catch (boost::exception const & err)
 {
@@ -331,13 +466,15 @@ catch (std::exception const & err)
 void Geocoder::SaveToBinaryIndex(std::string const & pathToTokenIndex) const
 try
 {
-  std::ofstream ofs{pathToTokenIndex};
-  if (!ofs)
-    MYTHROW(OpenException, ("Failed to open file", pathToTokenIndex));
-  ofs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+  FileWriter writer{pathToTokenIndex};
 
-  boost::archive::binary_oarchive oa{ofs};
-  oa << *this;
+  BinaryIndexHeader header{kBinaryIndexMagic, kIndexFormatVersion,
+                           IsBigEndianMacroBased() ? 1u : 0u};
+  coding::Freeze(header, writer, "header");
+
+  // Freezing only reads the geocoder but succinct visitors take non-const references.
+  coding::FreezeVisitor<FileWriter> visitor(writer);
+  const_cast<Geocoder &>(*this).map(visitor);
 }
 catch (boost::exception const & err)
 {
@@ -349,6 +486,12 @@ catch (std::exception const & err)
 }
 
 void Geocoder::ProcessQuery(string const & query, vector<Result> & results) const
+{
+  Context ctx;
+  ProcessQuery(query, ctx, results);
+}
+
+void Geocoder::ProcessQuery(string const & query, Context & ctx, vector<Result> & results) const
 {
 #if defined(DEBUG)
   base::Timer timer;
@@ -357,7 +500,8 @@ void Geocoder::ProcessQuery(string const & query, vector<Result> & results) cons
   });
 #endif
 
-  Context ctx(query);
+  ctx.Reset(query);
+  ctx.FindIndexTokens(m_index);
   Go(ctx, Type::Country);
   ctx.FillResults(results);
 }
@@ -379,10 +523,12 @@ void Geocoder::Go(Context & ctx, Type type) const
 
   Tokens subquery;
   vector<size_t> subqueryTokenIds;
+  Index::TokenIds subqueryIndexTokenIds;
   for (size_t i = 0; i < ctx.GetNumTokens(); ++i)
   {
     subquery.clear();
     subqueryTokenIds.clear();
+    subqueryIndexTokenIds.clear();
     for (size_t j = i; j < ctx.GetNumTokens(); ++j)
     {
       if (ctx.IsTokenUsed(j))
@@ -391,6 +537,12 @@ void Geocoder::Go(Context & ctx, Type type) const
       subquery.push_back(ctx.GetToken(j));
       subqueryTokenIds.push_back(j);
 
+      // Index keys are sorted token ids so the subquery is kept sorted too.
+      auto const indexTokenId = ctx.GetIndexTokenId(j);
+      subqueryIndexTokenIds.insert(
+          upper_bound(subqueryIndexTokenIds.begin(), subqueryIndexTokenIds.end(), indexTokenId),
+          indexTokenId);
+
       Layer curLayer;
       curLayer.m_type = type;
 
@@ -401,7 +553,7 @@ void Geocoder::Go(Context & ctx, Type type) const
       }
       else
       {
-        FillRegularLayer(ctx, type, subquery, curLayer);
+        FillRegularLayer(ctx, type, i, j + 1, subquery, subqueryIndexTokenIds, curLayer);
       }
 
       if (curLayer.m_entries.empty())
@@ -436,6 +588,10 @@ void Geocoder::FillBuildingsLayer(Context & ctx, Tokens const & subquery, vector
   if (!search::house_numbers::LooksLikeHouseNumber(subqueryHN, false /* isPrefix */))
     return;
 
+  Index::HouseNumberKeyIds keyIds;
+  m_index.FindHouseNumberKeys(subqueryHN, keyIds);
+
+  vector<Index::DocId> candidates;
   for_each(ctx.GetLayers().rbegin(), ctx.GetLayers().rend(), [&, this] (auto const & layer) {
     if (layer.m_type != Type::Street && layer.m_type != Type::Locality)
       return;
@@ -447,38 +603,56 @@ void Geocoder::FillBuildingsLayer(Context & ctx, Tokens const & subquery, vector
 
     for (auto const & docId : layer.m_entries)
     {
-      m_index.ForEachRelatedBuilding(docId, [&](Index::DocId const & buildingDocId) {
+      // Only the buildings sharing a house number key with the query may match it.
+      candidates.clear();
+      for (auto const keyId : keyIds)
+      {
+        m_index.ForEachRelatedBuilding(docId, keyId, [&](Index::DocId const & buildingDocId) {
+          candidates.push_back(buildingDocId);
+        });
+      }
+      base::SortUnique(candidates);
+
+      for (auto const & buildingDocId : candidates)
+      {
         auto const & bld = m_index.GetDoc(buildingDocId);
         auto const & multipleHN = bld.GetNormalizedMultipleNames(
             Type::Building, m_hierarchy.GetNormalizedNameDictionary());
         auto const & realHN = multipleHN.GetMainName();
-        auto const & realHNUniStr = strings::MakeUniString(realHN);
+        auto const & realHNUniStr = strings::MakeUniString(realHN.to_string());
         if (search::house_numbers::HouseNumbersMatch(realHNUniStr, subqueryHN,
                                                      false /* queryIsPrefix */))
         {
           curLayer.m_entries.emplace_back(buildingDocId);
         }
-      });
+      }
     }
   });
 }
 
-void Geocoder::FillRegularLayer(Context const & ctx, Type type, Tokens const & subquery,
+void Geocoder::FillRegularLayer(Context & ctx, Type type, size_t subqueryBegin,
+                                size_t subqueryEnd, Tokens const & subquery,
+                                Index::TokenIds const & subqueryIndexTokenIds,
                                 Layer & curLayer) const
 {
-  m_index.ForEachDocId(subquery, [&](Index::DocId const & docId) {
-    auto const & d = m_index.GetDoc(docId);
-    if (d.m_type != type)
-      return;
+  auto const & docIds =
+      ctx.GetSubqueryDocIds(subqueryBegin, subqueryEnd, type, [&](vector<Index::DocId> & ids) {
+        m_index.ForEachDocId(subqueryIndexTokenIds, [&](Index::DocId const & docId) {
+          if (m_index.GetDoc(docId).m_type == type)
+            ids.push_back(docId);
+        });
+      });
 
-    if (ctx.GetLayers().empty() || HasParent(ctx.GetLayers(), d))
+  for (auto const & docId : docIds)
+  {
+    if (ctx.GetLayers().empty() || HasParent(ctx.GetLayers(), docId))
     {
-      if (type > Type::Locality && !IsRelevantLocalityMember(ctx, d, subquery))
-        return;
+      if (type > Type::Locality && !IsRelevantLocalityMember(ctx, docId, subquery))
+        continue;
 
       curLayer.m_entries.emplace_back(docId);
     }
-  });
+  }
 }
 
 void Geocoder::AddResults(Context & ctx, std::vector<Index::DocId> const & entries) const
@@ -540,29 +714,29 @@ bool Geocoder::InCityState(Hierarchy::Entry const & entry) const
   return false;
 }
 
-bool Geocoder::HasParent(vector<Geocoder::Layer> const & layers, Hierarchy::Entry const & e) const
+bool Geocoder::HasParent(vector<Geocoder::Layer> const & layers, Index::DocId const & docId) const
 {
   CHECK(!layers.empty(), ());
   auto const & layer = layers.back();
-  for (auto const & docId : layer.m_entries)
+  for (auto const & parentDocId : layer.m_entries)
   {
     // Note that the relationship is somewhat inverted: every ancestor
     // is stored in the address but the nodes have no information
     // about their children.
-    if (m_hierarchy.IsParentTo(m_index.GetDoc(docId), e))
+    if (m_index.IsParentTo(parentDocId, docId))
       return true;
   }
   return false;
 }
 
-bool Geocoder::IsRelevantLocalityMember(Context const & ctx, Hierarchy::Entry const & member,
+bool Geocoder::IsRelevantLocalityMember(Context const & ctx, Index::DocId const & member,
                                         Tokens const & subquery) const
 {
   auto const isNumeric = subquery.size() == 1 && strings::IsASCIINumeric(subquery.front());
   return !isNumeric || HasMemberLocalityInMatching(ctx, member);
 }
 
-bool Geocoder::HasMemberLocalityInMatching(Context const & ctx, Hierarchy::Entry const & member) const
+bool Geocoder::HasMemberLocalityInMatching(Context const & ctx, Index::DocId const & member) const
 {
   for (auto const & layer : ctx.GetLayers())
   {
@@ -574,8 +748,7 @@ bool Geocoder::HasMemberLocalityInMatching(Context const & ctx, Hierarchy::Entry
 
     for (auto const docId : layer.m_entries)
     {
-      auto const & matchedEntry = m_index.GetDoc(docId);
-      if (m_hierarchy.IsParentTo(matchedEntry, member))
+      if (m_index.IsParentTo(docId, member))
         return true;
     }
   }
@@ -5,12 +5,15 @@
 #include "geocoder/result.hpp"
 #include "geocoder/types.hpp"
 
+#include "coding/mmap_reader.hpp"
+
 #include "base/beam.hpp"
 #include "base/geo_object_id.hpp"
 #include "base/stl_helpers.hpp"
 #include "base/string_utils.hpp"
 
 #include <cstddef>
+#include <memory>
 #include <set>
 #include <string>
 #include <thread>
@@ -18,8 +21,6 @@
 #include <utility>
 #include <vector>
 
-#include <boost/serialization/version.hpp>
-
 namespace geocoder
 {
 // This class performs geocoding by using the data that we are currently unable
@@ -75,10 +76,18 @@ public:
       std::vector<Type> m_allTypes;
     };
 
-    Context(std::string const & query);
+    Context(std::string const & query = {});
+
+    // Prepares the context for processing |query|. Memory allocated
+    // for the previous queries is reused.
+    void Reset(std::string const & query);
 
     void Clear();
 
+    // Looks up the tokens of the query in |index| so that
+    // subqueries are matched by token ids.
+    void FindIndexTokens(Index const & index);
+
     std::vector<Type> & GetTokenTypes();
     size_t GetNumTokens() const;
     size_t GetNumUsedTokens() const;
@@ -87,6 +96,9 @@ public:
 
     std::string const & GetToken(size_t id) const;
 
+    // Returns the id of the token in the index or Index::kUnknownTokenId.
+    Index::TokenId GetIndexTokenId(size_t id) const;
+
     void MarkToken(size_t id, Type type);
 
     // Returns true if |token| is marked as used.
@@ -106,7 +118,27 @@ public:
 
     void MarkHouseNumberPositionsInQuery(std::vector<size_t> const & tokenIds);
 
+    // Returns the docs of |type| whose names match the tokens [l, r) of the query.
+    // The docs are collected by |lookup| once per query and then taken from the memo:
+    // the recursive search requests the same subqueries for every choice of parents.
+    template <typename Lookup>
+    std::vector<Index::DocId> const & GetSubqueryDocIds(size_t l, size_t r, Type type,
+                                                        Lookup && lookup)
+    {
+      auto const i = GetSubqueryDocIdsIndex(l, r, type);
+      auto & docIds = m_subqueryDocIds[i];
+      if (!m_subqueryDocIdsFilled[i])
+      {
+        docIds.clear();
+        lookup(docIds);
+        m_subqueryDocIdsFilled[i] = true;
+      }
+      return docIds;
+    }
+
   private:
+    size_t GetSubqueryDocIdsIndex(size_t l, size_t r, Type type) const;
+
     bool IsGoodForPotentialHouseNumberAt(BeamKey const & beamKey, std::set<size_t> const & tokenIds) const;
     bool IsBuildingWithAddress(BeamKey const & beamKey) const;
     bool HasLocalityOrRegion(BeamKey const & beamKey) const;
@@ -114,6 +146,7 @@ public:
 
     Tokens m_tokens;
     std::vector<Type> m_tokenTypes;
+    std::vector<Index::TokenId> m_indexTokenIds;
 
     size_t m_numUsedTokens = 0;
 
@@ -129,33 +162,52 @@ public:
     base::Beam<BeamKey, double> m_beam;
 
     std::vector<Layer> m_layers;
+
+    // Memo of the index lookups for all (subquery, type) pairs. The buffers
+    // are kept between queries, |m_subqueryDocIdsFilled| tells the valid ones.
+    std::vector<std::vector<Index::DocId>> m_subqueryDocIds;
+    std::vector<bool> m_subqueryDocIdsFilled;
   };
 
   void LoadFromJsonl(std::string const & pathToJsonHierarchy, unsigned int loadThreadsCount = 1);
 
+  // Updates the loaded hierarchy with the jsonl diff (see HierarchyReader::ReadDiff()):
+  // only the diff is parsed, the kept entries are copied and only the changed entries
+  // are indexed (see Index::UpdateIndex()). The result can be saved with SaveToBinaryIndex.
+  void ApplyJsonlDiff(std::string const & pathToJsonDiff, unsigned int loadThreadsCount = 1);
+
+  // The binary index is memory-mapped and queried in place: loading does not
+  // deserialize anything and the file pages are shared between processes.
   void LoadFromBinaryIndex(std::string const & pathToTokenIndex);
   void SaveToBinaryIndex(std::string const & pathToTokenIndex) const;
 
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version)
+  template <typename Visitor>
+  void map(Visitor & visitor)
   {
-    CHECK_EQUAL(version, kIndexFormatVersion, ());
-    ar & m_hierarchy;
-    ar & m_index;
+    visitor(m_hierarchy, "hierarchy");
+    visitor(m_index, "index");
   }
 
   void ProcessQuery(std::string const & query, std::vector<Result> & results) const;
+  // Same as above but reuses |ctx| buffers. Useful for processing queries in batches:
+  // ProcessQuery is const and may be called concurrently with distinct contexts.
+  void ProcessQuery(std::string const & query, Context & ctx, std::vector<Result> & results) const;
 
   Hierarchy const & GetHierarchy() const;
 
   Index const & GetIndex() const;
 
 private:
+  // Calls |fn| with the HierarchyReader of the plain or gzipped jsonl file.
+  template <typename Fn>
+  static void ReadJsonl(std::string const & path, Fn && fn);
+
   void Go(Context & ctx, Type type) const;
 
   void FillBuildingsLayer(Context & ctx, Tokens const & subquery, std::vector<size_t> const & subqueryTokenIds,
                           Layer & curLayer) const;
-  void FillRegularLayer(Context const & ctx, Type type, Tokens const & subquery,
+  void FillRegularLayer(Context & ctx, Type type, size_t subqueryBegin, size_t subqueryEnd,
+                        Tokens const & subquery, Index::TokenIds const & subqueryIndexTokenIds,
                         Layer & curLayer) const;
   void AddResults(Context & ctx, std::vector<Index::DocId> const & entries) const;
 
@@ -163,14 +215,16 @@ private:
 
   // Returns whether any of the paths through |layers| can be extended
   // by appending |e|.
-  bool HasParent(std::vector<Geocoder::Layer> const & layers, Hierarchy::Entry const & e) const;
-  bool IsRelevantLocalityMember(Context const & ctx, Hierarchy::Entry const & member,
+  bool HasParent(std::vector<Geocoder::Layer> const & layers, Index::DocId const & docId) const;
+  bool IsRelevantLocalityMember(Context const & ctx, Index::DocId const & member,
                                 Tokens const & subquery) const;
-  bool HasMemberLocalityInMatching(Context const & ctx, Hierarchy::Entry const & member) const;
+  bool HasMemberLocalityInMatching(Context const & ctx, Index::DocId const & member) const;
+
+  // The mapped binary index file. It must outlive |m_hierarchy| and |m_index|
+  // which may point into it.
+  std::unique_ptr<MmapReader> m_binaryIndexReader;
 
   Hierarchy m_hierarchy;
   Index m_index{m_hierarchy};
 };
 }  // namespace geocoder
-
-BOOST_CLASS_VERSION(geocoder::Geocoder, geocoder::kIndexFormatVersion)
@@ -3,12 +3,18 @@
 
 #include "base/internal/message.hpp"
 #include "base/string_utils.hpp"
+#include "base/timer.hpp"
 
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace geocoder;
@@ -16,22 +22,26 @@ using namespace std;
 
 namespace po = boost::program_options;
 
-void PrintResults(Hierarchy const & hierarchy, vector<Result> const & results, int32_t top)
+// Number of queries that are read from the file and processed at once in the batch mode.
+size_t const kQueriesBatchSize = 10000;
+
+void PrintResults(Hierarchy const & hierarchy, vector<Result> const & results, int32_t top,
+                  ostream & out = cout)
 {
-  cout << "Found results: " << results.size() << endl;
+  out << "Found results: " << results.size() << endl;
   if (results.empty())
     return;
-  cout << "Top results:" << endl;
+  out << "Top results:" << endl;
 
   auto const & dictionary = hierarchy.GetNormalizedNameDictionary();
   for (size_t i = 0; i < results.size(); ++i)
   {
     if (top >= 0 && static_cast<int32_t>(i) >= top)
       break;
-    cout << "  " << DebugPrint(results[i]);
+    out << "  " << DebugPrint(results[i]);
     if (auto const && e = hierarchy.GetEntryForOsmId(results[i].m_osmId))
     {
-      cout << " [";
+      out << " [";
       auto const * delimiter = "";
       for (size_t i = 0; i < static_cast<size_t>(Type::Count); ++i)
       {
@@ -39,34 +49,111 @@ void PrintResults(Hierarchy const & hierarchy, vector<Result> const & results, i
         {
           auto type = static_cast<Type>(i);
           auto multipleNames = e->GetNormalizedMultipleNames(type, dictionary);
-          cout << delimiter << ToString(type) << ": " << multipleNames.GetMainName();
+          out << delimiter << ToString(type) << ": " << multipleNames.GetMainName();
           delimiter = ", ";
         }
       }
-      cout << "]";
+      out << "]";
     }
-    cout << endl;
+    out << endl;
+  }
+}
+
+// Returns the |p|-th percentile of sorted |values|.
+double GetPercentile(vector<double> const & values, double p)
+{
+  CHECK(!values.empty(), ());
+  auto const rank = static_cast<size_t>(ceil(p * static_cast<double>(values.size())));
+  return values[min(values.size(), max<size_t>(rank, 1)) - 1];
+}
+
+void PrintStats(vector<double> & latencies, double totalSeconds)
+{
+  cerr << "Processed " << latencies.size() << " queries in " << totalSeconds << " seconds";
+  if (latencies.empty())
+  {
+    cerr << endl;
+    return;
   }
+
+  cerr << ", " << static_cast<double>(latencies.size()) / totalSeconds << " queries/sec" << endl;
+
+  sort(latencies.begin(), latencies.end());
+  cerr << "Latency, ms: p50 " << GetPercentile(latencies, 0.50) * 1000 << ", p95 "
+       << GetPercentile(latencies, 0.95) * 1000 << ", p99 " << GetPercentile(latencies, 0.99) * 1000
+       << ", max " << latencies.back() * 1000 << endl;
 }
 
-void ProcessQueriesFromFile(Geocoder const & geocoder, string const & path, int32_t top)
+// Processes queries in batches of |kQueriesBatchSize|. Every batch is sharded among
+// |threadsCount| workers, the results are printed in the order of the queries in the file.
+void ProcessQueriesFromFile(Geocoder const & geocoder, string const & path, int32_t top,
+                            unsigned int threadsCount)
 {
+  CHECK_GREATER_OR_EQUAL(threadsCount, 1, ());
+
   ifstream stream(path.c_str());
   CHECK(stream.is_open(), ("Can't open", path));
 
-  vector<Result> results;
+  // Contexts and results buffers are reused by the workers for all the batches.
+  vector<Geocoder::Context> contexts(threadsCount);
+  vector<vector<Result>> results(threadsCount);
+
+  vector<string> queries;
+  vector<string> outputs;
+  vector<double> latencies;
+  base::Timer timer;
+
   string s;
-  while (getline(stream, s))
+  bool eof = false;
+  while (!eof)
   {
-    strings::Trim(s);
-    if (s.empty())
-      continue;
+    queries.clear();
+    while (queries.size() < kQueriesBatchSize)
+    {
+      if (!getline(stream, s))
+      {
+        eof = true;
+        break;
+      }
 
-    cout << s << endl;
-    geocoder.ProcessQuery(s, results);
-    PrintResults(geocoder.GetHierarchy(), results, top);
-    cout << endl;
+      strings::Trim(s);
+      if (!s.empty())
+        queries.push_back(s);
+    }
+
+    outputs.assign(queries.size(), {});
+    auto const batchStart = latencies.size();
+    latencies.resize(batchStart + queries.size());
+
+    atomic<size_t> next{0};
+    auto const worker = [&](size_t t) {
+      ostringstream out;
+      for (auto i = next++; i < queries.size(); i = next++)
+      {
+        base::Timer queryTimer;
+        geocoder.ProcessQuery(queries[i], contexts[t], results[t]);
+        latencies[batchStart + i] = queryTimer.ElapsedSeconds();
+
+        out.str({});
+        out << queries[i] << endl;
+        PrintResults(geocoder.GetHierarchy(), results[t], top, out);
+        out << endl;
+        outputs[i] = out.str();
+      }
+    };
+
+    vector<thread> threads;
+    for (size_t t = 1; t < threadsCount; ++t)
+      threads.emplace_back(worker, t);
+    worker(0);
+    for (auto & t : threads)
+      t.join();
+
+    for (auto const & output : outputs)
+      cout << output;
   }
+
+  PrintStats(latencies, timer.ElapsedSeconds());
 }
 
 void ProcessQueriesFromCommandLine(Geocoder const & geocoder, int32_t top)
@@ -90,6 +177,7 @@ struct CliCommandOptions
   std::string m_hierarchy_path;
   std::string m_queries_path;
   int32_t m_top;
+  unsigned int m_threads;
 };
 
 CliCommandOptions DefineOptions(int argc, char * argv[])
@@ -101,6 +189,7 @@ CliCommandOptions DefineOptions(int argc, char * argv[])
     ("hierarchy_path", po::value(&o.m_hierarchy_path), "Path to the hierarchy file for the geocoder")
     ("queries_path", po::value(&o.m_queries_path)->default_value(""), "Path to the file with queries")
     ("top", po::value(&o.m_top)->default_value(5), "Number of top results to show for every query, -1 to show all results")
+    ("threads", po::value(&o.m_threads)->default_value(1), "Number of threads processing queries from queries_path")
     ("help", "produce help message");
 
   po::variables_map vm;
@@ -144,7 +233,8 @@ int main(int argc, char * argv[])
 
   if (!options.m_queries_path.empty())
   {
-    ProcessQueriesFromFile(geocoder, options.m_queries_path, options.m_top);
+    ProcessQueriesFromFile(geocoder, options.m_queries_path, options.m_top,
+                           max(options.m_threads, 1u));
     return 0;
   }
 
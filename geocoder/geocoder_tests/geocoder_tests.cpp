@@ -7,13 +7,20 @@
 
 #include "platform/platform_tests_support/scoped_file.hpp"
 
+#include "coding/succinct_mapper.hpp"
+#include "coding/writer.hpp"
+
 #include "base/geo_object_id.hpp"
 #include "base/math.hpp"
 #include "base/stl_helpers.hpp"
 
 #include <algorithm>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace platform::tests_support;
@@ -64,6 +71,29 @@ UNIT_TEST(Geocoder_Smoke)
   TestGeocoder(geocoder, "florencia somewhere in cuba", {{cubaId, 0.714286}, {florenciaId, 1.0}});
 }
 
+UNIT_TEST(Geocoder_ReusedContext)
+{
+  Geocoder geocoder;
+  ScopedFile const regionsJsonFile("regions.jsonl", kRegionsData);
+  geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath());
+
+  Geocoder::Context ctx;
+  for (auto const & query : {"cuba florencia", "florencia", "florencia somewhere in cuba", ""})
+  {
+    vector<Result> expected;
+    geocoder.ProcessQuery(query, expected);
+
+    vector<Result> actual;
+    geocoder.ProcessQuery(query, ctx, actual);
+    TEST_EQUAL(actual.size(), expected.size(), (query));
+    for (size_t i = 0; i < actual.size(); ++i)
+    {
+      TEST_EQUAL(actual[i].m_osmId, expected[i].m_osmId, (query));
+      TEST_EQUAL(actual[i].m_certainty, expected[i].m_certainty, (query));
+    }
+  }
+}
+
 UNIT_TEST(Geocoder_Hierarchy)
 {
   Geocoder geocoder;
@@ -86,6 +116,109 @@ UNIT_TEST(Geocoder_Hierarchy)
              "florencia", ());
 }
 
+UNIT_TEST(Geocoder_IndexTokenIds)
+{
+  Geocoder geocoder;
+  ScopedFile const regionsJsonFile("regions.jsonl", kRegionsData);
+  geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath());
+  auto const & index = geocoder.GetIndex();
+
+  TEST_EQUAL(index.FindToken("somewhere"), Index::kUnknownTokenId, ());
+
+  auto const ciego = index.FindToken("ciego");
+  auto const de = index.FindToken("de");
+  auto const avila = index.FindToken("avila");
+  TEST_NOT_EQUAL(ciego, Index::kUnknownTokenId, ());
+  TEST_NOT_EQUAL(de, Index::kUnknownTokenId, ());
+  TEST_NOT_EQUAL(avila, Index::kUnknownTokenId, ());
+
+  Index::TokenIds tokenIds = {ciego, de, avila};
+  sort(tokenIds.begin(), tokenIds.end());
+  size_t count = 0;
+  index.ForEachDocId(tokenIds, [&](Index::DocId const &) { ++count; });
+  TEST_EQUAL(count, 1, ());
+
+  // The order of the tokens does not matter.
+  count = 0;
+  index.ForEachDocId(Tokens{"avila", "ciego", "de"}, [&](Index::DocId const &) { ++count; });
+  TEST_EQUAL(count, 1, ());
+
+  count = 0;
+  index.ForEachDocId(Tokens{"ciego", "de"}, [&](Index::DocId const &) { ++count; });
+  TEST_EQUAL(count, 0, ());
+}
+
+UNIT_TEST(Geocoder_IndexAncestors)
+{
+  string const kData = R"#(
+10 {"properties": {"locales": {"default": {"address": {"locality": "Москва"}}, "en": {"address": {"locality": "Moscow"}}}}}
+11 {"properties": {"locales": {"default": {"address": {"locality": "Москва", "street": "улица Новый Арбат"}}, "en": {"address": {"locality": "Moscow", "street": "New Arbat Avenue"}}}}}
+12 {"properties": {"locales": {"default": {"address": {"locality": "Москва", "street": "улица Новый Арбат", "building": "4"}}}}}
+20 {"properties": {"locales": {"default": {"address": {"locality": "Paris"}}}}}
+21 {"properties": {"locales": {"default": {"address": {"locality": "Paris", "street": "улица Новый Арбат"}}}}}
+)#";
+
+  Geocoder geocoder;
+  ScopedFile const regionsJsonFile("regions.jsonl", kData);
+  geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath());
+  auto const & hierarchy = geocoder.GetHierarchy();
+  auto const & index = geocoder.GetIndex();
+  auto const docsCount = static_cast<Index::DocId>(hierarchy.GetEntries().size());
+
+  // The resolved ancestors must agree with the name-based relation.
+  size_t ancestorsCount = 0;
+  for (Index::DocId parent = 0; parent < docsCount; ++parent)
+  {
+    for (Index::DocId child = 0; child < docsCount; ++child)
+    {
+      auto const & p = index.GetDoc(parent);
+      auto const & c = index.GetDoc(child);
+      auto const expected = p.m_type < c.m_type && hierarchy.IsParentTo(p, c);
+      TEST_EQUAL(index.IsParentTo(parent, child), expected, (p.m_osmId, c.m_osmId));
+      if (expected)
+        ++ancestorsCount;
+    }
+  }
+  // Moscow is an ancestor of the street and the building and the street is an ancestor
+  // of the building. Paris is an ancestor of its street.
+  TEST_EQUAL(ancestorsCount, 4, ());
+}
+
+UNIT_TEST(Geocoder_ShardedNameDictionary)
+{
+  auto const makeNames = [](size_t i) {
+    auto const n = i % 100;
+    MultipleNames names{"name " + to_string(n)};
+    if (n % 3 == 0)
+      names.AddAltName("alt " + to_string(n));
+    return names;
+  };
+
+  size_t const kNamesCount = 1000;
+  size_t const kThreadsCount = 4;
+  ShardedNameDictionaryBuilder builder{8 /* shardsCount */};
+  vector<NameDictionary::Position> positions(kNamesCount);
+  vector<thread> threads;
+  for (size_t t = 0; t < kThreadsCount; ++t)
+  {
+    threads.emplace_back([&, t] {
+      for (size_t i = t; i < kNamesCount; i += kThreadsCount)
+        positions[i] = builder.Add(makeNames(i));
+    });
+  }
+  for (auto & t : threads)
+    t.join();
+
+  auto const dictionary = builder.Release(kThreadsCount);
+  TEST_EQUAL(dictionary.Size(), 100, ());
+  for (size_t i = 0; i < kNamesCount; ++i)
+  {
+    auto const position = builder.ToReleasedPosition(positions[i]);
+    TEST(MultipleNames{dictionary.Get(position)} == makeNames(i), (i));
+    TEST_EQUAL(position, builder.ToReleasedPosition(positions[i % 100]), (i));
+  }
+}
+
 UNIT_TEST(Geocoder_EnglishNames)
 {
   string const kData = R"#(
@@ -146,6 +279,54 @@ UNIT_TEST(Geocoder_OnlyBuildings)
                {{numberedStreet, 1.0}, {houseOnANonNumberedStreet, 0.8875}});
 }
 
+UNIT_TEST(Geocoder_ConcurrentHousesIndexing)
+{
+  stringstream s;
+  s << R"(10 {"properties": {"locales": {"default": {"address": {"locality": "Some Locality"}}}}})"
+    << "\n";
+  for (int street = 0; street < 3; ++street)
+  {
+    s << hex << 0x100 + street
+      << R"( {"properties": {"locales": {"default": {"address": {"street": "Street )" << street
+      << R"(", "locality": "Some Locality"}}}}})"
+      << "\n";
+  }
+  for (int building = 0; building < 3000; ++building)
+  {
+    s << hex << 0x1000 + building
+      << R"( {"properties": {"locales": {"default": {"address": {"building": ")" << dec
+      << building / 3 << R"(", "street": "Street )" << building % 3
+      << R"(", "locality": "Some Locality"}}}}})"
+      << "\n";
+  }
+
+  ScopedFile const regionsJsonFile("regions.jsonl", s.str());
+  Geocoder geocoder;
+  geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath(), 1 /* threads */);
+  Geocoder concurrentGeocoder;
+  concurrentGeocoder.LoadFromJsonl(regionsJsonFile.GetFullPath(), 4 /* threads */);
+
+  auto const & docs = geocoder.GetHierarchy().GetEntries();
+  for (Index::DocId docId = 0; docId < static_cast<Index::DocId>(docs.size()); ++docId)
+  {
+    vector<Index::DocId> expected;
+    geocoder.GetIndex().ForEachRelatedBuilding(
+        docId, [&](Index::DocId const & building) { expected.push_back(building); });
+    vector<Index::DocId> actual;
+    concurrentGeocoder.GetIndex().ForEachRelatedBuilding(
+        docId, [&](Index::DocId const & building) { actual.push_back(building); });
+
+    TEST_EQUAL(actual, expected, (docs[docId].m_osmId));
+    TEST(is_sorted(actual.begin(), actual.end()), ());
+    if (docs[docId].m_type == Type::Street)
+    {
+      TEST_EQUAL(actual.size(), 1000, ());
+    }
+  }
+
+  TestGeocoder(concurrentGeocoder, "some locality street 1 333", {{Id{0x1000 + 1000}, 1.0}});
+}
+
 UNIT_TEST(Geocoder_MismatchedLocality)
 {
   string const kData = R"#(
@@ -405,6 +586,184 @@ UNIT_TEST(Geocoder_Serialization)
     TEST_GREATER_OR_EQUAL(objectsFromJsonl.size(), 1, ());
     TEST_EQUAL(objectsFromTokenIndex, objectsFromJsonl, ());
   }
+
+  TestGeocoder(geocoderFromTokenIndex, "Москва, Арбат, 4", {{Id{0x15}, 1.0}});
+}
+
+UNIT_TEST(Geocoder_ApplyJsonlDiff)
+{
+  string const kData = R"#(
+10 {"properties": {"locales": {"default": {"address": {"country": "Россия"}}}, "rank": 1}}
+11 {"properties": {"locales": {"default": {"address": {"region": "Москва", "country": "Россия"}}}, "rank": 2}}
+12 {"properties": {"locales": {"default": {"address": {"locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 4}}
+13 {"properties": {"locales": {"default": {"address": {"street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 7}}
+15 {"properties": {"locales": {"default": {"address": {"building": "4", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+16 {"properties": {"locales": {"default": {"address": {"building": "8", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+)#";
+  string const kDiff = R"#(
+14 {"properties": {"locales": {"default": {"address": {"street": "Тверская", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 7}}
+15 {"properties": {"locales": {"default": {"address": {"building": "6", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+16
+)#";
+
+  Geocoder geocoder;
+  ScopedFile const regionsJsonFile("regions.jsonl", kData);
+  geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath());
+
+  ScopedFile const regionsTokenIndexFile("regions.tokidx", ScopedFile::Mode::DoNotCreate);
+  geocoder.SaveToBinaryIndex(regionsTokenIndexFile.GetFullPath());
+
+  Geocoder updatedGeocoder;
+  updatedGeocoder.LoadFromBinaryIndex(regionsTokenIndexFile.GetFullPath());
+  ScopedFile const diffJsonFile("regions_diff.jsonl", kDiff);
+  updatedGeocoder.ApplyJsonlDiff(diffJsonFile.GetFullPath(), 2 /* threads */);
+
+  vector<base::GeoObjectId> ids;
+  for (auto const & e : updatedGeocoder.GetHierarchy().GetEntries())
+    ids.push_back(e.m_osmId);
+  TEST_EQUAL(ids, vector<Id>({Id{0x10}, Id{0x11}, Id{0x12}, Id{0x13}, Id{0x14}, Id{0x15}}), ());
+
+  TestGeocoder(updatedGeocoder, "Москва, Арбат, 6", {{Id{0x15}, 1.0}});
+  TestGeocoder(updatedGeocoder, "Тверская", {{Id{0x14}, 1.0}});
+  TEST(!updatedGeocoder.GetHierarchy().GetEntryForOsmId(Id{0x16}), ());
+
+  // The updated index is saved as usual.
+  ScopedFile const updatedTokenIndexFile("regions_updated.tokidx", ScopedFile::Mode::DoNotCreate);
+  updatedGeocoder.SaveToBinaryIndex(updatedTokenIndexFile.GetFullPath());
+
+  Geocoder geocoderFromUpdatedIndex;
+  geocoderFromUpdatedIndex.LoadFromBinaryIndex(updatedTokenIndexFile.GetFullPath());
+  TestGeocoder(geocoderFromUpdatedIndex, "Москва, Арбат, 6", {{Id{0x15}, 1.0}});
+}
+
+UNIT_TEST(Geocoder_UpdateIndex)
+{
+  string const kData = R"#(
+10 {"properties": {"locales": {"default": {"address": {"country": "Россия"}}}, "rank": 1}}
+11 {"properties": {"locales": {"default": {"address": {"region": "Москва", "country": "Россия"}}}, "rank": 2}}
+12 {"properties": {"locales": {"default": {"address": {"locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 4}}
+13 {"properties": {"locales": {"default": {"address": {"street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 7}}
+15 {"properties": {"locales": {"default": {"address": {"building": "4", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+16 {"properties": {"locales": {"default": {"address": {"building": "8", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+17 {"properties": {"locales": {"default": {"address": {"building": "1", "street": "Тверская", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+18 {"properties": {"locales": {"default": {"address": {"building": "2а", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+)#";
+  // Replaces the locality, adds the street of a kept building, renumbers
+  // a building and removes a building.
+  string const kDiff = R"#(
+12 {"properties": {"locales": {"default": {"address": {"locality": "Москва", "region": "Москва", "country": "Россия"}}, "en": {"address": {"locality": "Moscow"}}}, "rank": 4}}
+14 {"properties": {"locales": {"default": {"address": {"street": "Тверская", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 7}}
+15 {"properties": {"locales": {"default": {"address": {"building": "6", "street": "Арбат", "locality": "Москва", "region": "Москва", "country": "Россия"}}}, "rank": 8}}
+16
+)#";
+
+  istringstream dataStream(kData);
+  auto hierarchy = HierarchyReader(dataStream).Read();
+  Index index{hierarchy};
+  index.BuildIndex();
+
+  istringstream diffStream(kDiff);
+  auto const diff = HierarchyReader(diffStream).ReadDiff();
+  vector<uint32_t> entriesPositions;
+  auto updatedHierarchy =
+      hierarchy.ApplyChanges(diff.m_changes, diff.m_removedOsmIds, entriesPositions);
+  TEST_EQUAL(entriesPositions, vector<uint32_t>({0, 1, Hierarchy::kRemovedEntryPosition, 3,
+                                                 Hierarchy::kRemovedEntryPosition,
+                                                 Hierarchy::kRemovedEntryPosition, 6, 7}),
+             ());
+  hierarchy.Swap(updatedHierarchy);
+
+  // Only the changed locality and the added street are indexed: the kept docs
+  // and the changed building are not.
+  TEST_EQUAL(index.UpdateIndex(entriesPositions, 2 /* threads */), 2, ());
+
+  Index rebuiltIndex{hierarchy};
+  rebuiltIndex.BuildIndex();
+
+  auto const freeze = [](Index & index) {
+    vector<uint8_t> data;
+    MemWriter<vector<uint8_t>> writer(data);
+    coding::FreezeVisitor<MemWriter<vector<uint8_t>>> visitor(writer);
+    index.map(visitor);
+    return data;
+  };
+  TEST(freeze(index) == freeze(rebuiltIndex), ());
+
+  vector<Index::DocId> buildings;
+  index.ForEachRelatedBuilding(4 /* Тверская */, [&](Index::DocId b) { buildings.push_back(b); });
+  TEST_EQUAL(buildings, vector<Index::DocId>({6}), ());
+}
+
+UNIT_TEST(Geocoder_ApplyJsonlDiffNames)
+{
+  string const kData = R"#(
+10 {"properties": {"locales": {"default": {"address": {"country": "Россия"}}}, "rank": 1}}
+11 {"properties": {"locales": {"default": {"address": {"locality": "Москва", "country": "Россия"}}}, "rank": 4}}
+13 {"properties": {"locales": {"default": {"address": {"street": "Арбат", "locality": "Москва", "country": "Россия"}}}, "rank": 7}}
+15 {"properties": {"locales": {"default": {"address": {"building": "4", "street": "Арбат", "locality": "Москва", "country": "Россия"}}}, "rank": 8}}
+)#";
+
+  Geocoder geocoder;
+  ScopedFile const regionsJsonFile("regions.jsonl", kData);
+  geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath());
+  auto const namesCount = geocoder.GetHierarchy().GetNormalizedNameDictionary().Size();
+
+  // The names of the diff are in the dictionary already.
+  {
+    string const kDiff = R"#(
+16 {"properties": {"locales": {"default": {"address": {"building": "4", "street": "Арбат", "locality": "Москва", "country": "Россия"}}}, "rank": 8}}
+)#";
+    ScopedFile const diffJsonFile("regions_diff.jsonl", kDiff);
+    geocoder.ApplyJsonlDiff(diffJsonFile.GetFullPath());
+    TEST_EQUAL(geocoder.GetHierarchy().GetNormalizedNameDictionary().Size(), namesCount, ());
+  }
+
+  // The house numbers of the replaced buildings are dropped eventually.
+  for (size_t i = 0; i < 20; ++i)
+  {
+    auto const diff = "15 {\"properties\": {\"locales\": {\"default\": {\"address\": "
+                      "{\"building\": \"" + to_string(100 + i) + "\", \"street\": \"Арбат\", "
+                      "\"locality\": \"Москва\", \"country\": \"Россия\"}}}, \"rank\": 8}}\n";
+    ScopedFile const diffJsonFile("regions_diff.jsonl", diff);
+    geocoder.ApplyJsonlDiff(diffJsonFile.GetFullPath());
+    TEST_LESS_OR_EQUAL(geocoder.GetHierarchy().GetNormalizedNameDictionary().Size(),
+                       namesCount + 2, (i));
+    TestGeocoder(geocoder, "Москва, Арбат, " + to_string(100 + i), {{Id{0x15}, 1.0}});
+  }
+  TestGeocoder(geocoder, "Москва, Арбат, 4", {{Id{0x16}, 1.0}});
+}
+
+UNIT_TEST(Geocoder_BinaryIndexBadFile)
+{
+  ScopedFile const notAnIndexFile("regions.tokidx", "this is not a geocoder index");
+
+  Geocoder geocoder;
+  TEST_THROW(geocoder.LoadFromBinaryIndex(notAnIndexFile.GetFullPath()), Geocoder::Exception, ());
+}
+
+UNIT_TEST(Geocoder_BinaryIndexTruncatedFile)
+{
+  Geocoder geocoderFromJsonl;
+  ScopedFile const regionsJsonFile("regions.jsonl", kRegionsData);
+  geocoderFromJsonl.LoadFromJsonl(regionsJsonFile.GetFullPath());
+
+  ScopedFile const regionsTokenIndexFile("regions.tokidx", ScopedFile::Mode::DoNotCreate);
+  geocoderFromJsonl.SaveToBinaryIndex(regionsTokenIndexFile.GetFullPath());
+
+  string index;
+  {
+    ifstream input(regionsTokenIndexFile.GetFullPath(), ios::binary);
+    index.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+  }
+  TEST_GREATER(index.size(), 64, ());
+
+  for (size_t const size : {size_t{32}, index.size() / 2, index.size() - 8})
+  {
+    ScopedFile const truncatedFile("truncated.tokidx", index.substr(0, size));
+    Geocoder geocoder;
+    TEST_THROW(geocoder.LoadFromBinaryIndex(truncatedFile.GetFullPath()), Geocoder::Exception,
+               (size));
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -417,12 +776,12 @@ UNIT_TEST(Geocoder_EmptyFileConcurrentRead)
   TEST_EQUAL(geocoder.GetHierarchy().GetEntries().size(), 0, ());
 }
 
-UNIT_TEST(Geocoder_BigFileConcurrentRead)
+namespace
+{
+string MakeBigHierarchy(int entryCount)
 {
-  int const kEntryCount = 100000;
-
   stringstream s;
-  for (int i = 0; i < kEntryCount; ++i)
+  for (int i = 0; i < entryCount; ++i)
   {
     s << setw(16) << setfill('0') << hex << uppercase << i << " "
       << "{"
@@ -432,11 +791,34 @@ UNIT_TEST(Geocoder_BigFileConcurrentRead)
       << R"("name": ")" << i << R"(", "address": {"country": ")" << i << R"("}}}, "rank": 2})"
       << "}\n";
   }
+  return s.str();
+}
+}  // namespace
+
+UNIT_TEST(Geocoder_BigFileConcurrentRead)
+{
+  int const kEntryCount = 100000;
 
   Geocoder geocoder;
-  ScopedFile const regionsJsonFile("regions.jsonl", s.str());
+  ScopedFile const regionsJsonFile("regions.jsonl", MakeBigHierarchy(kEntryCount));
   geocoder.LoadFromJsonl(regionsJsonFile.GetFullPath(), 8 /* reader threads */);
 
   TEST_EQUAL(geocoder.GetHierarchy().GetEntries().size(), kEntryCount, ());
 }
+
+UNIT_TEST(Geocoder_BigStreamConcurrentRead)
+{
+  int const kEntryCount = 100000;
+
+  // The last line has no newline.
+  auto data = MakeBigHierarchy(kEntryCount);
+  data.pop_back();
+  istringstream s{data};
+  auto const hierarchy = HierarchyReader{s}.Read(8 /* reader threads */);
+
+  auto const & entries = hierarchy.GetEntries();
+  TEST_EQUAL(entries.size(), kEntryCount, ());
+  for (int i = 0; i < kEntryCount; ++i)
+    TEST_EQUAL(entries[i].m_osmId, base::GeoObjectId(static_cast<uint64_t>(i)), ());
+}
 }  // namespace geocoder
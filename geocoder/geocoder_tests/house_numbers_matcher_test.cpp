@@ -2,7 +2,9 @@
 
 #include "geocoder/house_numbers_matcher.hpp"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/string_utils.hpp"
@@ -20,6 +22,23 @@ bool HouseNumbersMatch(string const & houseNumber, string const & query, bool qu
                                                   queryIsPrefix);
 }
 
+// Checks that the house number can be found by the keys of the query.
+bool HouseNumberKeysIntersect(string const & houseNumber, string const & query,
+                              bool queryIsPrefix = false)
+{
+  vector<string> houseNumberKeys;
+  GetHouseNumberKeys(MakeUniString(houseNumber), houseNumberKeys);
+  vector<string> queryKeys;
+  GetQueryKeys(MakeUniString(query), queryIsPrefix, queryKeys);
+
+  for (auto const & key : queryKeys)
+  {
+    if (find(houseNumberKeys.begin(), houseNumberKeys.end(), key) != houseNumberKeys.end())
+      return true;
+  }
+  return false;
+}
+
 bool CheckTokenizer(string const & utf8s, vector<string> const & expected)
 {
   UniString utf32s = MakeUniString(utf8s);
@@ -146,6 +165,26 @@ UNIT_TEST(HouseNumbersMatcher_Smoke)
   TEST(HouseNumbersMatch("14 д 1", "дом 14 д1"), ());
 }
 
+UNIT_TEST(HouseNumberKeys_Smoke)
+{
+  vector<pair<string, string>> const matches = {
+      {"39с79", "39"},          {"39с79", "39 Строение 79"}, {"39/79", "39 строение 79"},
+      {"127а корпус 2", "127а"}, {"1234abcdef", "1234  abcdef"}, {"10к2а", "10 2а"},
+      {"22к", "22 к"},          {"22", "22к"},               {"16 к1", "д 16 к 1"},
+      {"14 д 1", "дом 14 д1"},   {"ev 10", "ev 10"}};
+  for (auto const & m : matches)
+  {
+    TEST(HouseNumbersMatch(m.first, m.second), (m));
+    TEST(HouseNumberKeysIntersect(m.first, m.second), (m));
+  }
+
+  TEST(HouseNumbersMatch("39К корпус 7", "39 к", true /* queryIsPrefix */), ());
+  TEST(HouseNumberKeysIntersect("39К корпус 7", "39 к", true /* queryIsPrefix */), ());
+
+  TEST(!HouseNumberKeysIntersect("6 корпус 2", "7"), ());
+  TEST(!HouseNumberKeysIntersect("10/42 корпус 2", "42"), ());
+}
+
 UNIT_TEST(LooksLikeHouseNumber_Smoke)
 {
   TEST(LooksLikeHouseNumber("1", false /* isPrefix */), ());
@@ -9,32 +9,37 @@
 #include "base/string_utils.hpp"
 
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 #include <utility>
 
 using namespace std;
 
 namespace geocoder
 {
+static_assert(is_trivially_copyable<Hierarchy::Entry>::value,
+              "Hierarchy::Entry is mapped from the binary index as is");
+
 // Hierarchy::Entry --------------------------------------------------------------------------------
-bool Hierarchy::Entry::DeserializeFromJSON(string const & jsonStr,
+bool Hierarchy::Entry::DeserializeFromJSON(boost::string_view jsonStr,
                                            NameDictionaryBuilder & normalizedNameDictionaryBuilder,
                                            ParsingStats & stats)
 {
   try
   {
-    base::Json root(jsonStr.c_str());
+    base::Json root(jsonStr.data(), jsonStr.size());
     return DeserializeFromJSONImpl(root.get(), jsonStr, normalizedNameDictionaryBuilder, stats);
   }
   catch (base::Json::Exception const & e)
   {
-    LOG(LDEBUG, ("Can't parse entry:", e.Msg(), jsonStr));
+    LOG(LDEBUG, ("Can't parse entry:", e.Msg(), jsonStr.to_string()));
   }
   return false;
 }
 
 // todo(@m) Factor out to geojson.hpp? Add geojson to myjansson?
 bool Hierarchy::Entry::DeserializeFromJSONImpl(
-    json_t * const root, string const & jsonStr,
+    json_t * const root, boost::string_view jsonStr,
     NameDictionaryBuilder & normalizedNameDictionaryBuilder, ParsingStats & stats)
 {
   if (!json_is_object(root))
@@ -48,13 +53,14 @@ bool Hierarchy::Entry::DeserializeFromJSONImpl(
 
   auto const defaultLocale = base::GetJSONObligatoryFieldByPath(root, "properties", "locales",
                                                                 "default");
-  FromJSONObjectOptionalField(defaultLocale, "name", m_name);
-  if (m_name.empty())
+  string name;
+  FromJSONObjectOptionalField(defaultLocale, "name", name);
+  if (name.empty())
     ++stats.m_emptyNames;
 
   if (m_type == Type::Count)
   {
-    LOG(LDEBUG, ("No address in an hierarchy entry:", jsonStr));
+    LOG(LDEBUG, ("No address in an hierarchy entry:", jsonStr.to_string()));
     ++stats.m_emptyAddresses;
   }
   return true;
@@ -151,7 +157,7 @@ bool Hierarchy::Entry::FetchAddressFieldNames(
   return true;
 }
 
-MultipleNames const & Hierarchy::Entry::GetNormalizedMultipleNames(
+MultipleNamesView Hierarchy::Entry::GetNormalizedMultipleNames(
     Type type, NameDictionary const & normalizedNameDictionary) const
 {
   auto const & addressField = m_normalizedAddress[static_cast<size_t>(type)];
@@ -182,20 +188,44 @@ Type Hierarchy::Entry::RankToType(uint8_t rank)
 }
 
 // Hierarchy ---------------------------------------------------------------------------------------
+// static
+uint32_t constexpr Hierarchy::kRemovedEntryPosition;
+
 Hierarchy::Hierarchy(vector<Entry> && entries, NameDictionary && normalizedNameDictionary,
                      std::string && dataVersion)
-  : m_entries{move(entries)}
-  , m_normalizedNameDictionary{move(normalizedNameDictionary)}
-  , m_dataVersion(move(dataVersion))
+  : m_normalizedNameDictionary{move(normalizedNameDictionary)}
 {
-  if (!is_sorted(m_entries.begin(), m_entries.end()))
+  if (!is_sorted(entries.begin(), entries.end()))
   {
     LOG(LINFO, ("Sorting entries..."));
-    sort(m_entries.begin(), m_entries.end());
+    sort(entries.begin(), entries.end());
   }
+  m_entries.steal(entries);
+
+  vector<char> version{dataVersion.begin(), dataVersion.end()};
+  m_dataVersion.steal(version);
+}
+
+Hierarchy::Hierarchy(Hierarchy && other)
+{
+  Swap(other);
+}
+
+Hierarchy & Hierarchy::operator=(Hierarchy && other)
+{
+  Hierarchy{}.Swap(*this);
+  Swap(other);
+  return *this;
 }
 
-vector<Hierarchy::Entry> const & Hierarchy::GetEntries() const
+void Hierarchy::Swap(Hierarchy & other)
+{
+  m_entries.swap(other.m_entries);
+  m_normalizedNameDictionary.Swap(other.m_normalizedNameDictionary);
+  m_dataVersion.swap(other.m_dataVersion);
+}
+
+Hierarchy::Entries const & Hierarchy::GetEntries() const
 {
   return m_entries;
 }
@@ -219,6 +249,85 @@ Hierarchy::Entry const * Hierarchy::GetEntryForOsmId(base::GeoObjectId const & o
   return &(*it);
 }
 
+Hierarchy Hierarchy::ApplyChanges(Hierarchy const & changes,
+                                  vector<base::GeoObjectId> removedOsmIds,
+                                  vector<uint32_t> & entriesPositions) const
+{
+  for (auto const & entry : changes.m_entries)
+    removedOsmIds.push_back(entry.m_osmId);
+  base::SortUnique(removedOsmIds);
+
+  // The names of |changes| which are in the dictionary already are not appended again.
+  vector<NameDictionary::Position> changesPositions;
+  auto dictionary =
+      m_normalizedNameDictionary.Merge(changes.m_normalizedNameDictionary, changesPositions);
+
+  vector<Entry> entries;
+  entries.reserve(m_entries.size() + changes.m_entries.size());
+  auto removed = removedOsmIds.cbegin();
+  auto changed = changes.m_entries.begin();
+  auto const addChanged = [&] {
+    auto entry = *changed++;
+    for (auto & position : entry.m_normalizedAddress)
+      position = changesPositions[position];
+    entries.push_back(entry);
+  };
+
+  CHECK_LESS(m_entries.size() + changes.m_entries.size(), kRemovedEntryPosition, ());
+  entriesPositions.assign(m_entries.size(), kRemovedEntryPosition);
+
+  // Both the entries and the changes are sorted by osm ids.
+  for (size_t i = 0; i < m_entries.size(); ++i)
+  {
+    auto const & entry = m_entries[i];
+    while (changed != changes.m_entries.end() && changed->m_osmId < entry.m_osmId)
+      addChanged();
+
+    removed = lower_bound(removed, removedOsmIds.cend(), entry.m_osmId);
+    if (removed != removedOsmIds.cend() && *removed == entry.m_osmId)
+      continue;
+
+    entriesPositions[i] = static_cast<uint32_t>(entries.size());
+    entries.push_back(entry);
+  }
+  while (changed != changes.m_entries.end())
+    addChanged();
+
+  auto dataVersion = changes.GetDataVersion();
+  if (dataVersion.empty())
+    dataVersion = GetDataVersion();
+
+  CompactNames(entries, dictionary);
+
+  return Hierarchy{move(entries), move(dictionary), move(dataVersion)};
+}
+
+// static
+void Hierarchy::CompactNames(vector<Entry> & entries, NameDictionary & dictionary)
+{
+  vector<bool> used(dictionary.Size() + 1, false);
+  for (auto const & entry : entries)
+  {
+    for (auto const position : entry.m_normalizedAddress)
+      used[position] = true;
+  }
+  used[NameDictionary::kUnspecifiedPosition] = false;
+
+  auto const usedCount = static_cast<size_t>(count(used.begin(), used.end(), true));
+  auto const unusedCount = dictionary.Size() - usedCount;
+  if (unusedCount <= dictionary.Size() / kMaxUnusedNamesPart)
+    return;
+
+  LOG(LINFO, ("Dropping", unusedCount, "unused names of", dictionary.Size()));
+  vector<NameDictionary::Position> positions;
+  dictionary = dictionary.Filter(used, positions);
+  for (auto & entry : entries)
+  {
+    for (auto & position : entry.m_normalizedAddress)
+      position = positions[position];
+  }
+}
+
 bool Hierarchy::IsParentTo(Hierarchy::Entry const & entry, Hierarchy::Entry const & toEntry) const
 {
   for (size_t i = 0; i < static_cast<size_t>(geocoder::Type::Count); ++i)
@@ -9,16 +9,14 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
-#include <boost/serialization/array.hpp>
-#include <boost/serialization/split_free.hpp>
-#include <boost/serialization/string.hpp>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/version.hpp>
+#include <boost/utility/string_view.hpp>
 
 #include "3party/jansson/myjansson.hpp"
+#include "3party/succinct/mappable_vector.hpp"
 
 namespace geocoder
 {
@@ -64,22 +62,14 @@ public:
   // A single entry in the hierarchy directed acyclic graph.
   // Currently, this is more or less the "properties"-"address"
   // part of the geojson entry.
+  // The entry is trivially copyable so that an array of entries
+  // can be mapped from the binary index as is.
   struct Entry
   {
-    template<class Archive>
-    void serialize(Archive & ar, const unsigned int version)
-    {
-      CHECK_EQUAL(version, kIndexFormatVersion, ());
-      ar & m_osmId;
-      ar & m_name;
-      ar & m_type;
-      ar & m_normalizedAddress;
-    }
-
-    bool DeserializeFromJSON(std::string const & jsonStr,
+    bool DeserializeFromJSON(boost::string_view jsonStr,
                              NameDictionaryBuilder & normalizedNameDictionaryBuilder,
                              ParsingStats & stats);
-    bool DeserializeFromJSONImpl(json_t * const root, std::string const & jsonStr,
+    bool DeserializeFromJSONImpl(json_t * const root, boost::string_view jsonStr,
                                  NameDictionaryBuilder & normalizedNameDictionaryBuilder,
                                  ParsingStats & stats);
     bool DeserializeAddressFromJSON(json_t * const root,
@@ -93,77 +83,73 @@ public:
     // See generator::regions::LevelRegion::GetRank().
     static Type RankToType(uint8_t rank);
 
-    MultipleNames const & GetNormalizedMultipleNames(
+    MultipleNamesView GetNormalizedMultipleNames(
         Type type, NameDictionary const & normalizedNameDictionary) const;
     bool operator<(Entry const & rhs) const { return m_osmId < rhs.m_osmId; }
 
     base::GeoObjectId m_osmId = base::GeoObjectId(base::GeoObjectId::kInvalid);
 
-    // Original name of the entry. Useful for debugging.
-    std::string m_name;
-
     Type m_type = Type::Count;
 
     // The positions of entry address fields in normalized name dictionary, one per Type.
     std::array<NameDictionary::Position, static_cast<size_t>(Type::Count)> m_normalizedAddress{};
   };
 
+  using Entries = succinct::mapper::mappable_vector<Entry>;
+
+  static uint32_t constexpr kRemovedEntryPosition = std::numeric_limits<uint32_t>::max();
+
   Hierarchy() = default;
   Hierarchy(std::vector<Entry> && entries, NameDictionary && normalizeNameDictionary,
             std::string && dataVersion);
+  Hierarchy(Hierarchy && other);
+  Hierarchy & operator=(Hierarchy && other);
 
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version)
+  Hierarchy(Hierarchy const &) = delete;
+  Hierarchy & operator=(Hierarchy const &) = delete;
+
+  // Freezes the hierarchy to the binary index or maps it from there.
+  template <typename Visitor>
+  void map(Visitor & visitor)
   {
-    CHECK_EQUAL(version, kIndexFormatVersion, ());
-    ar & m_entries;
-    ar & m_normalizedNameDictionary;
-    ar & m_dataVersion;
+    visitor(m_entries, "entries");
+    visitor(m_normalizedNameDictionary, "normalizedNameDictionary");
+    visitor(m_dataVersion, "dataVersion");
   }
 
-  std::vector<Entry> const & GetEntries() const;
+  Entries const & GetEntries() const;
   NameDictionary const & GetNormalizedNameDictionary() const;
 
   Entry const * GetEntryForOsmId(base::GeoObjectId const & osmId) const;
+
+  // Returns the hierarchy with the entries of |changes| added or replacing the entries
+  // with the same osm ids and without the entries with |removedOsmIds|. The names of
+  // |changes| missing from the dictionary are appended to it so that the kept entries
+  // are copied as is. The dictionary is compacted when too many of its names are
+  // not referenced anymore. |entriesPositions| gets the position in the result of every
+  // entry of this hierarchy, kRemovedEntryPosition for the removed and replaced entries.
+  Hierarchy ApplyChanges(Hierarchy const & changes,
+                         std::vector<base::GeoObjectId> removedOsmIds,
+                         std::vector<uint32_t> & entriesPositions) const;
   bool IsParentTo(Hierarchy::Entry const & entry, Hierarchy::Entry const & toEntry) const;
 
-  std::string const & GetDataVersion() const
+  std::string GetDataVersion() const
   {
-    return m_dataVersion;
+    return {m_dataVersion.begin(), m_dataVersion.end()};
   }
 
+  void Swap(Hierarchy & other);
+
 private:
-  std::vector<Entry> m_entries;
+  // The dictionary is compacted when more than 1/kMaxUnusedNamesPart of its names are unused.
+  static size_t constexpr kMaxUnusedNamesPart = 4;
+
+  // Drops the names of |dictionary| which are not referenced by |entries|.
+  static void CompactNames(std::vector<Entry> & entries, NameDictionary & dictionary);
+
+  // Sorted by osm id.
+  Entries m_entries;
   NameDictionary m_normalizedNameDictionary;
-  std::string m_dataVersion;
+  succinct::mapper::mappable_vector<char> m_dataVersion;
 };
 }  // namespace geocoder
-
-BOOST_CLASS_VERSION(geocoder::Hierarchy, geocoder::kIndexFormatVersion)
-BOOST_CLASS_VERSION(geocoder::Hierarchy::Entry, geocoder::kIndexFormatVersion)
-
-namespace boost
-{
-namespace serialization
-{
-template<class Archive>
-inline void serialize(Archive & ar, base::GeoObjectId & t, const unsigned int version)
-{
-  split_free(ar, t, version);
-}
-
-template<class Archive>
-inline void save(Archive & ar, base::GeoObjectId const & t, const unsigned int /*version*/)
-{
-  ar & t.GetEncodedId();
-}
-
-template<class Archive>
-inline void load(Archive & ar, base::GeoObjectId & t, const unsigned int /*version*/)
-{
-  uint64_t encodedId = 0;
-  ar & encodedId;
-  t = base::GeoObjectId(encodedId);
-}
-}  // namespace serialization
-}  // namespace boost
@@ -1,13 +1,15 @@
 #include "geocoder/hierarchy_reader.hpp"
 
+#include "coding/internal/file_data.hpp"
+
 #include "base/logging.hpp"
 #include "base/thread_pool_computational.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <list>
 #include <sstream>
-#include <thread>
 #include <vector>
 
 using namespace std;
@@ -19,6 +21,9 @@ namespace
 // Information will be logged for every |kLogBatch| entries.
 size_t const kLogBatch = 100000;
 
+// Approximate size of a block of lines that is parsed by a single task.
+size_t const kReadBlockSize = 4 * 1024 * 1024;
+
 void operator+=(Hierarchy::ParsingStats & accumulator, Hierarchy::ParsingStats & stats)
 {
   struct ValidationStats
@@ -43,14 +48,27 @@ void operator+=(Hierarchy::ParsingStats & accumulator, Hierarchy::ParsingStats &
 } // namespace
 
 HierarchyReader::HierarchyReader(string const & pathToJsonHierarchy)
-  : m_fileStream{pathToJsonHierarchy}, m_in{m_fileStream}
 {
-  if (!m_fileStream)
+  uint64_t fileSize = 0;
+  if (!base::GetFileSize(pathToJsonHierarchy, fileSize))
     MYTHROW(OpenException, ("Failed to open file", pathToJsonHierarchy));
+
+  // Empty files cannot be mapped and have nothing to read.
+  if (fileSize == 0)
+    return;
+
+  try
+  {
+    m_fileReader = make_unique<MmapReader>(pathToJsonHierarchy);
+  }
+  catch (Reader::OpenException const & e)
+  {
+    MYTHROW(OpenException, ("Failed to open file", pathToJsonHierarchy, e.Msg()));
+  }
 }
 
 HierarchyReader::HierarchyReader(istream & in)
-  : m_in{in}
+  : m_in{&in}
 {
 }
 
@@ -61,17 +79,33 @@ Hierarchy HierarchyReader::Read(unsigned int readersCount)
   LOG(LINFO, ("Reading entries..."));
 
   vector<Entry> entries;
-  NameDictionaryBuilder nameDictionaryBuilder;
+  ShardedNameDictionaryBuilder nameDictionaryBuilder;
   ParsingStats stats{};
   std::string dataVersion;
 
   base::thread_pool::computational::ThreadPool threadPool{readersCount};
   list<future<ParsingResult>> tasks{};
-  while (!m_eof || !tasks.empty())
+  bool eof = false;
+  while (!eof || !tasks.empty())
   {
-    size_t const kReadBlockLineCount = 1000;
-    while (!m_eof && tasks.size() <= 2 * readersCount)
-      tasks.emplace_back(threadPool.Submit([&] { return ReadEntries(kReadBlockLineCount); }));
+    while (!eof && tasks.size() <= 2 * readersCount)
+    {
+      Block block;
+      if (!ReadBlock(block))
+      {
+        eof = true;
+        break;
+      }
+
+      tasks.emplace_back(threadPool.Submit([this, &nameDictionaryBuilder, block = move(block)] {
+        // Owned text of the block has been moved with the block.
+        auto const text = block.m_buffer.empty() ? block.m_text : boost::string_view{block.m_buffer};
+        return DeserializeEntries(text, nameDictionaryBuilder);
+      }));
+    }
+
+    if (tasks.empty())
+      break;
 
     CHECK(!tasks.empty(), ());
     auto & task = tasks.front();
@@ -88,19 +122,10 @@ Hierarchy HierarchyReader::Read(unsigned int readersCount)
     tasks.pop_front();
 
     auto & taskEntries = taskResult.m_entries;
-    auto const & taskNameDictionary = taskResult.m_nameDictionary;
-    for (auto & entry : taskEntries)
-    {
-      for (size_t i = 0; i < static_cast<size_t>(Type::Count); ++i)
-      {
-        if (auto & position = entry.m_normalizedAddress[i])
-        {
-          auto const & multipleNames = taskNameDictionary.Get(position);
-          position = nameDictionaryBuilder.Add(MultipleNames{multipleNames});
-        }
-      }
-    }
     move(begin(taskEntries), end(taskEntries), back_inserter(entries));
+    auto & taskRemovedOsmIds = taskResult.m_removedOsmIds;
+    m_removedOsmIds.insert(m_removedOsmIds.end(), taskRemovedOsmIds.begin(),
+                           taskRemovedOsmIds.end());
 
     stats += taskResult.m_stats;
   }
@@ -108,6 +133,10 @@ Hierarchy HierarchyReader::Read(unsigned int readersCount)
   if (m_totalNumLoaded % kLogBatch != 0)
     LOG(LINFO, ("Read", m_totalNumLoaded, "entries"));
 
+  LOG(LINFO, ("Merging name dictionary..."));
+  auto nameDictionary = nameDictionaryBuilder.Release(readersCount);
+  ReleasePositions(entries, nameDictionaryBuilder, threadPool, readersCount);
+
   LOG(LINFO, ("Sorting entries..."));
   sort(begin(entries), end(entries));
   LOG(LINFO, ("Finished entries sorting"));
@@ -128,7 +157,42 @@ Hierarchy HierarchyReader::Read(unsigned int readersCount)
       ("Entries whose names do not match their most specific addresses:", stats.m_mismatchedNames));
   LOG(LINFO, ("(End of stats.)"));
 
-  return Hierarchy{move(entries), nameDictionaryBuilder.Release(), move(dataVersion)};
+  return Hierarchy{move(entries), move(nameDictionary), move(dataVersion)};
+}
+
+// static
+void HierarchyReader::ReleasePositions(vector<Entry> & entries,
+                                       ShardedNameDictionaryBuilder const & nameDictionaryBuilder,
+                                       base::thread_pool::computational::ThreadPool & threadPool,
+                                       unsigned int tasksCount)
+{
+  vector<future<void>> tasks;
+  tasks.reserve(tasksCount);
+  size_t const size = entries.size() / tasksCount;
+  for (size_t t = 0; t < tasksCount; ++t)
+  {
+    auto const begin = entries.begin() + t * size;
+    auto const end = t + 1 == tasksCount ? entries.end() : begin + size;
+    tasks.emplace_back(threadPool.Submit([&nameDictionaryBuilder, begin, end] {
+      for (auto it = begin; it != end; ++it)
+      {
+        for (auto & position : it->m_normalizedAddress)
+          position = nameDictionaryBuilder.ToReleasedPosition(position);
+      }
+    }));
+  }
+
+  for (auto & task : tasks)
+    task.get();
+}
+
+HierarchyReader::Diff HierarchyReader::ReadDiff(unsigned int readersCount)
+{
+  m_readingDiff = true;
+  m_removedOsmIds.clear();
+  auto changes = Read(readersCount);
+  LOG(LINFO, ("Entries to remove:", m_removedOsmIds.size()));
+  return {move(changes), move(m_removedOsmIds)};
 }
 
 void HierarchyReader::CheckDuplicateOsmIds(vector<geocoder::Hierarchy::Entry> const & entries,
@@ -152,66 +216,109 @@ void HierarchyReader::CheckDuplicateOsmIds(vector<geocoder::Hierarchy::Entry> co
   }
 }
 
-HierarchyReader::ParsingResult HierarchyReader::ReadEntries(size_t count)
+bool HierarchyReader::ReadBlock(Block & block)
+{
+  if (m_fileReader)
+    return ReadMappedBlock(block);
+  if (m_in)
+    return ReadStreamBlock(block);
+  return false;
+}
+
+bool HierarchyReader::ReadMappedBlock(Block & block)
 {
-  vector<string> linesBuffer(count);
-  size_t bufferSize = 0;
+  auto const data = reinterpret_cast<char const *>(m_fileReader->Data());
+  auto const size = static_cast<size_t>(m_fileReader->Size());
+  if (m_filePos >= size)
+    return false;
 
+  auto end = min(m_filePos + kReadBlockSize, size);
+  if (end < size)
   {
-    lock_guard<mutex> lock(m_mutex);
+    auto const newline = static_cast<char const *>(memchr(data + end, '\n', size - end));
+    end = newline ? static_cast<size_t>(newline - data) + 1 : size;
+  }
 
-    for (; bufferSize < count; ++bufferSize)
-    {
-      if (!getline(m_in, linesBuffer[bufferSize]))
-      {
-        m_eof = true;
-        break;
-      }
-    }
+  block.m_text = boost::string_view{data + m_filePos, end - m_filePos};
+  m_filePos = end;
+  return true;
+}
+
+bool HierarchyReader::ReadStreamBlock(Block & block)
+{
+  auto & buffer = block.m_buffer;
+  buffer.swap(m_streamTail);
+  m_streamTail.clear();
+
+  auto const tailSize = buffer.size();
+  buffer.resize(tailSize + kReadBlockSize);
+  m_in->read(&buffer[tailSize], kReadBlockSize);
+  buffer.resize(tailSize + static_cast<size_t>(m_in->gcount()));
+
+  if (m_in->good())
+  {
+    // Leave the incomplete last line for the next block.
+    auto const lastNewline = buffer.rfind('\n');
+    auto const tailBegin = lastNewline == string::npos ? 0 : lastNewline + 1;
+    m_streamTail.assign(buffer, tailBegin, string::npos);
+    buffer.resize(tailBegin);
+    // A block without a single newline is continued by the next read.
+    if (buffer.empty())
+      return ReadStreamBlock(block);
   }
 
-  return DeserializeEntries(linesBuffer, bufferSize);
+  return !buffer.empty();
 }
 
 HierarchyReader::ParsingResult HierarchyReader::DeserializeEntries(
-    vector<string> const & linesBuffer, size_t const bufferSize)
+    boost::string_view lines, ShardedNameDictionaryBuilder & nameDictionaryBuilder)
 {
   vector<Entry> entries;
-  entries.reserve(bufferSize);
-  NameDictionaryBuilder nameDictionaryBuilder;
+  // Names repeat a lot within a block: they are deduplicated locally first
+  // so that the shared builder is locked once per distinct name.
+  NameDictionaryBuilder blockNameDictionaryBuilder;
   ParsingStats stats;
   std::string dataVersion;
+  vector<base::GeoObjectId> removedOsmIds;
 
-  for (size_t i = 0; i < bufferSize; ++i)
+  while (!lines.empty())
   {
-    auto & line = linesBuffer[i];
+    auto const lineEnd = lines.find('\n');
+    auto const line = lines.substr(0, lineEnd);
+    lines.remove_prefix(lineEnd == boost::string_view::npos ? lines.size() : lineEnd + 1);
 
     if (line.empty())
       continue;
 
     auto const p = line.find(' ');
 
-    std::string const & key = line.substr(0, p);
+    std::string const key = line.substr(0, p).to_string();
     if (key == kVersionKey)
     {
-      dataVersion = line.substr(p + 1);
+      dataVersion = p == boost::string_view::npos ? string{} : line.substr(p + 1).to_string();
       continue;
     }
 
     uint64_t encodedId = 0;
-    if (p == string::npos || !DeserializeId(key, encodedId))
+    if (m_readingDiff && p == boost::string_view::npos && DeserializeId(key, encodedId))
     {
-      LOG(LWARNING, ("Cannot read osm id. Line:", line));
+      removedOsmIds.emplace_back(encodedId);
+      continue;
+    }
+
+    if (p == boost::string_view::npos || !DeserializeId(key, encodedId))
+    {
+      LOG(LWARNING, ("Cannot read osm id. Line:", line.to_string()));
       ++stats.m_badOsmIds;
       continue;
     }
-    auto json = line.substr(p + 1);
+    auto const json = line.substr(p + 1);
 
     Entry entry;
     auto const osmId = base::GeoObjectId(encodedId);
     entry.m_osmId = osmId;
 
-    if (!entry.DeserializeFromJSON(json, nameDictionaryBuilder, stats))
+    if (!entry.DeserializeFromJSON(json, blockNameDictionaryBuilder, stats))
       continue;
 
     if (entry.m_type == Type::Count)
@@ -226,7 +333,19 @@ HierarchyReader::ParsingResult HierarchyReader::DeserializeEntries(
     entries.push_back(move(entry));
   }
 
-  return {move(entries), nameDictionaryBuilder.Release(), move(stats), move(dataVersion)};
+  auto const blockNameDictionary = blockNameDictionaryBuilder.Release();
+  vector<NameDictionary::Position> positions(blockNameDictionary.Size() + 1,
+                                             NameDictionary::kUnspecifiedPosition);
+  for (NameDictionary::Position p = 1; p <= blockNameDictionary.Size(); ++p)
+    positions[p] = nameDictionaryBuilder.Add(MultipleNames{blockNameDictionary.Get(p)});
+
+  for (auto & entry : entries)
+  {
+    for (auto & position : entry.m_normalizedAddress)
+      position = positions[position];
+  }
+
+  return {move(entries), move(stats), move(dataVersion), move(removedOsmIds)};
 }
 
 // static
@@ -3,17 +3,22 @@
 #include "geocoder/hierarchy.hpp"
 #include "geocoder/name_dictionary.hpp"
 
+#include "coding/mmap_reader.hpp"
+
 #include "base/exception.hpp"
 #include "base/geo_object_id.hpp"
+#include "base/thread_pool_computational.hpp"
 
 #include <atomic>
-#include <fstream>
-#include <mutex>
+#include <cstddef>
+#include <istream>
+#include <memory>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
 
+#include <boost/utility/string_view.hpp>
+
 namespace geocoder
 {
 class HierarchyReader
@@ -26,33 +31,76 @@ public:
 
   DECLARE_EXCEPTION(OpenException, RootException);
 
+  // The file is memory-mapped and split into blocks of whole lines.
   explicit HierarchyReader(std::string const & pathToJsonHierarchy);
+  // The stream (e.g. a decompressed one) is read by blocks in the calling thread.
   explicit HierarchyReader(std::istream & jsonHierarchy);
 
-  // Read hierarchy file/stream concurrently in |readersCount| threads.
+  // Read hierarchy file/stream concurrently in |readersCount| threads:
+  // blocks of lines are parsed in place by the threads and their results are
+  // merged in the order of the blocks.
   Hierarchy Read(unsigned int readersCount = 1);
 
+  // Changes of a hierarchy, see Hierarchy::ApplyChanges().
+  struct Diff
+  {
+    // Entries to add or to replace the entries with the same osm ids.
+    Hierarchy m_changes;
+    std::vector<base::GeoObjectId> m_removedOsmIds;
+  };
+
+  // Reads a hierarchy diff. The format is the format of the hierarchy
+  // where a line consisting of an osm id only removes the entry.
+  Diff ReadDiff(unsigned int readersCount = 1);
+
 private:
+  // Names of the entries are added to the shared dictionary builder by the parsing
+  // tasks themselves: address positions of |m_entries| are sharded positions.
   struct ParsingResult
   {
     std::vector<Entry> m_entries;
-    NameDictionary m_nameDictionary;
     ParsingStats m_stats;
     std::string m_dataVersion;
+    std::vector<base::GeoObjectId> m_removedOsmIds;
   };
 
-  ParsingResult ReadEntries(size_t count);
-  ParsingResult DeserializeEntries(std::vector<std::string> const & linesBuffer,
-                                   std::size_t const bufferSize);
+  // A block of whole lines. The block either points into the mapped file
+  // or owns the text read from the stream.
+  struct Block
+  {
+    boost::string_view m_text;
+    std::string m_buffer;
+  };
+
+  // Returns false when there is no more data.
+  bool ReadBlock(Block & block);
+  bool ReadMappedBlock(Block & block);
+  bool ReadStreamBlock(Block & block);
+
+  ParsingResult DeserializeEntries(boost::string_view lines,
+                                   ShardedNameDictionaryBuilder & nameDictionaryBuilder);
+  // Translates the sharded positions of |entries| to the positions of the released dictionary.
+  static void ReleasePositions(std::vector<Entry> & entries,
+                               ShardedNameDictionaryBuilder const & nameDictionaryBuilder,
+                               base::thread_pool::computational::ThreadPool & threadPool,
+                               unsigned int tasksCount);
   static bool DeserializeId(std::string const & str, uint64_t & id);
   static std::string SerializeId(uint64_t id);
 
   void CheckDuplicateOsmIds(std::vector<Entry> const & entries, ParsingStats & stats);
 
-  std::ifstream m_fileStream;
-  std::istream & m_in;
-  bool m_eof{false};
-  std::mutex m_mutex;
+  std::unique_ptr<MmapReader> m_fileReader;
+  // Position of the next block in the mapped file.
+  size_t m_filePos{0};
+
+  std::istream * m_in{nullptr};
+  // The tail of the last read chunk of the stream which does not end with a newline.
+  std::string m_streamTail;
+
+  // Whether a diff is read: the lines without json are removals rather than errors.
+  bool m_readingDiff{false};
+  std::vector<base::GeoObjectId> m_removedOsmIds;
+
   std::atomic<std::uint64_t> m_totalNumLoaded{0};
 };
 } // namespace geocoder
@@ -415,6 +415,18 @@ void TransformString(UniString && token, Fn && fn)
     fn(move(token), Token::TYPE_STRING);
   }
 }
+
+// Keys of house numbers, see GetHouseNumberKeys(). The first character
+// distinguishes whole strings from tokens of different types.
+string MakeWholeStringKey(UniString const & s)
+{
+  return "=" + ToUtf8(s);
+}
+
+string MakeTokenKey(Token const & token)
+{
+  return static_cast<char>('a' + token.m_type) + ToUtf8(token.m_value);
+}
 }  // namespace
 
 void Tokenize(UniString s, bool isPrefix, vector<Token> & ts)
@@ -564,6 +576,37 @@ bool HouseNumbersMatch(strings::UniString const & houseNumber, vector<Token> con
   return false;
 }
 
+void GetHouseNumberKeys(strings::UniString const & houseNumber, vector<string> & keys)
+{
+  keys.clear();
+  if (houseNumber.empty())
+    return;
+
+  keys.push_back(MakeWholeStringKey(houseNumber));
+
+  vector<vector<Token>> parses;
+  ParseHouseNumber(houseNumber, parses);
+  for (auto const & parse : parses)
+  {
+    if (!parse.empty())
+      keys.push_back(MakeTokenKey(parse[0]));
+  }
+
+  sort(keys.begin(), keys.end());
+  keys.erase(unique(keys.begin(), keys.end()), keys.end());
+}
+
+void GetQueryKeys(strings::UniString const & query, bool queryIsPrefix, vector<string> & keys)
+{
+  keys.clear();
+  keys.push_back(MakeWholeStringKey(query));
+
+  vector<Token> parse;
+  ParseQuery(query, queryIsPrefix, parse);
+  if (!parse.empty())
+    keys.push_back(MakeTokenKey(parse[0]));
+}
+
 bool LooksLikeHouseNumber(strings::UniString const & s, bool isPrefix)
 {
   static HouseNumberClassifier const classifier;
@@ -70,6 +70,13 @@ bool HouseNumbersMatch(strings::UniString const & houseNumber, strings::UniStrin
 bool HouseNumbersMatch(strings::UniString const & houseNumber,
                        std::vector<Token> const & queryParse);
 
+// Keys for looking up house numbers that may match a query. HouseNumbersMatch(houseNumber,
+// query) holds only if some key of |houseNumber| is equal to some key of |query|: the keys
+// are the whole strings and the leading tokens of the parses, which must be equal for a match.
+void GetHouseNumberKeys(strings::UniString const & houseNumber, std::vector<std::string> & keys);
+void GetQueryKeys(strings::UniString const & query, bool queryIsPrefix,
+                  std::vector<std::string> & keys);
+
 // Returns true if |s| looks like a house number.
 bool LooksLikeHouseNumber(strings::UniString const & s, bool isPrefix);
 bool LooksLikeHouseNumber(std::string const & s, bool isPrefix);
@@ -1,18 +1,26 @@
 #include "geocoder/index.hpp"
 
+#include "geocoder/house_numbers_matcher.hpp"
 #include "geocoder/types.hpp"
 
 #include "indexer/search_string_utils.hpp"
 
 #include "base/assert.hpp"
 #include "base/logging.hpp"
+#include "base/stl_helpers.hpp"
 #include "base/string_utils.hpp"
 
 #include <algorithm>
 #include <atomic>
 #include <cstddef>
-#include <mutex>
+#include <iterator>
+#include <limits>
 #include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
+#include <boost/utility/string_view.hpp>
 
 using namespace std;
 
@@ -20,10 +28,84 @@ namespace
 {
 // Information will be logged for every |kLogBatch| docs.
 size_t const kLogBatch = 100000;
+
+// Calls |fn(t, i)| for every i in [0, size) in |threadsCount| threads, t is the number
+// of the thread. The range is handed out by small chunks so that the threads are
+// loaded evenly even if the costly docs are clustered.
+template <typename Fn>
+void ParallelFor(size_t size, unsigned int threadsCount, Fn && fn)
+{
+  size_t const kChunkSize = 1024;
+
+  atomic<size_t> nextChunk{0};
+  vector<thread> threads(threadsCount);
+  CHECK_GREATER(threads.size(), 0, ());
+  for (size_t t = 0; t < threads.size(); ++t)
+  {
+    threads[t] = thread([&, t] {
+      while (true)
+      {
+        auto const begin = nextChunk.fetch_add(kChunkSize);
+        if (begin >= size)
+          break;
+
+        auto const end = min(begin + kChunkSize, size);
+        for (auto i = begin; i < end; ++i)
+          fn(t, i);
+      }
+    });
+  }
+
+  for (auto & t : threads)
+    t.join();
+}
+
+// Groups the (key, value) pairs found by the threads by the keys in [0, size) with the
+// counting sort: the values of the key k are values[offsets[k]..offsets[k + 1]) in
+// ascending order. |pairs| are cleared.
+template <typename Key, typename Value>
+void GroupByKeys(size_t size, unsigned int threadsCount, vector<vector<pair<Key, Value>>> & pairs,
+                 vector<uint64_t> & offsets, vector<Value> & values)
+{
+  offsets.assign(size + 1, 0);
+  for (auto const & threadPairs : pairs)
+  {
+    for (auto const & item : threadPairs)
+      ++offsets[item.first + 1];
+  }
+  for (size_t i = 1; i < offsets.size(); ++i)
+    offsets[i] += offsets[i - 1];
+
+  values.resize(offsets.back());
+  vector<uint64_t> positions(offsets.begin(), prev(offsets.end()));
+  for (auto & threadPairs : pairs)
+  {
+    for (auto const & item : threadPairs)
+      values[positions[item.first]++] = item.second;
+    threadPairs = {};
+  }
+
+  // The threads find the values in an arbitrary order.
+  ParallelFor(size, threadsCount, [&](size_t, size_t k) {
+    sort(values.begin() + offsets[k], values.begin() + offsets[k + 1]);
+  });
+}
+
+// Returns the number of the items of the compressed sparse row |offsets|.
+template <typename Offsets>
+size_t CountOf(Offsets const & offsets)
+{
+  return offsets.size() == 0 ? 0 : static_cast<size_t>(offsets.size() - 1);
+}
 }  // namespace
 
 namespace geocoder
 {
+// static
+Index::TokenId constexpr Index::kUnknownTokenId;
+// static
+Index::DocId constexpr Index::kUnknownDocId;
+
 Index::Index(Hierarchy const & hierarchy)
   : m_docs(hierarchy.GetEntries())
   , m_hierarchy{hierarchy}
@@ -32,15 +114,75 @@ Index::Index(Hierarchy const & hierarchy)
 
 void Index::BuildIndex(unsigned int loadThreadsCount)
 {
-  CHECK_GREATER_OR_EQUAL(loadThreadsCount, 1, ());
+  CHECK_LESS(m_docs.size(), numeric_limits<DocId>::max(), ());
 
-  m_docIdsByTokens.clear();
-  m_relatedBuildings.clear();
+  PreviousDocs previousDocs;
+  previousDocs.m_previousDocIds.assign(m_docs.size(), kUnknownDocId);
 
+  Index{m_hierarchy}.Swap(*this);
+  Build(Index{m_hierarchy}, previousDocs, loadThreadsCount);
+}
+
+size_t Index::UpdateIndex(vector<uint32_t> const & entriesPositions, unsigned int loadThreadsCount)
+{
+  CHECK_LESS(m_docs.size(), numeric_limits<DocId>::max(), ());
+  CHECK_EQUAL(m_ancestorsOffsets.size(), entriesPositions.size() + 1,
+              ("The index is not built for the previous hierarchy"));
+
+  PreviousDocs previousDocs;
+  previousDocs.m_previousDocIds.assign(m_docs.size(), kUnknownDocId);
+  previousDocs.m_docIds.assign(entriesPositions.size(), kUnknownDocId);
+  for (size_t i = 0; i < entriesPositions.size(); ++i)
+  {
+    auto const position = entriesPositions[i];
+    if (position == Hierarchy::kRemovedEntryPosition)
+      continue;
+
+    CHECK_LESS(position, m_docs.size(), ());
+    previousDocs.m_docIds[i] = static_cast<DocId>(position);
+    previousDocs.m_previousDocIds[position] = static_cast<DocId>(i);
+  }
+
+  Index previous{m_hierarchy};
+  previous.Swap(*this);
+  return Build(previous, previousDocs, loadThreadsCount);
+}
+
+size_t Index::Build(Index const & previous, PreviousDocs const & previousDocs,
+                    unsigned int loadThreadsCount)
+{
+  CHECK_GREATER_OR_EQUAL(loadThreadsCount, 1, ());
+
+  LOG(LINFO, ("Resolving ancestors..."));
+  AddAncestors(previous, previousDocs, loadThreadsCount);
   LOG(LINFO, ("Indexing hierarchy entries..."));
-  AddEntries();
+  auto const numIndexed = AddEntries(previous, previousDocs);
   LOG(LINFO, ("Indexing houses..."));
-  AddHouses(loadThreadsCount);
+  AddHouses(previous, previousDocs, loadThreadsCount);
+  LOG(LINFO, ("Indexing house numbers..."));
+  AddHouseNumbers(previous, previousDocs, loadThreadsCount);
+  return numIndexed;
+}
+
+void Index::Swap(Index & other)
+{
+  CHECK_EQUAL(&m_docs, &other.m_docs, ());
+
+  m_tokensChars.swap(other.m_tokensChars);
+  m_tokensOffsets.swap(other.m_tokensOffsets);
+  m_keysTokenIds.swap(other.m_keysTokenIds);
+  m_keysOffsets.swap(other.m_keysOffsets);
+  m_docIdsOffsets.swap(other.m_docIdsOffsets);
+  m_docIds.swap(other.m_docIds);
+  m_ancestorsOffsets.swap(other.m_ancestorsOffsets);
+  m_ancestors.swap(other.m_ancestors);
+  m_relatedBuildingsOffsets.swap(other.m_relatedBuildingsOffsets);
+  m_relatedBuildings.swap(other.m_relatedBuildings);
+  m_houseNumberKeysChars.swap(other.m_houseNumberKeysChars);
+  m_houseNumberKeysOffsets.swap(other.m_houseNumberKeysOffsets);
+  m_buildingsByHouseNumbersOffsets.swap(other.m_buildingsByHouseNumbersOffsets);
+  m_buildingsByHouseNumbersKeys.swap(other.m_buildingsByHouseNumbersKeys);
+  m_buildingsByHouseNumbers.swap(other.m_buildingsByHouseNumbers);
 }
 
 Index::Doc const & Index::GetDoc(DocId const id) const
@@ -49,24 +191,145 @@ Index::Doc const & Index::GetDoc(DocId const id) const
   return m_docs[static_cast<size_t>(id)];
 }
 
-// static
-string Index::MakeIndexKey(Tokens const & tokens)
+bool Index::IsParentTo(DocId parent, DocId child) const
+{
+  ASSERT_LESS(static_cast<size_t>(child) + 1, m_ancestorsOffsets.size(), ());
+  auto const begin = m_ancestors.data() + m_ancestorsOffsets[child];
+  auto const end = m_ancestors.data() + m_ancestorsOffsets[child + 1];
+  return binary_search(begin, end, parent);
+}
+
+Index::TokenId Index::FindToken(boost::string_view token) const
 {
-  if (tokens.size() == 1 || is_sorted(begin(tokens), end(tokens)))
-    return strings::JoinStrings(tokens, " ");
+  if (m_tokensOffsets.size() == 0)
+    return kUnknownTokenId;
+
+  auto const tokensCount = static_cast<size_t>(m_tokensOffsets.size() - 1);
+  auto const tokenAt = [this](size_t t) {
+    auto const begin = m_tokensOffsets[t];
+    return boost::string_view{m_tokensChars.data() + begin,
+                              static_cast<size_t>(m_tokensOffsets[t + 1] - begin)};
+  };
+
+  size_t lo = 0;
+  size_t hi = tokensCount;
+  while (lo < hi)
+  {
+    auto const mid = lo + (hi - lo) / 2;
+    if (tokenAt(mid) < token)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == tokensCount || tokenAt(lo) != token)
+    return kUnknownTokenId;
 
-  auto indexTokens = tokens;
-  sort(begin(indexTokens), end(indexTokens));
-  return strings::JoinStrings(indexTokens, " ");
+  return static_cast<TokenId>(lo);
 }
 
-void Index::AddEntries()
+void Index::FindHouseNumberKeys(strings::UniString const & houseNumber,
+                                HouseNumberKeyIds & keyIds) const
+{
+  keyIds.clear();
+  if (m_houseNumberKeysOffsets.size() == 0)
+    return;
+
+  vector<string> keys;
+  search::house_numbers::GetQueryKeys(houseNumber, false /* queryIsPrefix */, keys);
+
+  auto const keysCount = static_cast<size_t>(m_houseNumberKeysOffsets.size() - 1);
+  auto const keyAt = [this](size_t k) {
+    auto const begin = m_houseNumberKeysOffsets[k];
+    return boost::string_view{m_houseNumberKeysChars.data() + begin,
+                              static_cast<size_t>(m_houseNumberKeysOffsets[k + 1] - begin)};
+  };
+  for (auto const & key : keys)
+  {
+    size_t lo = 0;
+    size_t hi = keysCount;
+    while (lo < hi)
+    {
+      auto const mid = lo + (hi - lo) / 2;
+      if (keyAt(mid) < key)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    if (lo != keysCount && keyAt(lo) == key)
+      keyIds.push_back(static_cast<HouseNumberKeyId>(lo));
+  }
+}
+
+bool Index::FindTokens(Tokens const & tokens, TokenIds & tokenIds) const
+{
+  tokenIds.clear();
+  tokenIds.reserve(tokens.size());
+  for (auto const & token : tokens)
+  {
+    auto const tokenId = FindToken(token);
+    if (tokenId == kUnknownTokenId)
+      return false;
+    tokenIds.push_back(tokenId);
+  }
+  sort(tokenIds.begin(), tokenIds.end());
+  return true;
+}
+
+bool Index::FindKey(TokenIds const & sortedTokenIds, size_t & keyNumber) const
+{
+  ASSERT(is_sorted(sortedTokenIds.begin(), sortedTokenIds.end()), ());
+
+  if (m_keysOffsets.size() == 0)
+    return false;
+
+  // Unknown tokens have the greatest id.
+  if (!sortedTokenIds.empty() && sortedTokenIds.back() == kUnknownTokenId)
+    return false;
+
+  auto const keysCount = static_cast<size_t>(m_keysOffsets.size() - 1);
+  auto const keyBegin = [this](size_t k) { return m_keysTokenIds.data() + m_keysOffsets[k]; };
+  auto const keyEnd = [this](size_t k) { return m_keysTokenIds.data() + m_keysOffsets[k + 1]; };
+
+  size_t lo = 0;
+  size_t hi = keysCount;
+  while (lo < hi)
+  {
+    auto const mid = lo + (hi - lo) / 2;
+    if (lexicographical_compare(keyBegin(mid), keyEnd(mid), sortedTokenIds.begin(),
+                                sortedTokenIds.end()))
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  if (lo == keysCount ||
+      !equal(keyBegin(lo), keyEnd(lo), sortedTokenIds.begin(), sortedTokenIds.end()))
+  {
+    return false;
+  }
+
+  keyNumber = lo;
+  return true;
+}
+
+size_t Index::AddEntries(Index const & previous, PreviousDocs const & previousDocs)
 {
   size_t numIndexed = 0;
   auto const & dictionary = m_hierarchy.GetNormalizedNameDictionary();
+  PostingListsBuilder builder;
   Tokens tokens;
   for (DocId docId = 0; docId < static_cast<DocId>(m_docs.size()); ++docId)
   {
+    // The kept docs are copied from the previous index.
+    if (!previousDocs.IsChanged(docId))
+      continue;
+
     auto const & doc = m_docs[static_cast<size_t>(docId)];
     // The doc is indexed only by its address.
     // todo(@m) Index it by name too.
@@ -78,15 +341,14 @@ void Index::AddEntries()
 
     if (doc.m_type == Type::Street)
     {
-      AddStreet(docId, doc);
+      AddStreet(docId, doc, builder);
     }
     else
     {
-      for (auto const & name : doc.GetNormalizedMultipleNames(doc.m_type, dictionary))
-      {
-        search::NormalizeAndTokenizeAsUtf8(name, tokens);
-        InsertToIndex(tokens, docId);
-      }
+      doc.GetNormalizedMultipleNames(doc.m_type, dictionary).ForEachName([&](auto const & name) {
+        search::NormalizeAndTokenizeAsUtf8(name.to_string(), tokens);
+        InsertToIndex(tokens, docId, builder);
+      });
     }
 
     ++numIndexed;
@@ -96,9 +358,12 @@ void Index::AddEntries()
 
   if (numIndexed % kLogBatch != 0)
     LOG(LINFO, ("Indexed", numIndexed, "entries"));
+
+  FinishPostingLists(builder, previous, previousDocs);
+  return numIndexed;
 }
 
-void Index::AddStreet(DocId const & docId, Index::Doc const & doc)
+void Index::AddStreet(DocId const & docId, Index::Doc const & doc, PostingListsBuilder & builder)
 {
   CHECK_EQUAL(doc.m_type, Type::Street, ());
 
@@ -107,19 +372,20 @@ void Index::AddStreet(DocId const & docId, Index::Doc const & doc)
   };
 
   auto const & dictionary = m_hierarchy.GetNormalizedNameDictionary();
+  auto const names = doc.GetNormalizedMultipleNames(Type::Street, dictionary);
   Tokens tokens;
-  for (auto const & name : doc.GetNormalizedMultipleNames(Type::Street, dictionary))
+  for (size_t n = 0; n < names.GetNamesCount(); ++n)
   {
-    search::NormalizeAndTokenizeAsUtf8(name, tokens);
+    search::NormalizeAndTokenizeAsUtf8(names.GetName(n).to_string(), tokens);
 
     if (all_of(begin(tokens), end(tokens), isStreetSynonym))
     {
       if (tokens.size() > 1)
-        InsertToIndex(tokens, docId);
+        InsertToIndex(tokens, docId, builder);
       return;
     }
 
-    InsertToIndex(tokens, docId);
+    InsertToIndex(tokens, docId, builder);
 
     for (size_t i = 0; i < tokens.size(); ++i)
     {
@@ -127,85 +393,541 @@ void Index::AddStreet(DocId const & docId, Index::Doc const & doc)
         continue;
       auto addr = tokens;
       addr.erase(addr.begin() + i);
-      InsertToIndex(addr, docId);
+      InsertToIndex(addr, docId, builder);
     }
   }
 }
 
-void Index::AddHouses(unsigned int loadThreadsCount)
+void Index::AddAncestors(Index const & previous, PreviousDocs const & previousDocs,
+                         unsigned int loadThreadsCount)
 {
-  atomic<size_t> numIndexed{0};
-  mutex buildingsMutex;
+  auto const & dictionary = m_hierarchy.GetNormalizedNameDictionary();
 
-  vector<thread> threads(loadThreadsCount);
-  CHECK_GREATER(threads.size(), 0, ());
+  // Hierarchy::IsParentTo compares the address fields by main names and different
+  // dictionary positions may share a main name. Map every position to the first
+  // position with the same main name so that names are compared as integers.
+  vector<NameDictionary::Position> mainNames(dictionary.Size() + 1,
+                                             NameDictionary::kUnspecifiedPosition);
+  {
+    unordered_map<boost::string_view, NameDictionary::Position, boost::hash<boost::string_view>>
+        firstPositions;
+    for (NameDictionary::Position p = 1; p <= dictionary.Size(); ++p)
+      mainNames[p] = firstPositions.emplace(dictionary.Get(p).GetMainName(), p).first->second;
+  }
+
+  auto const addressMainName = [&mainNames](Doc const & doc, size_t type) {
+    return mainNames[doc.m_normalizedAddress[type]];
+  };
+
+  // Bit |t| of neededParents[name] is set if a changed doc has the field of the type |t|
+  // with the main name |name|. Bit |t| of changedParents[name] is set if a changed doc
+  // of the type |t| has the main name |name|. The kept docs are looked up by them.
+  static_assert(static_cast<size_t>(Type::Count) <= 8, "");
+  vector<uint8_t> neededParents(mainNames.size(), 0);
+  vector<uint8_t> changedParents(mainNames.size(), 0);
+  for (DocId docId = 0; docId < static_cast<DocId>(m_docs.size()); ++docId)
+  {
+    auto const & doc = GetDoc(docId);
+    if (!previousDocs.IsChanged(docId) || doc.m_type == Type::Count)
+      continue;
+
+    auto const type = static_cast<size_t>(doc.m_type);
+    for (size_t i = 0; i < type; ++i)
+    {
+      if (doc.HasFieldInAddress(static_cast<Type>(i)))
+        neededParents[addressMainName(doc, i)] |= 1 << i;
+    }
+    if (doc.m_type != Type::Building)
+      changedParents[addressMainName(doc, type)] |= 1 << type;
+  }
+
+  // Potential parents by their types and the main names of their most specific fields.
+  auto const makeKey = [](Type type, NameDictionary::Position mainName) {
+    return (static_cast<uint64_t>(mainName) << 8) | static_cast<uint64_t>(type);
+  };
+  unordered_map<uint64_t, vector<DocId>> parentCandidates;
+  for (DocId docId = 0; docId < static_cast<DocId>(m_docs.size()); ++docId)
+  {
+    auto const & doc = GetDoc(docId);
+    // Buildings are the most specific entries and are not parents to anything.
+    if (doc.m_type == Type::Count || doc.m_type == Type::Building)
+      continue;
+    auto const type = static_cast<size_t>(doc.m_type);
+    auto const mainName = addressMainName(doc, type);
+    if (previousDocs.IsChanged(docId) || (neededParents[mainName] & (1 << type)) != 0)
+      parentCandidates[makeKey(doc.m_type, mainName)].push_back(docId);
+  }
+
+  auto const isParentTo = [&](Doc const & parent, Doc const & child) {
+    for (size_t i = 0; i < static_cast<size_t>(Type::Count); ++i)
+    {
+      if (parent.m_normalizedAddress[i] == NameDictionary::kUnspecifiedPosition)
+        continue;
+      if (child.m_normalizedAddress[i] == NameDictionary::kUnspecifiedPosition)
+        return false;
+      if (addressMainName(parent, i) != addressMainName(child, i))
+        return false;
+    }
+    return true;
+  };
+
+  // (doc, ancestor) pairs found by the threads.
+  vector<vector<pair<DocId, DocId>>> relations(loadThreadsCount);
+
+  ParallelFor(m_docs.size(), loadThreadsCount, [&](size_t t, size_t i) {
+    auto const docId = static_cast<DocId>(i);
+    auto const & doc = GetDoc(docId);
+    if (doc.m_type == Type::Count)
+      return;
+
+    // The kept docs keep their kept ancestors and are checked against the changed docs only.
+    auto const previousDocId = previousDocs.m_previousDocIds[docId];
+    bool const changed = previousDocId == kUnknownDocId;
+    if (!changed)
+    {
+      previous.ForEachAncestor(previousDocId, [&](DocId const & ancestor) {
+        auto const ancestorDocId = previousDocs.m_docIds[ancestor];
+        if (ancestorDocId != kUnknownDocId)
+          relations[t].emplace_back(docId, ancestorDocId);
+      });
+    }
+
+    for (size_t j = 0; j < static_cast<size_t>(Type::Count); ++j)
+    {
+      auto const type = static_cast<Type>(j);
+      if (type >= doc.m_type || !doc.HasFieldInAddress(type))
+        continue;
+
+      auto const mainName = addressMainName(doc, j);
+      if (!changed && (changedParents[mainName] & (1 << j)) == 0)
+        continue;
+
+      auto const it = parentCandidates.find(makeKey(type, mainName));
+      if (it == parentCandidates.end())
+        continue;
+
+      for (auto const candidate : it->second)
+      {
+        if (!changed && !previousDocs.IsChanged(candidate))
+          continue;
+        if (isParentTo(GetDoc(candidate), doc))
+          relations[t].emplace_back(docId, candidate);
+      }
+    }
+  });
+
+  vector<uint64_t> ancestorsOffsets;
+  vector<DocId> ancestors;
+  GroupByKeys(m_docs.size(), loadThreadsCount, relations, ancestorsOffsets, ancestors);
+
+  LOG(LINFO, ("Resolved", ancestors.size(), "ancestors"));
+
+  m_ancestorsOffsets.steal(ancestorsOffsets);
+  m_ancestors.steal(ancestors);
+}
+
+void Index::AddHouses(Index const & previous, PreviousDocs const & previousDocs,
+                      unsigned int loadThreadsCount)
+{
+  atomic<size_t> numIndexed{0};
+  // (street or locality, building) pairs found by the threads.
+  vector<vector<pair<DocId, DocId>>> relations(loadThreadsCount);
 
   auto const & dictionary = m_hierarchy.GetNormalizedNameDictionary();
 
-  for (size_t t = 0; t < threads.size(); ++t)
+  ParallelFor(m_docs.size(), loadThreadsCount, [&](size_t t, size_t i) {
+    auto const docId = static_cast<DocId>(i);
+
+    // The kept streets and localities keep their kept buildings.
+    auto const previousDocId = previousDocs.m_previousDocIds[docId];
+    bool const changed = previousDocId == kUnknownDocId;
+    if (!changed)
+    {
+      previous.ForEachRelatedBuilding(previousDocId, [&](DocId const & building) {
+        auto const buildingDocId = previousDocs.m_docIds[building];
+        if (buildingDocId != kUnknownDocId)
+          relations[t].emplace_back(docId, buildingDocId);
+      });
+    }
+
+    auto const & buildingDoc = GetDoc(docId);
+
+    if (buildingDoc.m_type != Type::Building)
+      return;
+
+    // A kept building may be related only to the changed streets and localities
+    // which are its ancestors.
+    if (!changed)
+    {
+      bool hasChangedAncestors = false;
+      ForEachAncestor(docId, [&](DocId const & ancestor) {
+        hasChangedAncestors = hasChangedAncestors || previousDocs.IsChanged(ancestor);
+      });
+      if (!hasChangedAncestors)
+        return;
+    }
+
+    auto const & street = buildingDoc.m_normalizedAddress[static_cast<size_t>(Type::Street)];
+    auto const & locality = buildingDoc.m_normalizedAddress[static_cast<size_t>(Type::Locality)];
+
+    NameDictionary::Position relation = NameDictionary::kUnspecifiedPosition;
+    if (street != NameDictionary::kUnspecifiedPosition)
+      relation = street;
+    else if (locality != NameDictionary::kUnspecifiedPosition)
+      relation = locality;
+    else
+      return;
+
+    auto const & relationName = dictionary.Get(relation).GetMainName();
+    Tokens relationNameTokens;
+    search::NormalizeAndTokenizeAsUtf8(relationName.to_string(), relationNameTokens);
+    CHECK(!relationNameTokens.empty(), ());
+
+    bool indexed = false;
+    ForEachDocId(relationNameTokens, [&](DocId const & candidate) {
+      if ((changed || previousDocs.IsChanged(candidate)) && IsParentTo(candidate, docId))
+      {
+        indexed = true;
+        relations[t].emplace_back(candidate, docId);
+      }
+    });
+
+    if (indexed)
+    {
+      auto const processedCount = numIndexed.fetch_add(1) + 1;
+      if (processedCount % kLogBatch == 0)
+        LOG(LINFO, ("Indexed", processedCount, "houses"));
+    }
+  });
+
+  if (numIndexed % kLogBatch != 0)
+    LOG(LINFO, ("Indexed", numIndexed, "houses"));
+
+  vector<uint64_t> relatedBuildingsOffsets;
+  vector<DocId> buildings;
+  GroupByKeys(m_docs.size(), loadThreadsCount, relations, relatedBuildingsOffsets, buildings);
+
+  m_relatedBuildingsOffsets.steal(relatedBuildingsOffsets);
+  m_relatedBuildings.steal(buildings);
+}
+
+void Index::FinishPostingLists(PostingListsBuilder & builder, Index const & previous,
+                               PreviousDocs const & previousDocs)
+{
+  vector<pair<string const *, TokenId>> tokens;
+  tokens.reserve(builder.m_tokenIds.size());
+  for (auto const & item : builder.m_tokenIds)
+    tokens.emplace_back(&item.first, item.second);
+  sort(tokens.begin(), tokens.end(),
+       [](auto const & lhs, auto const & rhs) { return *lhs.first < *rhs.first; });
+
+  // Both the previous and the new tokens are sorted: they are merged keeping the order
+  // so that the previous keys stay sorted after their token ids are renumbered.
+  auto const previousTokensCount = CountOf(previous.m_tokensOffsets);
+  auto const previousToken = [&previous](size_t t) {
+    auto const & offsets = previous.m_tokensOffsets;
+    return boost::string_view(previous.m_tokensChars.data() + offsets[t],
+                              static_cast<size_t>(offsets[t + 1] - offsets[t]));
+  };
+
+  vector<boost::string_view> mergedTokens;
+  mergedTokens.reserve(previousTokensCount + tokens.size());
+  vector<TokenId> previousIds(previousTokensCount);
+  vector<TokenId> sortedIds(tokens.size());
+  for (size_t i = 0, j = 0; i < previousTokensCount || j < tokens.size();)
+  {
+    auto const tokenId = static_cast<TokenId>(mergedTokens.size());
+    CHECK_LESS(tokenId, kUnknownTokenId, ());
+    if (j == tokens.size() || (i < previousTokensCount && previousToken(i) <= *tokens[j].first))
+    {
+      mergedTokens.push_back(previousToken(i));
+      if (j < tokens.size() && previousToken(i) == *tokens[j].first)
+        sortedIds[tokens[j++].second] = tokenId;
+      previousIds[i++] = tokenId;
+    }
+    else
+    {
+      mergedTokens.emplace_back(*tokens[j].first);
+      sortedIds[tokens[j++].second] = tokenId;
+    }
+  }
+
+  vector<pair<TokenIds, vector<DocId> *>> keys;
+  keys.reserve(builder.m_docIdsByKeys.size());
+  for (auto & item : builder.m_docIdsByKeys)
   {
-    threads[t] = thread([&, t, this]() {
-      size_t const size = m_docs.size() / threads.size();
-      size_t docId = t * size;
-      size_t const docIdEnd = (t + 1 == threads.size() ? m_docs.size() : docId + size);
+    TokenIds key;
+    key.reserve(item.first.size());
+    for (auto const tokenId : item.first)
+      key.push_back(sortedIds[tokenId]);
+    sort(key.begin(), key.end());
+    keys.emplace_back(move(key), &item.second);
+  }
+  sort(keys.begin(), keys.end(), base::LessBy(&pair<TokenIds, vector<DocId> *>::first));
+
+  auto const previousKeysCount = CountOf(previous.m_keysOffsets);
+  TokenIds previousKey;
+  auto const loadPreviousKey = [&](size_t k) {
+    previousKey.clear();
+    for (auto i = previous.m_keysOffsets[k]; i < previous.m_keysOffsets[k + 1]; ++i)
+      previousKey.push_back(previousIds[previous.m_keysTokenIds[i]]);
+  };
+  if (previousKeysCount != 0)
+    loadPreviousKey(0);
+
+  vector<TokenId> keysTokenIds;
+  vector<uint64_t> keysOffsets{0};
+  vector<uint64_t> docIdsOffsets{0};
+  vector<DocId> docIds;
+  for (size_t k = 0, j = 0; k < previousKeysCount || j < keys.size();)
+  {
+    bool const hasPrevious =
+        k < previousKeysCount && (j == keys.size() || previousKey <= keys[j].first);
+    bool const hasNew =
+        j < keys.size() && (k == previousKeysCount || keys[j].first <= previousKey);
 
-      for (; docId < docIdEnd; ++docId)
+    auto const first = docIds.size();
+    if (hasPrevious)
+    {
+      for (auto i = previous.m_docIdsOffsets[k]; i < previous.m_docIdsOffsets[k + 1]; ++i)
       {
-        auto const & buildingDoc = GetDoc(docId);
+        auto const docId = previousDocs.m_docIds[previous.m_docIds[i]];
+        if (docId != kUnknownDocId)
+          docIds.push_back(docId);
+      }
+    }
+    if (hasNew)
+    {
+      // The kept and the changed docs are disjoint.
+      auto const middle = docIds.size();
+      auto const & ids = *keys[j].second;
+      docIds.insert(docIds.end(), ids.begin(), ids.end());
+      inplace_merge(docIds.begin() + first, docIds.begin() + middle, docIds.end());
+    }
 
-        if (buildingDoc.m_type != Type::Building)
-          continue;
+    // The keys of the removed docs only are dropped.
+    if (docIds.size() != first)
+    {
+      auto const & key = hasPrevious ? previousKey : keys[j].first;
+      keysTokenIds.insert(keysTokenIds.end(), key.begin(), key.end());
+      keysOffsets.push_back(keysTokenIds.size());
+      docIdsOffsets.push_back(docIds.size());
+    }
+
+    if (hasNew)
+      ++j;
+    if (hasPrevious && ++k < previousKeysCount)
+      loadPreviousKey(k);
+  }
 
-        auto const & street = buildingDoc.m_normalizedAddress[static_cast<size_t>(Type::Street)];
-        auto const & locality =
-            buildingDoc.m_normalizedAddress[static_cast<size_t>(Type::Locality)];
+  // Drop the tokens of the dropped keys. The renumbering keeps the order of the tokens.
+  vector<TokenId> usedIds(mergedTokens.size(), kUnknownTokenId);
+  for (auto const tokenId : keysTokenIds)
+    usedIds[tokenId] = 0;
 
-        NameDictionary::Position relation = NameDictionary::kUnspecifiedPosition;
-        if (street != NameDictionary::kUnspecifiedPosition)
-          relation = street;
-        else if (locality != NameDictionary::kUnspecifiedPosition)
-          relation = locality;
-        else
-          continue;
+  vector<char> tokensChars;
+  vector<uint64_t> tokensOffsets{0};
+  for (size_t t = 0; t < mergedTokens.size(); ++t)
+  {
+    if (usedIds[t] == kUnknownTokenId)
+      continue;
+
+    usedIds[t] = static_cast<TokenId>(tokensOffsets.size() - 1);
+    tokensChars.insert(tokensChars.end(), mergedTokens[t].begin(), mergedTokens[t].end());
+    tokensOffsets.push_back(tokensChars.size());
+  }
+  for (auto & tokenId : keysTokenIds)
+    tokenId = usedIds[tokenId];
+
+  m_tokensChars.steal(tokensChars);
+  m_tokensOffsets.steal(tokensOffsets);
+  m_keysTokenIds.steal(keysTokenIds);
+  m_keysOffsets.steal(keysOffsets);
+  m_docIdsOffsets.steal(docIdsOffsets);
+  m_docIds.steal(docIds);
+
+  builder = {};
+}
+
+void Index::AddHouseNumbers(Index const & previous, PreviousDocs const & previousDocs,
+                            unsigned int loadThreadsCount)
+{
+  auto const & dictionary = m_hierarchy.GetNormalizedNameDictionary();
+
+  // Keys of the changed buildings and of the kept buildings which may be related
+  // to changed streets: (building, key) pairs found by the threads.
+  vector<vector<pair<DocId, string>>> chunks(loadThreadsCount);
+
+  ParallelFor(m_docs.size(), loadThreadsCount, [&](size_t t, size_t i) {
+    auto const docId = static_cast<DocId>(i);
+    auto const & doc = GetDoc(docId);
+    if (doc.m_type != Type::Building)
+      return;
+
+    if (!previousDocs.IsChanged(docId))
+    {
+      bool hasChangedAncestors = false;
+      ForEachAncestor(docId, [&](DocId const & ancestor) {
+        hasChangedAncestors = hasChangedAncestors || previousDocs.IsChanged(ancestor);
+      });
+      if (!hasChangedAncestors)
+        return;
+    }
+
+    auto const & houseNumber =
+        doc.GetNormalizedMultipleNames(Type::Building, dictionary).GetMainName();
+    vector<string> keys;
+    search::house_numbers::GetHouseNumberKeys(strings::MakeUniString(houseNumber.to_string()),
+                                              keys);
+    for (auto & key : keys)
+      chunks[t].emplace_back(docId, move(key));
+  });
+
+  // The keys of the previous index have the ids [0, previousKeysCount) and
+  // the new keys have the ids starting from |previousKeysCount|.
+  auto const previousKeysCount = CountOf(previous.m_houseNumberKeysOffsets);
+  unordered_map<string, HouseNumberKeyId> keyIds;
+  vector<vector<pair<DocId, HouseNumberKeyId>>> buildingKeyIds(chunks.size());
+  for (size_t t = 0; t < chunks.size(); ++t)
+  {
+    buildingKeyIds[t].reserve(chunks[t].size());
+    for (auto const & item : chunks[t])
+    {
+      auto const keyId = static_cast<HouseNumberKeyId>(previousKeysCount + keyIds.size());
+      buildingKeyIds[t].emplace_back(item.first, keyIds.emplace(item.second, keyId).first->second);
+    }
+    chunks[t] = {};
+  }
+
+  vector<uint64_t> buildingKeysOffsets;
+  vector<HouseNumberKeyId> buildingKeys;
+  GroupByKeys(m_docs.size(), loadThreadsCount, buildingKeyIds, buildingKeysOffsets, buildingKeys);
 
-        auto const & relationMultipleNames = dictionary.Get(relation);
-        auto const & relationName = relationMultipleNames.GetMainName();
-        Tokens relationNameTokens;
-        search::NormalizeAndTokenizeAsUtf8(relationName, relationNameTokens);
-        CHECK(!relationNameTokens.empty(), ());
-
-        bool indexed = false;
-        ForEachDocId(relationNameTokens, [&](DocId const & candidate) {
-          auto const & candidateDoc = GetDoc(candidate);
-          if (m_hierarchy.IsParentTo(candidateDoc, buildingDoc))
-          {
-            indexed = true;
-
-            lock_guard<mutex> lock(buildingsMutex);
-            m_relatedBuildings[candidate].emplace_back(docId);
-          }
-        });
-
-        if (indexed)
+  // (street, (key, building)) pairs found by the threads.
+  vector<vector<pair<DocId, pair<HouseNumberKeyId, DocId>>>> streetsBuildings(loadThreadsCount);
+
+  ParallelFor(m_docs.size(), loadThreadsCount, [&](size_t t, size_t i) {
+    auto const docId = static_cast<DocId>(i);
+
+    // The kept streets keep the keys of their kept buildings.
+    auto const previousDocId = previousDocs.m_previousDocIds[docId];
+    bool const changed = previousDocId == kUnknownDocId;
+    if (!changed && previousDocId + 1 < previous.m_buildingsByHouseNumbersOffsets.size())
+    {
+      for (auto j = previous.m_buildingsByHouseNumbersOffsets[previousDocId];
+           j < previous.m_buildingsByHouseNumbersOffsets[previousDocId + 1]; ++j)
+      {
+        auto const building = previousDocs.m_docIds[previous.m_buildingsByHouseNumbers[j]];
+        if (building != kUnknownDocId)
         {
-          auto const processedCount = numIndexed.fetch_add(1) + 1;
-          if (processedCount % kLogBatch == 0)
-            LOG(LINFO, ("Indexed", processedCount, "houses"));
+          streetsBuildings[t].emplace_back(
+              docId, make_pair(previous.m_buildingsByHouseNumbersKeys[j], building));
         }
       }
+    }
+
+    ForEachRelatedBuilding(docId, [&](DocId const & building) {
+      if (!changed && !previousDocs.IsChanged(building))
+        return;
+
+      for (auto j = buildingKeysOffsets[building]; j < buildingKeysOffsets[building + 1]; ++j)
+        streetsBuildings[t].emplace_back(docId, make_pair(buildingKeys[j], building));
     });
+  });
+
+  vector<uint64_t> buildingsOffsets;
+  vector<pair<HouseNumberKeyId, DocId>> keysBuildings;
+  GroupByKeys(m_docs.size(), loadThreadsCount, streetsBuildings, buildingsOffsets, keysBuildings);
+
+  // Only the keys of the related buildings are kept. Both the previous keys and the new
+  // keys are sorted: they are merged keeping the order so that the keys of the streets
+  // stay sorted after the renumbering.
+  static auto constexpr kUnusedKeyId = numeric_limits<HouseNumberKeyId>::max();
+  vector<HouseNumberKeyId> sortedIds(previousKeysCount + keyIds.size(), kUnusedKeyId);
+  for (auto const & item : keysBuildings)
+    sortedIds[item.first] = 0;
+
+  auto const previousKey = [&previous](size_t k) {
+    auto const & offsets = previous.m_houseNumberKeysOffsets;
+    return boost::string_view(previous.m_houseNumberKeysChars.data() + offsets[k],
+                              static_cast<size_t>(offsets[k + 1] - offsets[k]));
+  };
+
+  vector<pair<boost::string_view, HouseNumberKeyId>> keys;
+  keys.reserve(keyIds.size());
+  for (auto const & item : keyIds)
+  {
+    if (sortedIds[item.second] != kUnusedKeyId)
+      keys.emplace_back(item.first, item.second);
   }
+  sort(keys.begin(), keys.end());
+
+  vector<char> keysChars;
+  vector<uint64_t> keysOffsets{0};
+  auto const addKey = [&](boost::string_view key) {
+    keysChars.insert(keysChars.end(), key.begin(), key.end());
+    keysOffsets.push_back(keysChars.size());
+    return static_cast<HouseNumberKeyId>(keysOffsets.size() - 2);
+  };
+  for (size_t k = 0, j = 0; k < previousKeysCount || j < keys.size();)
+  {
+    if (k < previousKeysCount && sortedIds[k] == kUnusedKeyId)
+    {
+      ++k;
+      continue;
+    }
 
-  for (auto & t : threads)
-    t.join();
+    if (j == keys.size() || (k < previousKeysCount && previousKey(k) <= keys[j].first))
+    {
+      auto const keyId = addKey(previousKey(k));
+      if (j < keys.size() && previousKey(k) == keys[j].first)
+        sortedIds[keys[j++].second] = keyId;
+      sortedIds[k++] = keyId;
+    }
+    else
+    {
+      sortedIds[keys[j].second] = addKey(keys[j].first);
+      ++j;
+    }
+  }
 
-  if (numIndexed % kLogBatch != 0)
-    LOG(LINFO, ("Indexed", numIndexed, "houses"));
+  for (auto & item : keysBuildings)
+    item.first = sortedIds[item.first];
+  ParallelFor(m_docs.size(), loadThreadsCount, [&](size_t, size_t docId) {
+    sort(keysBuildings.begin() + buildingsOffsets[docId],
+         keysBuildings.begin() + buildingsOffsets[docId + 1]);
+  });
+
+  vector<HouseNumberKeyId> buildingsKeys;
+  vector<DocId> buildings;
+  buildingsKeys.reserve(keysBuildings.size());
+  buildings.reserve(keysBuildings.size());
+  for (auto const & item : keysBuildings)
+  {
+    buildingsKeys.push_back(item.first);
+    buildings.push_back(item.second);
+  }
+
+  m_houseNumberKeysChars.steal(keysChars);
+  m_houseNumberKeysOffsets.steal(keysOffsets);
+  m_buildingsByHouseNumbersOffsets.steal(buildingsOffsets);
+  m_buildingsByHouseNumbersKeys.steal(buildingsKeys);
+  m_buildingsByHouseNumbers.steal(buildings);
 }
 
-void Index::InsertToIndex(Tokens const & tokens, DocId docId)
+void Index::InsertToIndex(Tokens const & tokens, DocId docId, PostingListsBuilder & builder)
 {
-  auto & ids = m_docIdsByTokens[MakeIndexKey(tokens)];
+  TokenIds key;
+  key.reserve(tokens.size());
+  for (auto const & token : tokens)
+  {
+    auto const tokenId = static_cast<TokenId>(builder.m_tokenIds.size());
+    CHECK_LESS(tokenId, kUnknownTokenId, ());
+    key.push_back(builder.m_tokenIds.emplace(token, tokenId).first->second);
+  }
+  sort(key.begin(), key.end());
+
+  auto & ids = builder.m_docIdsByKeys[key];
   if (0 == count(ids.begin(), ids.end(), docId))
     ids.emplace_back(docId);
 }
@@ -3,15 +3,21 @@
 #include "geocoder/hierarchy.hpp"
 
 #include "base/geo_object_id.hpp"
+#include "base/string_utils.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <map>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include <boost/serialization/unordered_map.hpp>
-#include <boost/serialization/version.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include "3party/succinct/mappable_vector.hpp"
 
 namespace geocoder
 {
@@ -22,36 +28,101 @@ public:
 
   // Number of the entry in the list of all hierarchy entries
   // that the index was constructed from.
-  using DocId = std::vector<Doc>::size_type;
+  using DocId = uint32_t;
+
+  // Number of the normalized token in the lexicographically sorted
+  // list of all the tokens of the index.
+  using TokenId = uint32_t;
+  using TokenIds = std::vector<TokenId>;
+
+  static TokenId constexpr kUnknownTokenId = std::numeric_limits<TokenId>::max();
+
+  // Number of the house number key (see search::house_numbers::GetHouseNumberKeys())
+  // in the lexicographically sorted list of the keys of all the buildings.
+  using HouseNumberKeyId = uint32_t;
+  using HouseNumberKeyIds = std::vector<HouseNumberKeyId>;
 
   explicit Index(Hierarchy const & hierarchy);
 
+  Index(Index const &) = delete;
+  Index & operator=(Index const &) = delete;
+
   void BuildIndex(unsigned int loadThreadsCount = 1);
 
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version)
+  // Updates the index of the previous version of the hierarchy after Hierarchy::ApplyChanges():
+  // |entriesPositions| are the positions of the previous entries in the updated hierarchy.
+  // Only the changed docs are tokenized. The kept docs keep their posting lists, ancestors
+  // and buildings, which are only renumbered, and get the changed docs related to them.
+  // Returns the number of the docs which were tokenized into the posting lists.
+  size_t UpdateIndex(std::vector<uint32_t> const & entriesPositions,
+                     unsigned int loadThreadsCount = 1);
+
+  // Freezes the index to the binary index or maps it from there.
+  // All the containers are flat arrays so the mapped index is queried in place.
+  template <typename Visitor>
+  void map(Visitor & visitor)
   {
-    CHECK_EQUAL(version, kIndexFormatVersion, ());
-    ar & m_docIdsByTokens;
-    ar & m_relatedBuildings;
+    visitor(m_tokensChars, "tokensChars");
+    visitor(m_tokensOffsets, "tokensOffsets");
+    visitor(m_keysTokenIds, "keysTokenIds");
+    visitor(m_keysOffsets, "keysOffsets");
+    visitor(m_docIdsOffsets, "docIdsOffsets");
+    visitor(m_docIds, "docIds");
+    visitor(m_ancestorsOffsets, "ancestorsOffsets");
+    visitor(m_ancestors, "ancestors");
+    visitor(m_relatedBuildingsOffsets, "relatedBuildingsOffsets");
+    visitor(m_relatedBuildings, "relatedBuildings");
+    visitor(m_houseNumberKeysChars, "houseNumberKeysChars");
+    visitor(m_houseNumberKeysOffsets, "houseNumberKeysOffsets");
+    visitor(m_buildingsByHouseNumbersOffsets, "buildingsByHouseNumbersOffsets");
+    visitor(m_buildingsByHouseNumbersKeys, "buildingsByHouseNumbersKeys");
+    visitor(m_buildingsByHouseNumbers, "buildingsByHouseNumbers");
   }
 
+  void Swap(Index & other);
+
   Doc const & GetDoc(DocId const id) const;
 
-  // Calls |fn| for DocIds of Docs whose names exactly match |tokens| (the order matters).
-  //
-  // todo This method (and the whole class, in fact) is in the
-  //      prototype stage and may be too slow. Proper indexing should
-  //      be implemented to perform this type of queries.
+  // Returns the id of the normalized |token| or kUnknownTokenId
+  // if no name of the index contains it. Does not allocate.
+  TokenId FindToken(boost::string_view token) const;
+
+  // Calls |fn| for DocIds of Docs whose names consist exactly of the tokens
+  // |sortedTokenIds| (the order does not matter but the ids must be sorted).
+  // This is the query-time lookup: it neither allocates nor touches the strings.
+  template <typename Fn>
+  void ForEachDocId(TokenIds const & sortedTokenIds, Fn && fn) const
+  {
+    size_t key;
+    if (!FindKey(sortedTokenIds, key))
+      return;
+
+    for (auto i = m_docIdsOffsets[key]; i < m_docIdsOffsets[key + 1]; ++i)
+      fn(m_docIds[i]);
+  }
+
+  // Same as above but looks up the ids of |tokens| first.
   template <typename Fn>
   void ForEachDocId(Tokens const & tokens, Fn && fn) const
   {
-    auto const it = m_docIdsByTokens.find(MakeIndexKey(tokens));
-    if (it == m_docIdsByTokens.end())
+    TokenIds tokenIds;
+    if (!FindTokens(tokens, tokenIds))
       return;
 
-    for (DocId const & docId : it->second)
-      fn(docId);
+    ForEachDocId(tokenIds, std::forward<Fn>(fn));
+  }
+
+  // Returns true iff |parent| is an ancestor of |child|, i.e. is less specific than |child|
+  // and Hierarchy::IsParentTo holds for them. The ancestors are resolved when
+  // the index is built so the check does not compare names.
+  bool IsParentTo(DocId parent, DocId child) const;
+
+  // Calls |fn| for DocIds of all the ancestors of |docId| in the increasing order.
+  template <typename Fn>
+  void ForEachAncestor(DocId const & docId, Fn && fn) const
+  {
+    for (auto i = m_ancestorsOffsets[docId]; i < m_ancestorsOffsets[docId + 1]; ++i)
+      fn(m_ancestors[i]);
   }
 
   // Calls |fn| for DocIds of buildings that are located on the
@@ -59,39 +130,136 @@ public:
   template <typename Fn>
   void ForEachRelatedBuilding(DocId const & docId, Fn && fn) const
   {
-    auto const it = m_relatedBuildings.find(docId);
-    if (it == m_relatedBuildings.end())
+    if (docId + 1 >= m_relatedBuildingsOffsets.size())
+      return;
+
+    for (auto i = m_relatedBuildingsOffsets[docId]; i < m_relatedBuildingsOffsets[docId + 1]; ++i)
+      fn(m_relatedBuildings[i]);
+  }
+
+  // Writes the ids of the keys of the house number query |houseNumber| to |keyIds|.
+  // The keys which are not in the index are skipped.
+  void FindHouseNumberKeys(strings::UniString const & houseNumber, HouseNumberKeyIds & keyIds) const;
+
+  // Calls |fn| for DocIds of buildings that are located on the street/locality |docId|
+  // and have the house number key |keyId|. The buildings are candidates for a match
+  // only, a building is reported once per key it has.
+  template <typename Fn>
+  void ForEachRelatedBuilding(DocId const & docId, HouseNumberKeyId keyId, Fn && fn) const
+  {
+    if (docId + 1 >= m_buildingsByHouseNumbersOffsets.size())
       return;
 
-    for (DocId const & docId : it->second)
-      fn(docId);
+    auto const keysBegin = m_buildingsByHouseNumbersKeys.begin();
+    auto const range =
+        std::equal_range(keysBegin + m_buildingsByHouseNumbersOffsets[docId],
+                         keysBegin + m_buildingsByHouseNumbersOffsets[docId + 1], keyId);
+    for (auto it = range.first; it != range.second; ++it)
+      fn(m_buildingsByHouseNumbers[static_cast<size_t>(it - keysBegin)]);
   }
 
 private:
-  void InsertToIndex(Tokens const & tokens, DocId docId);
+  static DocId constexpr kUnknownDocId = std::numeric_limits<DocId>::max();
+
+  // Correspondence between the docs and the docs of the previous index
+  // that the index is updated from. Every doc is changed when the index is built anew.
+  struct PreviousDocs
+  {
+    bool IsChanged(DocId docId) const { return m_previousDocIds[docId] == kUnknownDocId; }
+
+    // Previous DocIds of the docs, kUnknownDocId for the changed and added docs.
+    std::vector<DocId> m_previousDocIds;
+    // DocIds of the previous docs, kUnknownDocId for the changed and removed docs.
+    std::vector<DocId> m_docIds;
+  };
+
+  // Posting lists collected while building the index. Tokens get
+  // ids in the order of appearance, they are renumbered in the lexicographical
+  // order when the index is finalized.
+  struct PostingListsBuilder
+  {
+    std::unordered_map<std::string, TokenId> m_tokenIds;
+    std::map<TokenIds, std::vector<DocId>> m_docIdsByKeys;
+  };
+
+  void InsertToIndex(Tokens const & tokens, DocId docId, PostingListsBuilder & builder);
 
-  // Converts |tokens| to a single UTF-8 string that can be used
-  // as a key in the |m_docIdsByTokens| map.
-  static std::string MakeIndexKey(Tokens const & tokens);
+  // Looks up the ids of |tokens| and writes them sorted to |tokenIds|.
+  // Returns false if any of the tokens is unknown.
+  bool FindTokens(Tokens const & tokens, TokenIds & tokenIds) const;
 
-  // Adds address information of |m_docs| to the index.
-  void AddEntries();
+  // Looks up the key |sortedTokenIds| and writes its number to |keyNumber|.
+  bool FindKey(TokenIds const & sortedTokenIds, size_t & keyNumber) const;
+
+  // Builds the index from the changed docs of |previousDocs| and the data of |previous|.
+  // Returns the number of the indexed docs.
+  size_t Build(Index const & previous, PreviousDocs const & previousDocs,
+               unsigned int loadThreadsCount);
+
+  // Adds address information of the changed docs to the index and copies
+  // the posting lists of the kept docs from |previous|.
+  size_t AddEntries(Index const & previous, PreviousDocs const & previousDocs);
 
   // Adds the street |e| (which has the id of |docId|) to the index,
   // with and without synonyms of the word "street".
-  void AddStreet(DocId const & docId, Doc const & e);
+  void AddStreet(DocId const & docId, Doc const & e, PostingListsBuilder & builder);
+
+  // Merges the posting lists from |builder| and the renumbered posting lists
+  // of |previous| to the flat arrays.
+  void FinishPostingLists(PostingListsBuilder & builder, Index const & previous,
+                          PreviousDocs const & previousDocs);
+
+  // Fills the |m_ancestors| field.
+  void AddAncestors(Index const & previous, PreviousDocs const & previousDocs,
+                    unsigned int loadThreadsCount);
 
   // Fills the |m_relatedBuildings| field.
-  void AddHouses(unsigned int loadThreadsCount);
+  void AddHouses(Index const & previous, PreviousDocs const & previousDocs,
+                 unsigned int loadThreadsCount);
+
+  // Fills the |m_buildingsByHouseNumbers| field.
+  void AddHouseNumbers(Index const & previous, PreviousDocs const & previousDocs,
+                       unsigned int loadThreadsCount);
 
-  std::vector<Doc> const & m_docs;
+  Hierarchy::Entries const & m_docs;
   Hierarchy const & m_hierarchy;
 
-  std::unordered_map<std::string, std::vector<DocId>> m_docIdsByTokens;
+  // Sorted tokens of all the names: the token |t| is
+  // [m_tokensOffsets[t], m_tokensOffsets[t + 1]) in |m_tokensChars|.
+  succinct::mapper::mappable_vector<char> m_tokensChars;
+  succinct::mapper::mappable_vector<uint64_t> m_tokensOffsets;
 
-  // Lists of houses grouped by the streets/localities they belong to.
-  std::unordered_map<DocId, std::vector<DocId>> m_relatedBuildings;
+  // Posting lists in the compressed sparse row layout. A key is the sorted
+  // tuple of token ids of a name: the key |k| (in the lexicographical order of
+  // the tuples) is [m_keysOffsets[k], m_keysOffsets[k + 1]) in |m_keysTokenIds|
+  // and its docs are [m_docIdsOffsets[k], m_docIdsOffsets[k + 1]) in |m_docIds|.
+  succinct::mapper::mappable_vector<TokenId> m_keysTokenIds;
+  succinct::mapper::mappable_vector<uint64_t> m_keysOffsets;
+  succinct::mapper::mappable_vector<uint64_t> m_docIdsOffsets;
+  succinct::mapper::mappable_vector<DocId> m_docIds;
+
+  // Ancestors of the docs: the ancestors of |docId| are sorted
+  // [m_ancestorsOffsets[docId], m_ancestorsOffsets[docId + 1]) in |m_ancestors|.
+  succinct::mapper::mappable_vector<uint64_t> m_ancestorsOffsets;
+  succinct::mapper::mappable_vector<DocId> m_ancestors;
+
+  // Lists of houses grouped by the streets/localities they belong to:
+  // the houses of |docId| are [m_relatedBuildingsOffsets[docId],
+  // m_relatedBuildingsOffsets[docId + 1]) in |m_relatedBuildings|.
+  succinct::mapper::mappable_vector<uint64_t> m_relatedBuildingsOffsets;
+  succinct::mapper::mappable_vector<DocId> m_relatedBuildings;
+
+  // Sorted house number keys of the related buildings: the key |k| is
+  // [m_houseNumberKeysOffsets[k], m_houseNumberKeysOffsets[k + 1]) in |m_houseNumberKeysChars|.
+  succinct::mapper::mappable_vector<char> m_houseNumberKeysChars;
+  succinct::mapper::mappable_vector<uint64_t> m_houseNumberKeysOffsets;
+
+  // The related buildings by their house number keys: the (key, building) pairs
+  // of |docId| are [m_buildingsByHouseNumbersOffsets[docId],
+  // m_buildingsByHouseNumbersOffsets[docId + 1]) in |m_buildingsByHouseNumbersKeys| and
+  // |m_buildingsByHouseNumbers|, sorted by the keys.
+  succinct::mapper::mappable_vector<uint64_t> m_buildingsByHouseNumbersOffsets;
+  succinct::mapper::mappable_vector<HouseNumberKeyId> m_buildingsByHouseNumbersKeys;
+  succinct::mapper::mappable_vector<DocId> m_buildingsByHouseNumbers;
 };
 }  // namespace geocoder
-
-BOOST_CLASS_VERSION(geocoder::Index, geocoder::kIndexFormatVersion)
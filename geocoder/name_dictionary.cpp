@@ -5,15 +5,72 @@
 #include <algorithm>
 #include <functional>
 #include <limits>
+#include <numeric>
+#include <thread>
 #include <utility>
 
+#include <boost/functional/hash.hpp>
+
 namespace geocoder
 {
+namespace
+{
+bool Equal(MultipleNamesView const & lhs, MultipleNamesView const & rhs)
+{
+  if (lhs.GetNamesCount() != rhs.GetNamesCount())
+    return false;
+
+  for (size_t i = 0; i < lhs.GetNamesCount(); ++i)
+  {
+    if (lhs.GetName(i) != rhs.GetName(i))
+      return false;
+  }
+  return true;
+}
+
+// Appends |names| as the last position of the dictionary in the flat layout.
+void Append(MultipleNamesView const & names, std::vector<char> & chars,
+            std::vector<uint64_t> & nameOffsets, std::vector<uint32_t> & firstNames)
+{
+  names.ForEachName([&](boost::string_view name) {
+    chars.insert(chars.end(), name.begin(), name.end());
+    nameOffsets.push_back(chars.size());
+  });
+  CHECK_LESS(nameOffsets.size(), std::numeric_limits<uint32_t>::max(), ());
+  firstNames.push_back(static_cast<uint32_t>(nameOffsets.size() - 1));
+}
+}  // namespace
+
+// MultipleNamesView -------------------------------------------------------------------------------
+MultipleNamesView::MultipleNamesView(char const * chars, uint64_t const * offsets,
+                                     size_t namesCount)
+  : m_chars{chars}, m_offsets{offsets}, m_namesCount{namesCount}
+{
+  ASSERT_GREATER(m_namesCount, 0, ());
+}
+
+boost::string_view MultipleNamesView::GetMainName() const noexcept
+{
+  return GetName(0);
+}
+
+boost::string_view MultipleNamesView::GetName(size_t i) const noexcept
+{
+  ASSERT_LESS(i, m_namesCount, ());
+  return {m_chars + m_offsets[i], static_cast<size_t>(m_offsets[i + 1] - m_offsets[i])};
+}
+
 // MultipleName ------------------------------------------------------------------------------------
 MultipleNames::MultipleNames(std::string const & mainName)
   : m_names{mainName}
 { }
 
+MultipleNames::MultipleNames(MultipleNamesView const & names)
+{
+  m_names.reserve(names.GetNamesCount());
+  names.ForEachName([this](boost::string_view name) { m_names.emplace_back(name.to_string()); });
+}
+
 std::string const & MultipleNames::GetMainName() const noexcept
 {
   return m_names[0];
@@ -58,19 +115,119 @@ bool operator!=(MultipleNames const & lhs, MultipleNames const & rhs) noexcept
 }
 
 // NameDictionary ----------------------------------------------------------------------------------
-MultipleNames const & NameDictionary::Get(Position position) const
+// static
+NameDictionary::Position constexpr NameDictionary::kUnspecifiedPosition;
+
+NameDictionary::NameDictionary(std::vector<char> && chars, std::vector<uint64_t> && nameOffsets,
+                               std::vector<uint32_t> && firstNames)
+{
+  CHECK(!nameOffsets.empty(), ());
+  CHECK(!firstNames.empty(), ());
+  CHECK_EQUAL(nameOffsets.back(), chars.size(), ());
+  CHECK_EQUAL(firstNames.back() + 1, nameOffsets.size(), ());
+
+  m_chars.steal(chars);
+  m_nameOffsets.steal(nameOffsets);
+  m_firstNames.steal(firstNames);
+}
+
+NameDictionary::NameDictionary(NameDictionary && other)
+{
+  Swap(other);
+}
+
+NameDictionary & NameDictionary::operator=(NameDictionary && other)
+{
+  NameDictionary{}.Swap(*this);
+  Swap(other);
+  return *this;
+}
+
+MultipleNamesView NameDictionary::Get(Position position) const
 {
   CHECK_GREATER(position, 0, ());
-  CHECK_LESS_OR_EQUAL(position, m_stock.size(), ());
-  return m_stock[position - 1];
+  CHECK_LESS_OR_EQUAL(position, Size(), ());
+  auto const first = m_firstNames[position - 1];
+  auto const last = m_firstNames[position];
+  return {m_chars.data(), m_nameOffsets.data() + first, static_cast<size_t>(last - first)};
 }
 
-NameDictionary::Position NameDictionary::Add(MultipleNames && names)
+size_t NameDictionary::Size() const
 {
-  CHECK(!names.GetMainName().empty(), ());
-  CHECK_LESS(m_stock.size(), std::numeric_limits<uint32_t>::max(), ());
-  m_stock.push_back(std::move(names));
-  return static_cast<uint32_t>(m_stock.size());  // index + 1
+  return m_firstNames.size() == 0 ? 0 : static_cast<size_t>(m_firstNames.size() - 1);
+}
+
+NameDictionary NameDictionary::Merge(NameDictionary const & other,
+                                     std::vector<Position> & positions) const
+{
+  positions.assign(other.Size() + 1, kUnspecifiedPosition);
+
+  // |other| is usually much smaller than the dictionary: its names are hashed
+  // and the dictionary is scanned once.
+  std::unordered_multimap<boost::string_view, Position, boost::hash<boost::string_view>>
+      otherPositions;
+  for (Position p = 1; p <= other.Size(); ++p)
+    otherPositions.emplace(other.Get(p).GetMainName(), p);
+
+  for (Position p = 1; p <= Size(); ++p)
+  {
+    auto const names = Get(p);
+    auto const range = otherPositions.equal_range(names.GetMainName());
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (positions[it->second] == kUnspecifiedPosition && Equal(names, other.Get(it->second)))
+        positions[it->second] = p;
+    }
+  }
+
+  std::vector<char> chars(m_chars.begin(), m_chars.end());
+  std::vector<uint64_t> nameOffsets(m_nameOffsets.begin(), m_nameOffsets.end());
+  std::vector<uint32_t> firstNames(m_firstNames.begin(), m_firstNames.end());
+  if (nameOffsets.empty())
+    nameOffsets.push_back(0);
+  if (firstNames.empty())
+    firstNames.push_back(0);
+
+  for (Position p = 1; p <= other.Size(); ++p)
+  {
+    if (positions[p] != kUnspecifiedPosition)
+      continue;
+
+    CHECK_LESS(firstNames.size(), std::numeric_limits<Position>::max(), ());
+    positions[p] = static_cast<Position>(firstNames.size());
+    Append(other.Get(p), chars, nameOffsets, firstNames);
+  }
+
+  return NameDictionary{std::move(chars), std::move(nameOffsets), std::move(firstNames)};
+}
+
+NameDictionary NameDictionary::Filter(std::vector<bool> const & used,
+                                      std::vector<Position> & positions) const
+{
+  CHECK_EQUAL(used.size(), Size() + 1, ());
+
+  positions.assign(Size() + 1, kUnspecifiedPosition);
+
+  std::vector<char> chars;
+  std::vector<uint64_t> nameOffsets{0};
+  std::vector<uint32_t> firstNames{0};
+  for (Position p = 1; p <= Size(); ++p)
+  {
+    if (!used[p])
+      continue;
+
+    positions[p] = static_cast<Position>(firstNames.size());
+    Append(Get(p), chars, nameOffsets, firstNames);
+  }
+
+  return NameDictionary{std::move(chars), std::move(nameOffsets), std::move(firstNames)};
+}
+
+void NameDictionary::Swap(NameDictionary & other)
+{
+  m_chars.swap(other.m_chars);
+  m_nameOffsets.swap(other.m_nameOffsets);
+  m_firstNames.swap(other.m_firstNames);
 }
 
 // NameDictionaryBuilder::Hash ---------------------------------------------------------------------
@@ -80,14 +237,30 @@ size_t NameDictionaryBuilder::Hash::operator()(MultipleNames const & names) cons
 }
 
 // NameDictionaryBuilder -----------------------------------------------------------------------------
+NameDictionaryBuilder::NameDictionaryBuilder()
+  : m_nameOffsets{0}, m_firstNames{0}
+{
+}
+
 NameDictionary::Position NameDictionaryBuilder::Add(MultipleNames && names)
 {
+  CHECK(!names.GetMainName().empty(), ());
+
   auto indexItem = m_index.find(names);
   if (indexItem != m_index.end())
     return indexItem->second;
 
-  auto p = m_dictionary.Add(std::move(names));
-  auto indexEmplace = m_index.emplace(m_dictionary.Get(p), p);
+  CHECK_LESS(m_firstNames.size(), std::numeric_limits<uint32_t>::max(), ());
+  for (auto const & name : names)
+  {
+    m_chars.insert(m_chars.end(), name.begin(), name.end());
+    m_nameOffsets.push_back(m_chars.size());
+  }
+  CHECK_LESS(m_nameOffsets.size(), std::numeric_limits<uint32_t>::max(), ());
+  m_firstNames.push_back(static_cast<uint32_t>(m_nameOffsets.size() - 1));
+
+  auto const p = static_cast<NameDictionary::Position>(m_firstNames.size() - 1);  // index + 1
+  auto indexEmplace = m_index.emplace(std::move(names), p);
   CHECK(indexEmplace.second, ());
   return p;
 }
@@ -95,6 +268,111 @@ NameDictionary::Position NameDictionaryBuilder::Add(MultipleNames && names)
 NameDictionary NameDictionaryBuilder::Release()
 {
   m_index.clear();
-  return std::move(m_dictionary);
+  NameDictionary dictionary{std::move(m_chars), std::move(m_nameOffsets), std::move(m_firstNames)};
+  m_chars.clear();
+  m_nameOffsets.assign(1, 0);
+  m_firstNames.assign(1, 0);
+  return dictionary;
+}
+
+// ShardedNameDictionaryBuilder --------------------------------------------------------------------
+ShardedNameDictionaryBuilder::ShardedNameDictionaryBuilder(size_t shardsCount)
+{
+  CHECK_GREATER(shardsCount, 0, ());
+  m_shards.reserve(shardsCount);
+  for (size_t i = 0; i < shardsCount; ++i)
+    m_shards.push_back(std::make_unique<Shard>());
+}
+
+NameDictionary::Position ShardedNameDictionaryBuilder::Add(MultipleNames && names)
+{
+  // Mix the hash: the shard builders distribute the same hashes between their buckets.
+  auto const hash = NameDictionaryBuilder::Hash{}(names) * 0x9E3779B97F4A7C15ULL;
+  auto const shardIndex = static_cast<size_t>((hash >> 32) % m_shards.size());
+  auto & shard = *m_shards[shardIndex];
+
+  NameDictionary::Position position;
+  {
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    position = shard.m_builder.Add(std::move(names));
+  }
+
+  auto const shardedPosition = uint64_t{position} * m_shards.size() + shardIndex;
+  CHECK_LESS(shardedPosition, std::numeric_limits<NameDictionary::Position>::max(), ());
+  return static_cast<NameDictionary::Position>(shardedPosition);
+}
+
+NameDictionary ShardedNameDictionaryBuilder::Release(unsigned int threadsCount)
+{
+  CHECK_GREATER(threadsCount, 0, ());
+
+  // Local positions of every shard in the order of the names.
+  std::vector<std::vector<NameDictionary::Position>> orders(m_shards.size());
+  std::vector<std::thread> threads(std::min<size_t>(threadsCount, m_shards.size()));
+  for (size_t t = 0; t < threads.size(); ++t)
+  {
+    threads[t] = std::thread([this, &orders, &threads, t] {
+      for (size_t i = t; i < m_shards.size(); i += threads.size())
+      {
+        auto const & builder = m_shards[i]->m_builder;
+        auto const name = [&builder](uint32_t n) {
+          auto const begin = builder.m_nameOffsets[n];
+          return boost::string_view{builder.m_chars.data() + begin,
+                                    static_cast<size_t>(builder.m_nameOffsets[n + 1] - begin)};
+        };
+        auto const less = [&](NameDictionary::Position lhs, NameDictionary::Position rhs) {
+          auto l = builder.m_firstNames[lhs - 1];
+          auto const lEnd = builder.m_firstNames[lhs];
+          auto r = builder.m_firstNames[rhs - 1];
+          auto const rEnd = builder.m_firstNames[rhs];
+          for (; l != lEnd && r != rEnd; ++l, ++r)
+          {
+            auto const cmp = name(l).compare(name(r));
+            if (cmp != 0)
+              return cmp < 0;
+          }
+          return l == lEnd && r != rEnd;
+        };
+
+        auto & order = orders[i];
+        order.resize(builder.m_firstNames.size() - 1);
+        std::iota(order.begin(), order.end(), 1);
+        std::sort(order.begin(), order.end(), less);
+      }
+    });
+  }
+  for (auto & thread : threads)
+    thread.join();
+
+  std::vector<char> chars;
+  std::vector<uint64_t> nameOffsets{0};
+  std::vector<uint32_t> firstNames{0};
+
+  m_releasedPositions.assign(m_shards.size(), {});
+  for (size_t i = 0; i < m_shards.size(); ++i)
+  {
+    auto & builder = m_shards[i]->m_builder;
+    auto & releasedPositions = m_releasedPositions[i];
+    releasedPositions.assign(builder.m_firstNames.size(), NameDictionary::kUnspecifiedPosition);
+    for (auto const position : orders[i])
+    {
+      for (auto n = builder.m_firstNames[position - 1]; n < builder.m_firstNames[position]; ++n)
+      {
+        auto const first = builder.m_chars.begin() + builder.m_nameOffsets[n];
+        auto const last = builder.m_chars.begin() + builder.m_nameOffsets[n + 1];
+        chars.insert(chars.end(), first, last);
+        nameOffsets.push_back(chars.size());
+      }
+      CHECK_LESS(nameOffsets.size(), std::numeric_limits<uint32_t>::max(), ());
+      firstNames.push_back(static_cast<uint32_t>(nameOffsets.size() - 1));
+      releasedPositions[position] = static_cast<NameDictionary::Position>(firstNames.size() - 1);
+    }
+
+    // Clear the shard.
+    builder.Release();
+    orders[i] = {};
+  }
+
+  return NameDictionary{std::move(chars), std::move(nameOffsets), std::move(firstNames)};
 }
 }  // namespace geocoder
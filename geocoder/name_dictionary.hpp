@@ -5,30 +5,51 @@
 #include "base/assert.hpp"
 
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-#include <boost/serialization/string.hpp>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/version.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include "3party/succinct/mappable_vector.hpp"
 
 namespace geocoder
 {
-class MultipleNames
+// Non-owning view of the names stored in NameDictionary.
+class MultipleNamesView
 {
 public:
-  using const_iterator = std::vector<std::string>::const_iterator;
+  MultipleNamesView(char const * chars, uint64_t const * offsets, size_t namesCount);
 
-  explicit MultipleNames(std::string const & mainName = {});
+  boost::string_view GetMainName() const noexcept;
+
+  size_t GetNamesCount() const noexcept { return m_namesCount; }
+  boost::string_view GetName(size_t i) const noexcept;
 
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version)
+  template <typename Fn>
+  void ForEachName(Fn && fn) const
   {
-    CHECK_EQUAL(version, kIndexFormatVersion, ());
-    ar & m_names;
+    for (size_t i = 0; i < m_namesCount; ++i)
+      fn(GetName(i));
   }
 
+private:
+  char const * m_chars;
+  // Begin offsets of the names in |m_chars| followed by the end offset of the last name.
+  uint64_t const * m_offsets;
+  size_t m_namesCount;
+};
+
+class MultipleNames
+{
+public:
+  using const_iterator = std::vector<std::string>::const_iterator;
+
+  explicit MultipleNames(std::string const & mainName = {});
+  explicit MultipleNames(MultipleNamesView const & names);
+
   std::string const & GetMainName() const noexcept;
   std::vector<std::string> const & GetNames() const noexcept;
 
@@ -46,6 +67,8 @@ private:
   std::vector<std::string> m_names;
 };
 
+// Flat storage of MultipleNames: all the names are kept in a single string pool
+// so the dictionary can be either built in memory or mapped from a binary index file.
 class NameDictionary
 {
 public:
@@ -55,46 +78,108 @@ public:
   static constexpr Position kUnspecifiedPosition = 0;
 
   NameDictionary() = default;
-  NameDictionary(NameDictionary &&) = default;
-  NameDictionary & operator=(NameDictionary &&) = default;
+  NameDictionary(std::vector<char> && chars, std::vector<uint64_t> && nameOffsets,
+                 std::vector<uint32_t> && firstNames);
+  NameDictionary(NameDictionary && other);
+  NameDictionary & operator=(NameDictionary && other);
 
   NameDictionary(NameDictionary const &) = delete;
   NameDictionary & operator=(NameDictionary const &) = delete;
 
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version)
+  template <typename Visitor>
+  void map(Visitor & visitor)
   {
-    CHECK_EQUAL(version, kIndexFormatVersion, ());
-    ar & m_stock;
+    visitor(m_chars, "chars");
+    visitor(m_nameOffsets, "nameOffsets");
+    visitor(m_firstNames, "firstNames");
   }
 
-  MultipleNames const & Get(Position position) const;
-  Position Add(MultipleNames && s);
+  MultipleNamesView Get(Position position) const;
+  size_t Size() const;
+
+  // Returns the copy of the dictionary followed by the names of |other| which are not
+  // in the dictionary yet. The names at the position |p| of |other| are at |positions[p]|
+  // in the result.
+  NameDictionary Merge(NameDictionary const & other, std::vector<Position> & positions) const;
+
+  // Returns the dictionary of the names at the positions |p| with |used[p]| only,
+  // in the same order. The names at the position |p| are at |positions[p]| in the result.
+  NameDictionary Filter(std::vector<bool> const & used, std::vector<Position> & positions) const;
+
+  void Swap(NameDictionary & other);
 
 private:
-  std::vector<MultipleNames> m_stock;
+  // Pool of all the names.
+  succinct::mapper::mappable_vector<char> m_chars;
+  // Offsets of the names in |m_chars|. The last element is the size of |m_chars|.
+  succinct::mapper::mappable_vector<uint64_t> m_nameOffsets;
+  // Names of the position |p| are [m_firstNames[p - 1], m_firstNames[p]) in |m_nameOffsets|.
+  succinct::mapper::mappable_vector<uint32_t> m_firstNames;
 };
 
 class NameDictionaryBuilder
 {
 public:
-  NameDictionaryBuilder() = default;
+  NameDictionaryBuilder();
   NameDictionaryBuilder(NameDictionaryBuilder const &) = delete;
   NameDictionaryBuilder & operator=(NameDictionaryBuilder const &) = delete;
 
   NameDictionary::Position Add(MultipleNames && s);
   NameDictionary Release();
 
-private:
   struct Hash
   {
     size_t operator()(MultipleNames const & names) const noexcept;
   };
 
-  NameDictionary m_dictionary;
+private:
+  friend class ShardedNameDictionaryBuilder;
+
+  std::vector<char> m_chars;
+  std::vector<uint64_t> m_nameOffsets;
+  std::vector<uint32_t> m_firstNames;
   std::unordered_map<MultipleNames, NameDictionary::Position, Hash> m_index;
 };
-}  // namespace geocoder
 
-BOOST_CLASS_VERSION(geocoder::MultipleNames, geocoder::kIndexFormatVersion)
-BOOST_CLASS_VERSION(geocoder::NameDictionary, geocoder::kIndexFormatVersion)
+// Thread-safe version of NameDictionaryBuilder. The names are partitioned
+// by their hashes between the shards and every shard is locked independently.
+// Add returns sharded positions which must be translated with ToReleasedPosition
+// after the shards are merged by Release. The names of every shard are sorted on
+// release so the dictionary does not depend on the order of concurrent additions.
+class ShardedNameDictionaryBuilder
+{
+public:
+  explicit ShardedNameDictionaryBuilder(size_t shardsCount = 64);
+  ShardedNameDictionaryBuilder(ShardedNameDictionaryBuilder const &) = delete;
+  ShardedNameDictionaryBuilder & operator=(ShardedNameDictionaryBuilder const &) = delete;
+
+  NameDictionary::Position Add(MultipleNames && names);
+  // Sorts the shards in |threadsCount| threads and merges them.
+  NameDictionary Release(unsigned int threadsCount = 1);
+
+  // Returns the position in the released dictionary of the names
+  // which were added at |shardedPosition|.
+  NameDictionary::Position ToReleasedPosition(NameDictionary::Position shardedPosition) const
+  {
+    if (shardedPosition == NameDictionary::kUnspecifiedPosition)
+      return NameDictionary::kUnspecifiedPosition;
+
+    auto const shard = shardedPosition % m_shards.size();
+    auto const position = shardedPosition / m_shards.size();
+    ASSERT_LESS(shard, m_releasedPositions.size(), ());
+    ASSERT_LESS(position, m_releasedPositions[shard].size(), ());
+    return m_releasedPositions[shard][position];
+  }
+
+private:
+  struct Shard
+  {
+    std::mutex m_mutex;
+    NameDictionaryBuilder m_builder;
+  };
+
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  // Positions in the released dictionary by the shards and the positions in the shards.
+  std::vector<std::vector<NameDictionary::Position>> m_releasedPositions;
+};
+}  // namespace geocoder
@@ -4,15 +4,25 @@
 #include "coding/geometry_coding.hpp"
 #include "coding/var_record_reader.hpp"
 
+#include "geometry/region2d.hpp"
+
+#include "base/assert.hpp"
+#include "base/checked_cast.hpp"
 #include "base/logging.hpp"
 #include "base/macros.hpp"
 
+#include <cmath>
+#include <utility>
+
 #include "defines.hpp"
 
 using namespace std;
 
 namespace
 {
+// Average number of the edges in a slab of Borders::PreparedPolygon.
+size_t const kEdgesPerSlab = 8;
+
 template <class Reader>
 class BordersVector
 {
@@ -84,6 +94,98 @@ private:
 
 namespace indexer
 {
+// Borders::PreparedPolygon ------------------------------------------------------------------------
+Borders::PreparedPolygon::PreparedPolygon(vector<m2::PointD> const & points) : m_points(points)
+{
+  for (auto const & point : m_points)
+    m_rect.Add(point);
+
+  if (m_points.empty())
+    return;
+
+  // Points which are closer than the precision of m2::RegionD are equal, the edges are
+  // extended by it to keep the vertices which are equal to the query point in the slab.
+  double const precision = m2::detail::DefEqualFloat::kPrecision;
+  size_t const slabsCount = m_points.size() / kEdgesPerSlab + 1;
+  if (m_rect.SizeY() > 0.0)
+    m_slabHeight = m_rect.SizeY() / slabsCount;
+
+  vector<pair<size_t, size_t>> edgeSlabs(m_points.size());
+  m_slabOffsets.assign(slabsCount + 1, 0);
+  for (size_t i = 0; i < m_points.size(); ++i)
+  {
+    auto const & prev = m_points[i == 0 ? m_points.size() - 1 : i - 1];
+    auto const & curr = m_points[i];
+    edgeSlabs[i] = {GetSlab(min(prev.y, curr.y) - precision),
+                    GetSlab(max(prev.y, curr.y) + precision)};
+    for (size_t s = edgeSlabs[i].first; s <= edgeSlabs[i].second; ++s)
+      ++m_slabOffsets[s + 1];
+  }
+
+  for (size_t s = 0; s < slabsCount; ++s)
+    m_slabOffsets[s + 1] += m_slabOffsets[s];
+
+  auto positions = m_slabOffsets;
+  m_slabEdges.resize(m_slabOffsets.back());
+  for (size_t i = 0; i < m_points.size(); ++i)
+  {
+    for (size_t s = edgeSlabs[i].first; s <= edgeSlabs[i].second; ++s)
+      m_slabEdges[positions[s]++] = base::asserted_cast<uint32_t>(i);
+  }
+}
+
+size_t Borders::PreparedPolygon::GetSlab(double y) const
+{
+  auto const slabsCount = m_slabOffsets.size() - 1;
+  auto const slab = floor((y - m_rect.minY()) / m_slabHeight);
+  if (slab <= 0.0)
+    return 0;
+  return min(slabsCount - 1, static_cast<size_t>(slab));
+}
+
+bool Borders::PreparedPolygon::Contains(m2::PointD const & pt) const
+{
+  // The same crossings counting as in m2::RegionD::Contains() for the edges
+  // which may cross the horizontal line of |pt|.
+  if (m_points.empty() || !m_rect.IsPointInside(pt))
+    return false;
+
+  m2::detail::DefEqualFloat const equalF;
+  int rCross = 0;
+  int lCross = 0;
+  auto const slab = GetSlab(pt.y);
+  for (auto e = m_slabOffsets[slab]; e < m_slabOffsets[slab + 1]; ++e)
+  {
+    auto const i = m_slabEdges[e];
+    if (equalF.EqualPoints(m_points[i], pt))
+      return true;
+
+    auto const prev = m_points[i == 0 ? m_points.size() - 1 : i - 1] - pt;
+    auto const curr = m_points[i] - pt;
+
+    bool const rCheck = ((curr.y > 0) != (prev.y > 0));
+    bool const lCheck = ((curr.y < 0) != (prev.y < 0));
+    if (!rCheck && !lCheck)
+      continue;
+
+    double const delta = prev.y - curr.y;
+    double const cp = m2::CrossProduct(curr, prev);
+    if (equalF.EqualZeroSquarePrecision(cp))
+      continue;
+
+    bool const prevGreaterCurr = delta > 0.0;
+    if (rCheck && ((cp > 0) == prevGreaterCurr))
+      ++rCross;
+    if (lCheck && ((cp > 0) != prevGreaterCurr))
+      ++lCross;
+  }
+
+  // On the edge if the parities of the left and the right crossings differ,
+  // inside if the number of the crossings is odd.
+  return (rCross & 1) != (lCross & 1) || (rCross & 1) != 0;
+}
+
+// Borders -----------------------------------------------------------------------------------------
 bool Borders::Border::IsPointInside(m2::PointD const & point) const
 {
   if (!m_outer.Contains(point))
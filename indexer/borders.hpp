@@ -1,10 +1,10 @@
 #pragma once
 
 #include "geometry/point2d.hpp"
-#include "geometry/region2d.hpp"
+#include "geometry/rect2d.hpp"
 
+#include <algorithm>
 #include <cstdint>
-#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -22,16 +22,27 @@ class Borders
 public:
   bool IsPointInside(uint64_t id, m2::PointD const & point) const
   {
-    auto const range = m_borders.equal_range(id);
+    auto const range = std::equal_range(m_index.cbegin(), m_index.cend(), IndexEntry{id, 0},
+                                        IndexEntryLess());
 
     for (auto it = range.first; it != range.second; ++it)
     {
-      if (it->second.IsPointInside(point))
+      if (m_borders[it->m_border].IsPointInside(point))
         return true;
     }
     return false;
   }
 
+  template <typename Fn>
+  void ForEachId(Fn && fn) const
+  {
+    for (size_t i = 0; i < m_index.size(); ++i)
+    {
+      if (i == 0 || m_index[i].m_id != m_index[i - 1].m_id)
+        fn(m_index[i].m_id);
+    }
+  }
+
   // Throws Reader::Exception in case of data reading errors.
   void Deserialize(std::string const & filename);
 
@@ -40,24 +51,66 @@ public:
   {
     vec.ForEach([this](uint64_t id, std::vector<m2::PointD> const & outer,
                        std::vector<std::vector<m2::PointD>> const & inners) {
-      auto it = m_borders.insert(std::make_pair(id, Border()));
-      it->second.m_outer = m2::RegionD(outer);
+      m_index.push_back({id, m_borders.size()});
+      m_borders.emplace_back();
+      auto & border = m_borders.back();
+      border.m_outer = PreparedPolygon(outer);
       for (auto const & inner : inners)
-        it->second.m_inners.push_back(m2::RegionD(inner));
+        border.m_inners.emplace_back(inner);
     });
+    std::stable_sort(m_index.begin(), m_index.end(), IndexEntryLess());
   }
 
 private:
+  // Polygon prepared for the point queries: the edges are bucketed by horizontal slabs of
+  // the bounding rect, so a query checks the edges of a single slab only. The result is
+  // the same as the one of m2::RegionD::Contains().
+  class PreparedPolygon
+  {
+  public:
+    PreparedPolygon() = default;
+    explicit PreparedPolygon(std::vector<m2::PointD> const & points);
+
+    bool Contains(m2::PointD const & point) const;
+
+  private:
+    size_t GetSlab(double y) const;
+
+    std::vector<m2::PointD> m_points;
+    m2::RectD m_rect;
+    double m_slabHeight = 1.0;
+    // The edges of the slab |s| are [m_slabOffsets[s], m_slabOffsets[s + 1]) in |m_slabEdges|,
+    // the edge |i| ends at the point |i|.
+    std::vector<uint32_t> m_slabOffsets;
+    std::vector<uint32_t> m_slabEdges;
+  };
+
   struct Border
   {
     Border() = default;
 
     bool IsPointInside(m2::PointD const & point) const;
 
-    m2::RegionD m_outer;
-    std::vector<m2::RegionD> m_inners;
+    PreparedPolygon m_outer;
+    std::vector<PreparedPolygon> m_inners;
+  };
+
+  struct IndexEntry
+  {
+    uint64_t m_id;
+    size_t m_border;
+  };
+
+  struct IndexEntryLess
+  {
+    bool operator()(IndexEntry const & lhs, IndexEntry const & rhs) const
+    {
+      return lhs.m_id < rhs.m_id;
+    }
   };
 
-  std::multimap<uint64_t, Border> m_borders;
+  std::vector<Border> m_borders;
+  // The borders sorted by the ids.
+  std::vector<IndexEntry> m_index;
 };
 }  // namespace indexer
@@ -3,8 +3,11 @@
 #include "indexer/borders.hpp"
 
 #include "geometry/point2d.hpp"
+#include "geometry/region2d.hpp"
 
+#include <cmath>
 #include <cstdint>
+#include <random>
 #include <vector>
 
 using namespace indexer;
@@ -117,4 +120,39 @@ UNIT_TEST(BordersTest)
     TEST(!borders.IsPointInside(0, m2::PointD{7, 7}), ());
   }
 }
+
+UNIT_TEST(Borders_SameAsRegionContains)
+{
+  // A star-shaped polygon with many vertices, the vertices and the points on the edges are queried.
+  mt19937 rng(0);
+  uniform_real_distribution<double> radius(5.0, 10.0);
+  vector<m2::PointD> outer;
+  size_t const kPointsCount = 500;
+  for (size_t i = 0; i < kPointsCount; ++i)
+  {
+    auto const angle = 2 * M_PI * i / kPointsCount;
+    auto const r = i % 50 == 0 ? 10.0 : radius(rng);
+    outer.emplace_back(r * cos(angle), round(r * sin(angle) * 10) / 10);
+  }
+
+  BordersVector vec;
+  vec.m_borders.push_back({7, outer, {}});
+  indexer::Borders borders;
+  borders.DeserializeFromVec(vec);
+  m2::RegionD const region(outer);
+
+  uniform_real_distribution<double> coord(-11.0, 11.0);
+  for (size_t i = 0; i < 20000; ++i)
+  {
+    m2::PointD const point(coord(rng), round(coord(rng) * 10) / 10);
+    TEST_EQUAL(borders.IsPointInside(7, point), region.Contains(point), (point));
+  }
+  for (size_t i = 0; i < outer.size(); ++i)
+  {
+    auto const middle = (outer[i] + outer[(i + 1) % outer.size()]) / 2;
+    TEST(borders.IsPointInside(7, outer[i]), (outer[i]));
+    TEST_EQUAL(borders.IsPointInside(7, middle), region.Contains(middle), (middle));
+  }
+  TEST(!borders.IsPointInside(8, outer[0]), ());
+}
 }  // namespace
@@ -48,8 +48,32 @@ public:
   void ForEachInRect(ProcessObject const & processObject, m2::RectD const & rect) const
   {
     covering::CoveringGetter cov(rect, covering::CoveringMode::ViewportWithLowLevels);
-    covering::Intervals const & intervals = cov.Get<DEPTH_LEVELS>(scales::GetUpperScale());
+    ForEachInIntervals(processObject, cov.Get<DEPTH_LEVELS>(scales::GetUpperScale()));
+  }
+
+  // Returns the intervals of the index keys scanned by ForEachAtPoint(). The points with
+  // the equal intervals have the same objects.
+  static covering::Intervals GetIntervalsAtPoint(m2::PointD const & point)
+  {
+    m2::RectD const rect(point, point);
+    covering::CoveringGetter cov(rect, covering::CoveringMode::ViewportWithLowLevels);
+    return cov.Get<DEPTH_LEVELS>(scales::GetUpperScale());
+  }
 
+  // Returns the key of the index cell containing |point|. Sorting points by the keys orders them
+  // along the cells of the index, so the neighbouring points are likely to have the same
+  // GetIntervalsAtPoint().
+  static int64_t GetCellOrder(m2::PointD const & point)
+  {
+    using Converter = CellIdConverter<MercatorBounds, m2::CellId<DEPTH_LEVELS>>;
+
+    auto const cellDepth = covering::GetCodingDepth<DEPTH_LEVELS>(scales::GetUpperScale());
+    return Converter::ToCellId(point.x, point.y).ToInt64(cellDepth);
+  }
+
+  void ForEachInIntervals(ProcessObject const & processObject,
+                          covering::Intervals const & intervals) const
+  {
     for (auto const & i : intervals)
     {
       m_intervalIndex->ForEach(
@@ -64,7 +64,8 @@ bool BuildLocalityIndexFromDataFile(string const & dataFile,
                                     string const & outFileName,
                                     string const & localityIndexFileTag,
                                     string const & dataVersionJson,
-                                    string const & dataVersionTag)
+                                    string const & dataVersionTag,
+                                    unsigned int threadsCount)
 {
   try
   {
@@ -74,7 +75,8 @@ bool BuildLocalityIndexFromDataFile(string const & dataFile,
       FileWriter writer(idxFileName);
 
       covering::BuildLocalityIndex<LocalityVector<ModelReaderPtr>, FileWriter, DEPTH_LEVELS>(
-          localities.GetVector(), writer, coverLocality, outFileName, IntervalIndexVersion::V2);
+          localities.GetVector(), writer, coverLocality, outFileName, IntervalIndexVersion::V2,
+          threadsCount);
     }
 
     FilesContainerW writer(outFileName, FileWriter::OP_WRITE_TRUNCATE);
@@ -98,24 +100,26 @@ bool BuildLocalityIndexFromDataFile(string const & dataFile,
 
 bool BuildGeoObjectsIndexFromDataFile(string const & dataFile, string const & outFileName,
                                       string const & dataVersionJson,
-                                      string const & dataVersionTag)
+                                      string const & dataVersionTag, unsigned int threadsCount)
 {
   auto coverObject = [](indexer::LocalityObject const & o, int cellDepth) {
     return covering::CoverGeoObject(o, cellDepth);
   };
   return BuildLocalityIndexFromDataFile<kGeoObjectsDepthLevels>(dataFile, coverObject, outFileName,
                                                                 GEO_OBJECTS_INDEX_FILE_TAG,
-                                                                dataVersionJson, dataVersionTag);
+                                                                dataVersionJson, dataVersionTag,
+                                                                threadsCount);
 }
 
 bool BuildRegionsIndexFromDataFile(string const & dataFile, string const & outFileName,
                                    string const & dataVersionJson,
-                                   string const & dataVersionTag)
+                                   string const & dataVersionTag, unsigned int threadsCount)
 {
   auto coverRegion = [](indexer::LocalityObject const & o, int cellDepth) {
     return covering::CoverRegion(o, cellDepth);
   };
   return BuildLocalityIndexFromDataFile<kRegionsDepthLevels>(
-      dataFile, coverRegion, outFileName, REGIONS_INDEX_FILE_TAG, dataVersionJson, dataVersionTag);
+      dataFile, coverRegion, outFileName, REGIONS_INDEX_FILE_TAG, dataVersionJson, dataVersionTag,
+      threadsCount);
 }
 }  // namespace indexer
@@ -16,6 +16,7 @@
 
 #include "defines.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <string>
@@ -26,10 +27,18 @@ namespace covering
 using CoverLocality =
     std::function<std::vector<int64_t>(indexer::LocalityObject const & o, int cellDepth)>;
 
+// The sorter buffer grows with the input up to this size, so small inputs do not allocate it
+// whole. A planet-sized input still makes few runs and merges them with big read windows.
+size_t constexpr kLocalityIndexSorterBufferBytes = 256 * 1024 * 1024;
+
+// The cells of the objects are sorted by |threadsCount| threads in a buffer of
+// |sorterBufferBytes| bytes.
 template <class ObjectsVector, class Writer, int DEPTH_LEVELS>
 void BuildLocalityIndex(ObjectsVector const & objects, Writer & writer,
                         CoverLocality const & coverLocality, std::string const & tmpFilePrefix,
-                        IntervalIndexVersion version = IntervalIndexVersion::V1)
+                        IntervalIndexVersion version = IntervalIndexVersion::V1,
+                        unsigned int threadsCount = 1,
+                        size_t sorterBufferBytes = kLocalityIndexSorterBufferBytes)
 {
   std::string const cellsToValueFile = tmpFilePrefix + CELL2LOCALITY_SORTED_EXT + ".all";
   SCOPE_GUARD(cellsToValueFileGuard, std::bind(&FileWriter::DeleteFileX, cellsToValueFile));
@@ -38,7 +47,8 @@ void BuildLocalityIndex(ObjectsVector const & objects, Writer & writer,
 
     WriterFunctor<FileWriter> out(cellsToValueWriter);
     FileSorter<CellValuePair<uint64_t>, WriterFunctor<FileWriter>> sorter(
-        1024 * 1024 /* bufferBytes */, tmpFilePrefix + CELL2LOCALITY_TMP_EXT, out);
+        sorterBufferBytes, tmpFilePrefix + CELL2LOCALITY_TMP_EXT, out,
+        std::less<CellValuePair<uint64_t>>(), threadsCount);
     objects.ForEach([&sorter, &coverLocality](indexer::LocalityObject const & o) {
       std::vector<int64_t> const cells =
           coverLocality(o, GetCodingDepth<DEPTH_LEVELS>(scales::GetUpperScale()));
@@ -63,11 +73,13 @@ namespace indexer
 // and saves it to |GEO_OBJECTS_INDEX_FILE_TAG| of |out|.
 bool BuildGeoObjectsIndexFromDataFile(std::string const & dataFile, std::string const & out,
                                       std::string const & dataVersionJson,
-                                      std::string const & dataVersionTag);
+                                      std::string const & dataVersionTag,
+                                      unsigned int threadsCount = 1);
 
 // Builds indexer::RegionsIndex for reverse geocoder with |kRegionsDepthLevels| depth levels and
 // saves it to |REGIONS_INDEX_FILE_TAG| of |out|.
 bool BuildRegionsIndexFromDataFile(std::string const & dataFile, std::string const & out,
                                    std::string const & dataVersionJson,
-                                   std::string const & dataVersionTag);
+                                   std::string const & dataVersionTag,
+                                   unsigned int threadsCount = 1);
 }  // namespace indexer